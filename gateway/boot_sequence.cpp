@@ -0,0 +1,96 @@
+#include "boot_sequence.h"
+
+#include <string.h>
+
+#include "gateway_config.h"
+
+namespace gw {
+
+namespace {
+
+const char* const kBootPhaseNames[kBootPhaseCount] = {
+    "uart", "ap", "addr", "socket",
+};
+
+}  // namespace
+
+const char* bootPhaseName(int phase) {
+  return phase >= 0 && phase < kBootPhaseCount ? kBootPhaseNames[phase] : "?";
+}
+
+BootSequence::BootSequence(NetworkBringUp& net, Clock& clock, Logger& log)
+    : net_(net),
+      clock_(clock),
+      log_(log),
+      phase_(kBootUart),
+      phase_start_us_(0),  // micros() counts from reset
+      ap_restarts_(0) {
+  memset(durations_, 0, sizeof(durations_));
+}
+
+void BootSequence::begin() {
+  if (phase_ == kBootUart) {
+    finish(kBootAp);
+  }
+}
+
+bool BootSequence::poll() {
+  switch (phase_) {
+    case kBootUart:
+      begin();
+      return false;
+    case kBootAp:
+      net_.startAccessPoint();
+      finish(kBootAddress);
+      return false;
+    case kBootAddress:
+      if (net_.hasAddress()) {
+        finish(kBootSocket);
+      } else if (clock_.micros() - phase_start_us_ >= GW_BOOT_AP_TIMEOUT_US) {
+        // The wasted wait is counted towards the next ap phase
+        ap_restarts_++;
+        phase_ = kBootAp;
+      }
+      return false;
+    case kBootSocket:
+      if (!net_.openSocket()) {
+        return false;
+      }
+      finish(kBootReady);
+      return true;
+    case kBootReady:
+      break;
+  }
+  return false;
+}
+
+void BootSequence::finish(BootPhase next) {
+  uint32_t now = clock_.micros();
+  uint32_t us = now - phase_start_us_;
+  durations_[phase_] = us;
+#if GW_LOG_LEVEL >= GW_LOG_INFO
+  uint8_t data[10];
+  memset(data, 0, sizeof(data));
+  strncpy((char*)data, bootPhaseName(phase_), 6);
+  data[6] = (uint8_t)(us >> 24);
+  data[7] = (uint8_t)(us >> 16);
+  data[8] = (uint8_t)(us >> 8);
+  data[9] = (uint8_t)us;
+  GW_LOG_I(log_, kLogBootPhase, data, sizeof(data));
+#endif
+  phase_ = next;
+  phase_start_us_ = now;
+}
+
+uint32_t BootSequence::phaseUs(int phase) const {
+  return phase >= 0 && phase < kBootPhaseCount ? durations_[phase] : 0;
+}
+
+uint32_t BootSequence::totalUs() const {
+  if (!ready()) {
+    return 0;
+  }
+  return phase_start_us_;  // When the last phase ended, counted from reset
+}
+
+}  // namespace gw
@@ -0,0 +1,95 @@
+/*
+  Network bring-up as a state machine polled from loop().
+
+  The original sketch waited in setup() for the access point to get its
+  address, in 300 ms steps, before the UDP socket was opened and before
+  anything read the UART. Here setup() only opens the UART and the
+  sequence advances one step per loop() iteration, alongside
+  Gateway::poll(), so UART data is drained (and framing stays in sync)
+  from the start. UDP traffic is simply absent until the socket is open.
+
+    uart -> ap -> address -> socket -> ready
+
+  Each phase's duration is logged as a kLogBootPhase record, measured
+  from reset for "uart" and from the end of the previous phase for the
+  rest. If the access point has no address after GW_BOOT_AP_TIMEOUT_US,
+  it is started again.
+*/
+
+#ifndef GATEWAY_BOOT_SEQUENCE_H_
+#define GATEWAY_BOOT_SEQUENCE_H_
+
+#include <stdint.h>
+
+#include "gateway_log.h"
+#include "gateway_transport.h"
+
+namespace gw {
+
+enum BootPhase {
+  kBootUart,     // Reset -> UART open (begin())
+  kBootAp,       // Access point start
+  kBootAddress,  // Waiting for the access point's IP address
+  kBootSocket,   // UDP socket bound
+  kBootReady,
+  kBootPhaseCount = kBootReady
+};
+
+// Short name of a phase, e.g. "ap".
+const char* bootPhaseName(int phase);
+
+// Board side of the bring-up (energia_transport.h). Calls should return
+// promptly; anything that has to wait is polled through hasAddress() and
+// openSocket().
+class NetworkBringUp {
+ public:
+  virtual ~NetworkBringUp() {}
+
+  // Starts, or restarts, the access point.
+  virtual void startAccessPoint() = 0;
+
+  // True once the access point has its IP address.
+  virtual bool hasAddress() = 0;
+
+  // Binds the UDP port. Returns false to be retried on the next poll.
+  virtual bool openSocket() = 0;
+};
+
+class BootSequence {
+ public:
+  BootSequence(NetworkBringUp& net, Clock& clock, Logger& log);
+
+  // Ends the uart phase. Call from setup() right after opening the UART.
+  void begin();
+
+  // Advances at most one step. Returns true on the call that completes
+  // the sequence, false before and after.
+  bool poll();
+
+  bool ready() const { return phase_ == kBootReady; }
+  BootPhase phase() const { return phase_; }
+
+  // Duration of a completed phase in microseconds, 0 if not reached yet.
+  uint32_t phaseUs(int phase) const;
+
+  // Reset to ready, in microseconds; 0 until ready.
+  uint32_t totalUs() const;
+
+  // Access point restarts after GW_BOOT_AP_TIMEOUT_US without an address.
+  uint32_t apRestarts() const { return ap_restarts_; }
+
+ private:
+  void finish(BootPhase next);
+
+  NetworkBringUp& net_;
+  Clock& clock_;
+  Logger& log_;
+  BootPhase phase_;
+  uint32_t phase_start_us_;
+  uint32_t durations_[kBootPhaseCount];
+  uint32_t ap_restarts_;
+};
+
+}  // namespace gw
+
+#endif  // GATEWAY_BOOT_SEQUENCE_H_
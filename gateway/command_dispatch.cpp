@@ -0,0 +1,49 @@
+#include "command_dispatch.h"
+
+#include "gateway_config.h"
+
+namespace gw {
+
+const uint8_t kCommandRoutes[wire::kTypeMask + 1] = {
+    /* 0x00 */ 0,
+    /* 0x01 heartbeat */ kRouteKnown | kRouteConsume,
+    /* 0x02 start */ kRouteKnown | kRoutePriority | kRouteControllerOnly |
+        kRouteSequenced,
+    /* 0x03 stop */ kRouteKnown | kRoutePriority,
+    /* 0x04 move */ kRouteKnown | kRouteControllerOnly | kRouteSequenced |
+        kRouteLatestWins,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0x05 - 0x0f
+    /* 0x10 telemetry */ 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0x11 - 0x1f
+    /* 0x20 stats request */ kRouteKnown | kRouteConsume,
+    /* 0x21 telemetry policy */ kRouteKnown | kRouteConsume,
+    /* 0x22 ping */ kRouteKnown | kRouteConsume,
+};
+
+uint8_t classifyBinary(const uint8_t* frame, size_t len) {
+  uint8_t type = wire::peekType(frame, len);
+  int fields = wire::fieldCount(type);
+  if (fields < 0 || (frame[1] >> wire::kVersionShift) != wire::kVersion) {
+    return 0;
+  }
+  size_t raw = wire::kHeaderSize + 2 * (size_t)fields + wire::kCrcSize;
+  return len == raw + raw / 254 + 1 ? type : 0;
+}
+
+uint8_t classifyAscii(const uint8_t* frame, size_t len) {
+  // "\x02heartbeat\x03", "\x02start\x03" and "\x02stop\x03" differ in length
+  if (len >= 3 && frame[len - 1] == GW_ETX) {
+    if (len == 11 && frame[1] == 'h') {
+      return wire::kHeartbeat;
+    }
+    if (len == 7 && frame[1] == 's') {
+      return wire::kStart;
+    }
+    if (len == 6 && frame[1] == 's') {
+      return wire::kStop;
+    }
+  }
+  return wire::kMove;
+}
+
+}  // namespace gw
@@ -0,0 +1,66 @@
+/*
+  Command classification and routing.
+
+  A command is classified where it lies in the receive buffer: a binary
+  frame by its in-place type byte (wire::peekType) and encoded length, a
+  legacy ASCII frame by its length and first payload byte. No string
+  comparisons, no decoding and no copies are needed to decide what to do
+  with it.
+
+  What happens next is looked up in kCommandRoutes, indexed by wire type:
+
+  - kRouteConsume:        handled by the gateway itself, never forwarded
+                          (heartbeats, which only refresh the session,
+                          pings, stats requests, telemetry policies).
+  - kRoutePriority:       written to the UART straight away, ahead of the
+                          move held for the iteration (start, stop).
+  - kRouteControllerOnly: dropped unless the sender holds or can claim the
+                          controller role (start, move).
+  - kRouteSequenced:      dropped if its sequence number (binary only) is
+                          not newer than the sender's last (start, move).
+  - kRouteLatestWins:     held until the end of the loop iteration and
+                          replaced by a newer one of the same type; only the
+                          newest is written to the UART (move).
+
+  A new command type needs a wire::Type value, a line in kCommandRoutes
+  and, if it is consumed, a case in Gateway::handleLocalCommand().
+*/
+
+#ifndef GATEWAY_COMMAND_DISPATCH_H_
+#define GATEWAY_COMMAND_DISPATCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "wire_protocol.h"
+
+namespace gw {
+
+enum CommandRouteFlags {
+  kRouteKnown = 0x01,  // A command the gateway accepts at all
+  kRouteConsume = 0x02,
+  kRoutePriority = 0x04,
+  kRouteControllerOnly = 0x08,
+  kRouteSequenced = 0x10,
+  kRouteLatestWins = 0x20,
+};
+
+// Route flags per wire type; 0 for anything that is not a command.
+extern const uint8_t kCommandRoutes[wire::kTypeMask + 1];
+
+inline uint8_t commandRoute(uint8_t type) {
+  return kCommandRoutes[type & wire::kTypeMask];
+}
+
+// Type of a binary command frame (terminator excluded), or 0 if its version
+// or length doesn't match its type. The CRC is not checked.
+uint8_t classifyBinary(const uint8_t* frame, size_t len);
+
+// Type of a legacy STX ... ETX frame. Anything that is not one of the
+// command words is classified as a move, as the original gateway forwarded
+// everything that wasn't a heartbeat.
+uint8_t classifyAscii(const uint8_t* frame, size_t len);
+
+}  // namespace gw
+
+#endif  // GATEWAY_COMMAND_DISPATCH_H_
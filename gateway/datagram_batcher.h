@@ -0,0 +1,75 @@
+/*
+  Coalesces complete frames into one outgoing datagram.
+
+  Frames are appended back to back exactly as they would have been sent
+  one per datagram (STX ... ETX text, or 0x00-terminated binary), so the
+  receiver splits a batch with the same delimiters it already uses. A batch
+  is flushed when the next frame would push it past the byte budget, or
+  once its oldest frame has been held for the hold time.
+*/
+
+#ifndef GATEWAY_DATAGRAM_BATCHER_H_
+#define GATEWAY_DATAGRAM_BATCHER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "gateway_config.h"
+
+namespace gw {
+
+class DatagramBatcher {
+ public:
+  DatagramBatcher() : len_(0), frames_(0), oldest_us_(0) {}
+
+  bool empty() const { return len_ == 0; }
+  const uint8_t* data() const { return buf_; }
+  size_t size() const { return len_; }
+  uint32_t frames() const { return frames_; }
+  // Arrival time of the oldest frame in the batch.
+  uint32_t oldestUs() const { return oldest_us_; }
+
+  // True if a frame of len bytes fits without exceeding max_bytes.
+  bool fits(size_t len, size_t max_bytes) const {
+    if (max_bytes > sizeof(buf_)) {
+      max_bytes = sizeof(buf_);
+    }
+    return len_ + len <= max_bytes;
+  }
+
+  // Appends a frame that arrived at rx_us. The caller flushes first if
+  // !fits(). Returns false if the frame does not fit the buffer at all.
+  bool add(const uint8_t* data, size_t len, uint32_t rx_us) {
+    if (len_ + len > sizeof(buf_)) {
+      return false;
+    }
+    if (len_ == 0) {
+      oldest_us_ = rx_us;
+    }
+    memcpy(buf_ + len_, data, len);
+    len_ += len;
+    frames_++;
+    return true;
+  }
+
+  // True once the oldest frame has waited hold_us since it arrived.
+  bool due(uint32_t now_us, uint32_t hold_us) const {
+    return len_ > 0 && now_us - oldest_us_ >= hold_us;
+  }
+
+  void clear() {
+    len_ = 0;
+    frames_ = 0;
+  }
+
+ private:
+  uint8_t buf_[GW_BATCH_BUFFER_SIZE];
+  size_t len_;
+  uint32_t frames_;
+  uint32_t oldest_us_;
+};
+
+}  // namespace gw
+
+#endif  // GATEWAY_DATAGRAM_BATCHER_H_
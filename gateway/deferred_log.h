@@ -0,0 +1,65 @@
+/*
+  Fixed-capacity FIFO of binary log records.
+
+  Records are small POD structs copied in and out by value; nothing is
+  formatted or allocated when an event is queued. When the queue is full
+  the new record is dropped and counted, so a burst of traffic can never
+  stall the forwarding path on logging.
+*/
+
+#ifndef GATEWAY_DEFERRED_LOG_H_
+#define GATEWAY_DEFERRED_LOG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gateway_config.h"
+
+namespace gw {
+
+// Leading payload bytes kept per record; fits a "+0.50-0.25" move payload.
+const size_t kLogDataSize = 10;
+
+struct LogRecord {
+  uint32_t time_us;
+  uint8_t event;  // LogEvent
+  uint8_t len;    // Length of the original payload, which may exceed data
+  uint8_t data[kLogDataSize];
+};
+
+class DeferredLog {
+ public:
+  DeferredLog() : head_(0), tail_(0), dropped_(0) {}
+
+  bool empty() const { return head_ == tail_; }
+  uint32_t dropped() const { return dropped_; }
+
+  bool push(const LogRecord& record) {
+    if (head_ - tail_ == GW_LOG_QUEUE_SIZE) {
+      dropped_++;
+      return false;
+    }
+    records_[head_ % GW_LOG_QUEUE_SIZE] = record;
+    head_++;
+    return true;
+  }
+
+  bool pop(LogRecord* record) {
+    if (empty()) {
+      return false;
+    }
+    *record = records_[tail_ % GW_LOG_QUEUE_SIZE];
+    tail_++;
+    return true;
+  }
+
+ private:
+  LogRecord records_[GW_LOG_QUEUE_SIZE];
+  uint32_t head_;
+  uint32_t tail_;
+  uint32_t dropped_;
+};
+
+}  // namespace gw
+
+#endif  // GATEWAY_DEFERRED_LOG_H_
@@ -0,0 +1,164 @@
+/*
+  Energia implementations of the gateway transport interfaces.
+
+  Header-only so that the host build never sees it: only the sketch
+  (CC3200_UART.cpp) includes this file.
+*/
+
+#ifndef GATEWAY_ENERGIA_TRANSPORT_H_
+#define GATEWAY_ENERGIA_TRANSPORT_H_
+
+#include <Energia.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+#include "boot_sequence.h"
+#include "gateway_config.h"
+#include "gateway_log.h"
+#include "gateway_transport.h"
+#include "tx_pacer.h"
+
+namespace gw {
+
+// Receives and sends nothing until begin() has bound the port, so the
+// gateway can be polled while Wi-Fi is still coming up.
+class EnergiaUdpTransport : public DatagramTransport {
+ public:
+  explicit EnergiaUdpTransport(WiFiUDP& udp) : udp_(udp), open_(false) {}
+
+  bool begin(uint16_t port) {
+    open_ = udp_.begin(port) != 0;
+    return open_;
+  }
+
+  virtual size_t receive(uint8_t* buf, size_t cap, Endpoint* from) {
+    if (!open_) {
+      return 0;
+    }
+    int packetSize = udp_.parsePacket();
+    if (packetSize <= 0) {
+      return 0;
+    }
+    IPAddress ip = udp_.remoteIP();
+    from->ip = ((uint32_t)ip[0] << 24) | ((uint32_t)ip[1] << 16) |
+               ((uint32_t)ip[2] << 8) | (uint32_t)ip[3];
+    from->port = udp_.remotePort();
+
+    int len = udp_.read(buf, cap);
+    return len > 0 ? (size_t)len : 0;
+  }
+
+  virtual bool send(const Endpoint& to, const uint8_t* data, size_t len) {
+    if (!open_) {
+      return false;
+    }
+    IPAddress ip((uint8_t)(to.ip >> 24), (uint8_t)(to.ip >> 16),
+                 (uint8_t)(to.ip >> 8), (uint8_t)to.ip);
+    udp_.beginPacket(ip, to.port);
+    udp_.write(data, len);
+    return udp_.endPacket() != 0;
+  }
+
+ private:
+  WiFiUDP& udp_;
+  bool open_;
+};
+
+// Brings up the CC3200 access point for BootSequence. beginNetwork()
+// itself still blocks while the network processor restarts in AP mode;
+// only the wait for the address is polled.
+class EnergiaAccessPoint : public NetworkBringUp {
+ public:
+  EnergiaAccessPoint(char* ssid, char* password, EnergiaUdpTransport& udp,
+                     uint16_t port)
+      : ssid_(ssid), password_(password), udp_(udp), port_(port) {}
+
+  virtual void startAccessPoint() { WiFi.beginNetwork(ssid_, password_); }
+
+  virtual bool hasAddress() { return WiFi.localIP() != INADDR_NONE; }
+
+  virtual bool openSocket() { return udp_.begin(port_); }
+
+ private:
+  char* ssid_;
+  char* password_;
+  EnergiaUdpTransport& udp_;
+  uint16_t port_;
+};
+
+class EnergiaSerialPort : public SerialPort {
+ public:
+  explicit EnergiaSerialPort(HardwareSerial& serial)
+      : serial_(serial), pacer_(GW_UART_BAUD, GW_UART_TX_FIFO) {}
+
+  virtual size_t available() {
+    int n = serial_.available();
+    return n > 0 ? (size_t)n : 0;
+  }
+
+  virtual size_t read(uint8_t* buf, size_t cap) {
+    size_t n = available();
+    if (n > cap) {
+      n = cap;
+    }
+    // Only asks for bytes already in the RX buffer, so readBytes() never
+    // waits for its timeout.
+    return n > 0 ? serial_.readBytes((char*)buf, n) : 0;
+  }
+
+  // HardwareSerial can't report free TX space, so it is paced by baud.
+  virtual size_t writable() { return pacer_.writable(::micros()); }
+
+  virtual size_t write(const uint8_t* data, size_t len) {
+    size_t n = serial_.write(data, len);
+    pacer_.wrote(n);
+    return n;
+  }
+
+ private:
+  HardwareSerial& serial_;
+  TxPacer pacer_;
+};
+
+// Sleeps until the next interrupt. The UART RX interrupt ends the sleep as
+// soon as the C2000 sends; datagrams are noticed at the latest on the next
+// 1 ms tick, as the network processor is polled rather than interrupting
+// for every packet. Timeouts shorter than a tick return at once.
+class EnergiaIdleWaiter : public IdleWaiter {
+ public:
+  explicit EnergiaIdleWaiter(HardwareSerial& serial) : serial_(serial) {}
+
+  virtual void wait(uint32_t timeout_us) {
+    if (timeout_us < 1000 || serial_.available() > 0) {
+      return;
+    }
+    __asm__ volatile("wfi");
+  }
+
+ private:
+  HardwareSerial& serial_;
+};
+
+class EnergiaClock : public Clock {
+ public:
+  virtual uint32_t micros() { return ::micros(); }
+};
+
+// Prints log records on the debug console, one line each.
+class SerialLogSink : public LogSink {
+ public:
+  explicit SerialLogSink(HardwareSerial& serial) : serial_(serial) {}
+
+  virtual void write(const LogRecord& record) {
+    char line[64];
+    formatLogRecord(record, line, sizeof(line));
+    serial_.println(line);
+  }
+
+ private:
+  HardwareSerial& serial_;
+};
+
+}  // namespace gw
+
+#endif  // GATEWAY_ENERGIA_TRANSPORT_H_
@@ -0,0 +1,151 @@
+#include "frame_scanner.h"
+
+#include "frame_span.h"
+#include "gateway_config.h"
+
+namespace gw {
+
+FrameScanner::FrameScanner(SpscRing& ring, uint8_t* scratch, size_t max_frame,
+                           FrameMode mode)
+    : ring_(ring),
+      scratch_(scratch),
+      max_frame_(max_frame),
+      mode_(mode),
+      in_frame_(false),
+      scanned_(0),
+      pending_(0),
+      overflow_resets_(0) {}
+
+size_t FrameScanner::find(size_t from, size_t to, uint8_t a,
+                          uint8_t b) const {
+  while (from < to) {
+    const uint8_t* span;
+    size_t n = ring_.readSpan(from, &span);
+    if (n > to - from) {
+      n = to - from;
+    }
+    size_t hit = findDelimiter(span, n, a, b);
+    if (hit < n) {
+      return from + hit;
+    }
+    from += n;
+  }
+  return to;
+}
+
+void FrameScanner::drop(size_t n) {
+  ring_.consume(n);
+  in_frame_ = false;
+  scanned_ = 0;
+}
+
+bool FrameScanner::next(FrameView* frame) {
+  release();
+  return mode_ == kFrameCobs ? nextCobs(frame) : nextStxEtx(frame);
+}
+
+bool FrameScanner::nextStxEtx(FrameView* frame) {
+  for (;;) {
+    size_t avail = ring_.readable();
+
+    if (!in_frame_) {
+      // Discard line noise up to the next STX
+      size_t stx = find(0, avail, GW_STX, GW_STX);
+      ring_.consume(stx);
+      if (stx == avail) {
+        return false;
+      }
+      avail -= stx;
+      in_frame_ = true;
+      scanned_ = 1;
+    }
+
+    // One pass for whichever delimiter comes first
+    size_t etx = find(scanned_, avail, GW_STX, GW_ETX);
+    if (etx < avail && ring_.at(etx) == GW_STX) {
+      // A new STX before the ETX: the partial frame is abandoned
+      if (etx >= max_frame_) {
+        overflow_resets_++;
+      }
+      ring_.consume(etx);
+      scanned_ = 1;
+      continue;
+    }
+
+    if (etx == avail) {
+      // Incomplete frame; remember how far we looked
+      scanned_ = avail;
+      if (avail >= max_frame_) {
+        // No room left for the ETX: something is wrong, resynchronize
+        drop(avail);
+        overflow_resets_++;
+      }
+      return false;
+    }
+
+    size_t len = etx + 1;
+    if (len > max_frame_) {
+      drop(len);
+      overflow_resets_++;
+      continue;
+    }
+    if (len == 2) {
+      // Ensure the frame is not empty
+      drop(len);
+      continue;
+    }
+
+    emit(len, frame);
+    return true;
+  }
+}
+
+bool FrameScanner::nextCobs(FrameView* frame) {
+  for (;;) {
+    size_t avail = ring_.readable();
+    size_t end = find(scanned_, avail, 0x00, 0x00);
+    if (end == avail) {
+      scanned_ = avail;
+      if (avail >= max_frame_) {
+        drop(avail);
+        overflow_resets_++;
+      }
+      return false;
+    }
+
+    size_t len = end + 1;
+    if (len > max_frame_) {
+      drop(len);
+      overflow_resets_++;
+      continue;
+    }
+    if (len == 1) {
+      drop(len);
+      continue;
+    }
+    emit(len, frame);
+    return true;
+  }
+}
+
+// Hands out the len bytes at the read position, in place if contiguous.
+void FrameScanner::emit(size_t len, FrameView* frame) {
+  const uint8_t* span;
+  if (ring_.readSpan(0, &span) >= len) {
+    frame->data = span;
+  } else {
+    ring_.copyOut(0, scratch_, len);
+    frame->data = scratch_;
+  }
+  frame->len = len;
+  pending_ = len;
+}
+
+void FrameScanner::release() {
+  if (pending_ > 0) {
+    drop(pending_);
+    pending_ = 0;
+  }
+}
+
+}  // namespace gw
@@ -0,0 +1,77 @@
+/*
+  Frame extraction over an SpscRing: legacy STX/ETX text frames or binary
+  COBS frames terminated by 0x00 (wire_protocol.h).
+
+  Delimiters are located with findDelimiter() (frame_span.h) over
+  contiguous spans of the ring, so payload bytes are never inspected one
+  at a time; STX and ETX are found in a single pass. A complete frame
+  is handed out as a view straight into the ring storage; only a frame that
+  straddles the end of the ring is copied (two memcpy calls) into a scratch
+  buffer.
+
+  STX/ETX framing rules match the original loop():
+  - STX starts a frame; a second STX before ETX restarts it.
+  - ETX completes a non-empty frame. Empty STX ETX pairs are skipped.
+  - Bytes outside STX ... ETX are discarded.
+  - A frame longer than max_frame (delimiters included) is dropped and the
+    scanner resynchronizes on the next STX.
+
+  In COBS mode a frame is everything up to and including the next 0x00;
+  empty frames are skipped and overlong ones dropped the same way.
+*/
+
+#ifndef GATEWAY_FRAME_SCANNER_H_
+#define GATEWAY_FRAME_SCANNER_H_
+
+#include "ring_buffer.h"
+
+namespace gw {
+
+enum FrameMode {
+  kFrameStxEtx,
+  kFrameCobs,
+};
+
+// A complete frame including its delimiters.
+struct FrameView {
+  const uint8_t* data;
+  size_t len;
+};
+
+class FrameScanner {
+ public:
+  // scratch must hold max_frame bytes.
+  FrameScanner(SpscRing& ring, uint8_t* scratch, size_t max_frame,
+               FrameMode mode = kFrameStxEtx);
+
+  // Finds the next complete frame. The view stays valid until release(),
+  // which must be called before the next call to next().
+  bool next(FrameView* frame);
+
+  // Returns the bytes of the last frame to the producer.
+  void release();
+
+  uint32_t overflowResets() const { return overflow_resets_; }
+
+ private:
+  // Offset of the first byte equal to a or b in [from, to), or to if none.
+  size_t find(size_t from, size_t to, uint8_t a, uint8_t b) const;
+  void drop(size_t n);
+  bool nextStxEtx(FrameView* frame);
+  bool nextCobs(FrameView* frame);
+  void emit(size_t len, FrameView* frame);
+
+  SpscRing& ring_;
+  uint8_t* scratch_;
+  size_t max_frame_;
+  FrameMode mode_;
+
+  bool in_frame_;     // The byte at the read position is an STX
+  size_t scanned_;    // Bytes past the read position known to hold no ETX
+  size_t pending_;    // Length of the frame handed out by next()
+  uint32_t overflow_resets_;
+};
+
+}  // namespace gw
+
+#endif  // GATEWAY_FRAME_SCANNER_H_
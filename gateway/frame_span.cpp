@@ -0,0 +1,108 @@
+#include "frame_span.h"
+
+#include <string.h>
+
+#include "gateway_config.h"
+
+#if defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#define GW_SCAN_X86 1
+#include <immintrin.h>
+#else
+#define GW_SCAN_X86 0
+#endif
+
+namespace gw {
+
+namespace {
+
+inline uint32_t hasZeroByte(uint32_t v) {
+  return (v - 0x01010101UL) & ~v & 0x80808080UL;
+}
+
+#if GW_SCAN_X86
+
+size_t findSse2(const uint8_t* data, size_t len, uint8_t a, uint8_t b) {
+  const __m128i va = _mm_set1_epi8((char)a);
+  const __m128i vb = _mm_set1_epi8((char)b);
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+    int mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+    if (mask != 0) {
+      return i + (size_t)__builtin_ctz((unsigned)mask);
+    }
+  }
+  return i + findDelimiterScalar(data + i, len - i, a, b);
+}
+
+__attribute__((target("avx2"))) size_t findAvx2(const uint8_t* data,
+                                                size_t len, uint8_t a,
+                                                uint8_t b) {
+  const __m256i va = _mm256_set1_epi8((char)a);
+  const __m256i vb = _mm256_set1_epi8((char)b);
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+    unsigned mask = (unsigned)_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)));
+    if (mask != 0) {
+      return i + (size_t)__builtin_ctz(mask);
+    }
+  }
+  return i + findSse2(data + i, len - i, a, b);
+}
+
+bool haveAvx2() {
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  return avx2;
+}
+
+#endif  // GW_SCAN_X86
+
+}  // namespace
+
+size_t findDelimiterScalar(const uint8_t* data, size_t len, uint8_t a,
+                           uint8_t b) {
+  // Four bytes per step: a word has a match if it has a zero byte after
+  // XOR with either value repeated.
+  const uint32_t ra = 0x01010101UL * a;
+  const uint32_t rb = 0x01010101UL * b;
+  size_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    uint32_t w;
+    memcpy(&w, data + i, 4);
+    if (hasZeroByte(w ^ ra) | hasZeroByte(w ^ rb)) {
+      break;
+    }
+  }
+  for (; i < len; i++) {
+    if (data[i] == a || data[i] == b) {
+      return i;
+    }
+  }
+  return len;
+}
+
+size_t findDelimiter(const uint8_t* data, size_t len, uint8_t a, uint8_t b) {
+  if (a == b) {
+    // The C library's memchr is at least as fast for a single value
+    const void* hit = memchr(data, a, len);
+    return hit ? (size_t)((const uint8_t*)hit - data) : len;
+  }
+#if GW_SCAN_X86
+  return haveAvx2() ? findAvx2(data, len, a, b) : findSse2(data, len, a, b);
+#else
+  return findDelimiterScalar(data, len, a, b);
+#endif
+}
+
+const char* findDelimiterKind() {
+#if GW_SCAN_X86
+  return haveAvx2() ? "avx2" : "sse2";
+#else
+  return "scalar";
+#endif
+}
+
+}  // namespace gw
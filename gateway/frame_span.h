@@ -0,0 +1,35 @@
+/*
+  Delimiter search over a contiguous buffer.
+
+  findDelimiter() returns the first byte equal to either of two values:
+  32 bytes per step with AVX2, 16 with SSE2 (chosen at run time on x86),
+  4 with a word-at-a-time scalar loop everywhere else, including the
+  CC3200. STX/ETX framing needs both delimiters at once; a single pass
+  with this replaces a memchr for each. A search for one value (a == b)
+  goes to memchr.
+
+  FrameScanner (frame_scanner.h) uses it to find frames in the UART ring.
+*/
+
+#ifndef GATEWAY_FRAME_SPAN_H_
+#define GATEWAY_FRAME_SPAN_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace gw {
+
+// Offset of the first byte in data[0, len) equal to a or b, or len.
+size_t findDelimiter(const uint8_t* data, size_t len, uint8_t a, uint8_t b);
+
+// The portable implementation, for comparison in benchmarks.
+size_t findDelimiterScalar(const uint8_t* data, size_t len, uint8_t a,
+                           uint8_t b);
+
+// Name of the implementation findDelimiter() uses: "avx2", "sse2" or
+// "scalar".
+const char* findDelimiterKind();
+
+}  // namespace gw
+
+#endif  // GATEWAY_FRAME_SPAN_H_
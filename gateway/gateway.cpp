@@ -0,0 +1,654 @@
+#include "gateway.h"
+
+#include <string.h>
+
+namespace gw {
+
+namespace {
+
+// Log payloads without their STX/ETX so the record keeps useful bytes.
+inline void stripDelimiters(const uint8_t** data, size_t* len) {
+  if (*len >= 2 && (*data)[0] == GW_STX && (*data)[*len - 1] == GW_ETX) {
+    (*data)++;
+    *len -= 2;
+  }
+}
+
+}  // namespace
+
+Gateway::Gateway(DatagramTransport& udp, SerialPort& uart, Clock& clock,
+                 LogSink* log)
+    : udp_(udp),
+      uart_(uart),
+      clock_(clock),
+      log_(clock, log),
+      scheduler_(clock),
+      waiter_(0),
+      held_move_len_(0),
+      held_move_binary_(false),
+      held_move_msg_(),
+      held_move_rx_us_(0),
+      uart_ring_(uart_storage_, sizeof(uart_storage_)),
+      scanner_(uart_ring_, frame_scratch_, sizeof(frame_scratch_),
+               GW_UART_BINARY ? kFrameCobs : kFrameStxEtx),
+      uart_arrival_next_(0),
+      batch_max_bytes_(GW_BATCH_MAX_BYTES),
+      batch_hold_us_(GW_BATCH_HOLD_US),
+      uart_seq_(0),
+      telemetry_seq_(0),
+      rx_us_(0),
+      awake_us_(0),
+      idle_us_(0),
+      uptime_mark_(clock.micros()),
+      uptime_us_(0),
+      uptime_ms_(0) {
+  memset(uart_arrivals_, 0, sizeof(uart_arrivals_));
+  memset(&counters_, 0, sizeof(counters_));
+  command_latency_.clear();
+  telemetry_latency_.clear();
+
+  scheduler_.add(udpInTask, this, GW_TASK_UDP_IN_US, 0, false);
+  scheduler_.add(uartOutTask, this, GW_TASK_UART_OUT_US, 0, false);
+  scheduler_.add(uartInTask, this, GW_TASK_UART_IN_US, 0, false);
+  scheduler_.add(housekeepingTask, this, GW_TASK_HOUSEKEEPING_US,
+                 GW_HOUSEKEEPING_PERIOD_US, false);
+  scheduler_.add(statsTask, this, GW_TASK_STATS_US, 0, true);
+}
+
+void Gateway::stats(StatsSnapshot* out) const {
+  // Plus the time since the last housekeeping turn
+  out->uptime_ms =
+      uptime_ms_ + (uptime_us_ + (clock_.micros() - uptime_mark_)) / 1000;
+  out->counters = counters_;
+  out->command = command_latency_;
+  out->telemetry = telemetry_latency_;
+  out->loop = scheduler_.loopTime();
+  for (int i = 0; i < kTaskCount; i++) {
+    out->tasks[i] = scheduler_.taskStats(i);
+  }
+}
+
+void Gateway::configureBatching(size_t max_bytes, uint32_t hold_us) {
+  for (int i = 0; i < SessionTable::capacity(); i++) {
+    flushBatch(i);
+  }
+  batch_max_bytes_ = max_bytes;
+  batch_hold_us_ = hold_us;
+}
+
+bool Gateway::poll() {
+  uint32_t start = clock_.micros();
+  bool busy = scheduler_.runOnce();
+  uint32_t now = clock_.micros();
+  addTime(&awake_us_, &counters_.awake_ms, now - start);
+  if (!busy && waiter_ != 0) {
+    uint32_t timeout = idleTimeout(now);
+    if (timeout > 0) {
+      waiter_->wait(timeout);
+      addTime(&idle_us_, &counters_.idle_ms, clock_.micros() - now);
+    }
+  }
+  return busy;
+}
+
+// How long an idle loop may sleep: until the next periodic task, batch
+// flush or, while commands are queued, roughly one UART character.
+uint32_t Gateway::idleTimeout(uint32_t now) const {
+  uint32_t wait = scheduler_.untilDue(now, GW_IDLE_MAX_US);
+  if (!tx_queue_.empty() && wait > GW_IDLE_TX_WAIT_US) {
+    wait = GW_IDLE_TX_WAIT_US;
+  }
+  if (batch_hold_us_ > 0) {
+    for (int i = 0; i < SessionTable::capacity(); i++) {
+      if (batches_[i].empty()) {
+        continue;
+      }
+      uint32_t age = now - batches_[i].oldestUs();
+      uint32_t left = age < batch_hold_us_ ? batch_hold_us_ - age : 0;
+      if (left < wait) {
+        wait = left;
+      }
+    }
+  }
+  return wait;
+}
+
+void Gateway::addTime(uint32_t* us, uint32_t* ms, uint32_t elapsed_us) {
+  *us += elapsed_us;
+  *ms += *us / 1000;
+  *us %= 1000;
+}
+
+// --- Tasks ---
+bool Gateway::udpInTask(void* self, uint32_t deadline_us) {
+  return ((Gateway*)self)->pollUdp(deadline_us);
+}
+
+bool Gateway::uartOutTask(void* self, uint32_t deadline_us) {
+  (void)deadline_us;  // Bounded by uart_.writable() instead
+  return ((Gateway*)self)->drainUart();
+}
+
+bool Gateway::uartInTask(void* self, uint32_t deadline_us) {
+  return ((Gateway*)self)->pollUart(deadline_us);
+}
+
+bool Gateway::housekeepingTask(void* self, uint32_t deadline_us) {
+  (void)deadline_us;
+  Gateway* g = (Gateway*)self;
+  g->updateUptime();
+  g->expireSessions();
+  return false;
+}
+
+bool Gateway::statsTask(void* self, uint32_t deadline_us) {
+  (void)deadline_us;
+  Gateway* g = (Gateway*)self;
+  g->updateCounters();
+  // Reports work while records are left, so the loop doesn't sleep on them
+  return g->log_.drain(GW_LOG_DRAIN_PER_IDLE) > 0;
+}
+
+// --- Path 1: App -> C2000 (UDP -> UART) ---
+// Drains the datagram backlog (up to GW_UDP_DRAIN_MAX, or until the
+// deadline), then writes the newest move it contained. At least one
+// datagram is read per turn.
+bool Gateway::pollUdp(uint32_t deadline_us) {
+  bool got = false;
+  for (int n = 0; n < GW_UDP_DRAIN_MAX && receiveCommands(); n++) {
+    got = true;
+    if (pastDeadline(clock_, deadline_us)) {
+      break;
+    }
+  }
+  flushHeldMove();
+  return got;
+}
+
+// Receives and dispatches one datagram. Returns false if none was pending.
+bool Gateway::receiveCommands() {
+  Endpoint from;
+  size_t len = udp_.receive(packet_, GW_PACKET_BUFFER_SIZE, &from);
+  if (len == 0) {
+    return false;
+  }
+
+  rx_us_ = clock_.micros();
+  bool created;
+  int session = sessions_.touch(from, rx_us_, &created);
+  if (session < 0) {
+    counters_.sessions_rejected++;
+    return true;
+  }
+  if (created) {
+    batches_[session].clear();
+    TelemetryPolicy policy = {GW_TELEMETRY_DEFAULT_RATE_HZ,
+                              GW_TELEMETRY_DEFAULT_DEADBAND,
+                              GW_TELEMETRY_DEFAULT_FLAGS};
+    filters_[session].reset(policy);
+    logPeer(kLogNewClient, from);
+  }
+
+  if (wire::isAsciiDatagram(packet_, len)) {
+    sessions_.at(session).binary = false;
+    dispatchCommand(session, classifyAscii(packet_, len), packet_, len, false);
+    return true;
+  }
+
+  // Binary datagrams carry one or more COBS frames, each ending in 0x00.
+  // Terminating the datagram means every frame, including a last one sent
+  // without its terminator, can be written to the UART in place.
+  sessions_.at(session).binary = true;
+  packet_[len] = 0x00;
+  dispatchBinary(session, len);
+  return true;
+}
+
+// Dispatches each frame of a binary datagram in packet_.
+void Gateway::dispatchBinary(int session, size_t len) {
+  size_t start = 0;
+  while (start < len) {
+    const uint8_t* end =
+        static_cast<const uint8_t*>(memchr(packet_ + start, 0x00, len - start));
+    size_t frame_len = end ? (size_t)(end - packet_) - start : len - start;
+    if (frame_len > 0) {
+      const uint8_t* frame = packet_ + start;
+      dispatchCommand(session, classifyBinary(frame, frame_len), frame,
+                      frame_len, true);
+    }
+    start += frame_len + 1;
+  }
+}
+
+// Applies the route of a classified command. frame is a binary frame
+// without its terminator or a whole STX ... ETX frame. A binary frame is
+// checked (CRC, field count) before anything else, so a corrupted one can
+// neither advance the session's seq nor claim the controller.
+void Gateway::dispatchCommand(int session, uint8_t type, const uint8_t* frame,
+                              size_t len, bool binary) {
+  uint8_t route = commandRoute(type);
+  if (!(route & kRouteKnown)) {
+    counters_.malformed++;
+    return;
+  }
+  wire::Message msg;
+  if (binary && !wire::decode(frame, len, &msg)) {
+    counters_.malformed++;
+    return;
+  }
+  const wire::Message* checked = binary ? &msg : 0;
+  bool fresh = !binary || sessions_.advanceSeq(session, msg.seq);
+  if (route & kRouteConsume) {
+    handleLocalCommand(session, type, checked);
+    return;
+  }
+  if ((route & kRouteSequenced) && !fresh) {
+    counters_.stale_commands++;
+    return;
+  }
+  if ((route & kRouteControllerOnly) && !sessions_.claimController(session)) {
+    counters_.dropped_not_controller++;
+    return;
+  }
+  if (route & kRouteLatestWins) {
+    holdMove(frame, len, checked);
+    return;
+  }
+  if (type == wire::kStop) {
+    // Moves held or queued arrived before the stop; they must not follow
+    // it out
+    if (held_move_len_ > 0) {
+      held_move_len_ = 0;
+      counters_.coalesced_moves++;
+    }
+    counters_.coalesced_moves += tx_queue_.clear(kTxNormal);
+    // Start/stops still waiting are moot after it, and clearing them
+    // guarantees the stop room in the priority lane
+    tx_queue_.clear(kTxPriority);
+  }
+  forwardCommand(frame, len, checked,
+                 (route & kRoutePriority) ? kTxPriority : kTxNormal, rx_us_);
+}
+
+// Keeps a move until the end of the iteration, replacing an older one.
+// Arrival order is newest order: stale binary moves were dropped above.
+void Gateway::holdMove(const uint8_t* frame, size_t len,
+                       const wire::Message* msg) {
+  if (held_move_len_ > 0) {
+    counters_.coalesced_moves++;
+  }
+  // Binary frames are followed by their terminator in packet_
+  memcpy(held_move_, frame, msg ? len + 1 : len);
+  held_move_len_ = len;
+  held_move_binary_ = msg != 0;
+  if (msg) {
+    held_move_msg_ = *msg;
+  }
+  held_move_rx_us_ = rx_us_;
+}
+
+void Gateway::flushHeldMove() {
+  if (held_move_len_ == 0) {
+    return;
+  }
+  size_t len = held_move_len_;
+  held_move_len_ = 0;
+  forwardCommand(held_move_, len, held_move_binary_ ? &held_move_msg_ : 0,
+                 kTxNormal, held_move_rx_us_);
+}
+
+// Commands the gateway answers itself. The session has already been
+// refreshed by the datagram that carried them. msg is the checked binary
+// frame, or null for an ASCII one.
+void Gateway::handleLocalCommand(int session, uint8_t type,
+                                 const wire::Message* msg) {
+  switch (type) {
+    case wire::kHeartbeat:
+      counters_.heartbeats++;
+      break;
+    case wire::kPing: {
+      // Echoed right here rather than batched with telemetry, so the
+      // client's round trip includes as little gateway time as possible.
+      counters_.heartbeats++;
+      wire::Message pong = *msg;  // Pings are binary only
+      pong.type = wire::kPong;
+      uint8_t reply[wire::kMaxFrameSize];
+      udp_.send(sessions_.at(session).peer, reply,
+                wire::encode(pong, reply, sizeof(reply)));
+      break;
+    }
+    case wire::kStatsRequest: {
+      StatsSnapshot snapshot;
+      stats(&snapshot);
+      uint8_t reply[kStatsReplySize];
+      udp_.send(sessions_.at(session).peer, reply,
+                encodeStatsReply(snapshot, reply));
+      break;
+    }
+    case wire::kTelemetryPolicy:
+      filters_[session].reset(policyFromMessage(*msg));
+      break;
+    default:
+      break;
+  }
+}
+
+// Queues a command for the UART, transcoding only if the UART speaks the
+// other protocol. checked is the binary frame as dispatchCommand() decoded
+// it, or null for an ASCII frame.
+void Gateway::forwardCommand(const uint8_t* frame, size_t len,
+                             const wire::Message* checked, TxLane lane,
+                             uint32_t rx_us) {
+#if GW_UART_BINARY
+  if (checked) {
+    queueUart(frame, len + 1, lane, rx_us);  // In place, terminator included
+    return;
+  }
+  wire::Message msg;
+  if (!wire::decodeAscii(frame, len, &msg)) {
+    counters_.malformed++;
+    return;
+  }
+  msg.seq = uart_seq_++;
+  uint8_t out[wire::kMaxFrameSize];
+  queueUart(out, wire::encode(msg, out, sizeof(out)), lane, rx_us);
+#else
+  if (!checked) {
+    queueUart(frame, len, lane, rx_us);  // In place
+    return;
+  }
+  uint8_t out[wire::kMaxAsciiSize];
+  queueUart(out, wire::encodeAscii(*checked, out), lane, rx_us);
+#endif
+}
+
+void Gateway::queueUart(const uint8_t* data, size_t len, TxLane lane,
+                        uint32_t rx_us) {
+  if (len == 0) {
+    return;
+  }
+  if (!tx_queue_.push(lane, data, len, rx_us)) {
+    if (len > kTxSlotSize) {
+      counters_.malformed++;  // Longer than any command
+    }
+    counters_.uart_tx_refused = tx_queue_.refused();
+    return;
+  }
+  counters_.uart_tx_dropped = tx_queue_.dropped();
+  drainUart();
+}
+
+// Writes queued commands for as long as the UART takes them without
+// blocking. Returns true if anything was written.
+bool Gateway::drainUart() {
+  size_t room = uart_.writable();
+  bool wrote = false;
+  TxFrame* frame;
+  while (room > 0 && (frame = tx_queue_.front()) != 0) {
+    size_t want = frame->len - frame->sent;
+    size_t n = uart_.write(frame->data + frame->sent, want < room ? want : room);
+    if (n == 0) {
+      break;
+    }
+    wrote = true;
+    room -= n;
+    if (n < want) {
+      tx_queue_.advance(n);
+      continue;
+    }
+    counters_.udp_to_uart++;
+    command_latency_.record(clock_.micros() - frame->rx_us);
+#if GW_LOG_LEVEL >= GW_LOG_DEBUG
+    const uint8_t* payload = frame->data;
+    size_t len = frame->len;
+    stripDelimiters(&payload, &len);
+    GW_LOG_D(log_, kLogUdpToUart, payload, len);
+#endif
+    tx_queue_.advance(n);
+  }
+  return wrote;
+}
+
+// --- Path 2: C2000 -> App (UART -> UDP) ---
+// Forwards complete frames until the deadline; the rest stay in the ring
+// for the next turn. At least one frame is forwarded per turn.
+bool Gateway::pollUart(uint32_t deadline_us) {
+  bool busy = fillUartRing();
+
+  FrameView frame;
+  while (scanner_.next(&frame)) {
+    forwardFrame(frame);
+    busy = true;
+    if (pastDeadline(clock_, deadline_us)) {
+      scanner_.release();
+      break;
+    }
+  }
+  flushDueBatches();
+  return busy;
+}
+
+// Moves everything the UART driver has buffered into the ring in at most
+// two bulk reads (one per contiguous span of free space). Returns true if
+// anything was read.
+bool Gateway::fillUartRing() {
+  bool got = false;
+  for (int pass = 0; pass < 2; pass++) {
+    uint8_t* span;
+    size_t room = uart_ring_.writeSpan(&span);
+    if (room == 0) {
+      break;
+    }
+    size_t n = uart_.read(span, room);
+    if (n > 0 && !got) {
+      markUartArrival(uart_ring_.writePosition(), clock_.micros());
+    }
+    uart_ring_.commit(n);
+    got |= n > 0;
+    if (n < room) {
+      break;
+    }
+  }
+  return got;
+}
+
+// Fans a UART frame out to every live session, controller first. Sessions
+// that speak the other protocol get a converted copy, built once per frame;
+// sessions with a telemetry policy get the frame decoded (once) and
+// re-encoded by their filter.
+void Gateway::forwardFrame(const FrameView& frame) {
+  counters_.uart_frames++;
+  if (!hasClient()) {
+    // Don't forward until we know who the clients are
+    counters_.dropped_no_client++;
+    return;
+  }
+
+  FrameView converted = {0, 0};
+  bool converted_ready = false;
+  wire::Message sample;
+  int sample_state = 0;  // 0 not decoded yet, 1 decoded, -1 undecodable
+  uint32_t now = clock_.micros();
+  // The frame has not been released yet, so it starts at the read position
+  uint32_t rx_us = uartArrivalTime(uart_ring_.readPosition());
+
+  int controller = sessions_.controller();
+  for (int n = -1; n < SessionTable::capacity(); n++) {
+    // n == -1 visits the controller, the loop proper everyone else
+    int i = n < 0 ? controller : n;
+    if (i < 0 || (n >= 0 && i == controller) || !sessions_.at(i).live) {
+      continue;
+    }
+    const Session& s = sessions_.at(i);
+    if (!filters_[i].passThrough()) {
+      if (sample_state == 0) {
+        sample_state = decodeTelemetry(frame, &sample) ? 1 : -1;
+      }
+      size_t len = sample_state > 0
+                       ? filters_[i].filter(sample, s.binary, now,
+                                            telemetry_filtered_,
+                                            sizeof(telemetry_filtered_))
+                       : 0;
+      if (len > 0) {
+        sendTelemetry(i, telemetry_filtered_, len, rx_us);
+      } else {
+        counters_.telemetry_filtered++;
+      }
+      continue;
+    }
+    if (s.binary == (GW_UART_BINARY != 0)) {
+      sendTelemetry(i, frame.data, frame.len, rx_us);
+      continue;
+    }
+    if (!converted_ready) {
+      converted = convertTelemetry(frame);
+      converted_ready = true;
+    }
+    if (converted.len > 0) {
+      sendTelemetry(i, converted.data, converted.len, rx_us);
+    }
+  }
+
+#if GW_LOG_LEVEL >= GW_LOG_DEBUG
+  const uint8_t* payload = frame.data;
+  size_t len = frame.len;
+  stripDelimiters(&payload, &len);
+  GW_LOG_D(log_, kLogUartToUdp, payload, len);
+#endif
+}
+
+// Converts a UART frame to the protocol the UART doesn't speak. Returns an
+// empty view if the frame can't be represented (or is malformed).
+FrameView Gateway::convertTelemetry(const FrameView& frame) {
+  FrameView out = {telemetry_converted_, 0};
+  wire::Message msg;
+#if GW_UART_BINARY
+  if (wire::decode(frame.data, frame.len - 1, &msg)) {
+    out.len = wire::encodeAscii(msg, telemetry_converted_);
+  }
+#else
+  if (wire::decodeAscii(frame.data, frame.len, &msg)) {
+    msg.seq = telemetry_seq_++;
+    out.len = wire::encode(msg, telemetry_converted_,
+                           sizeof(telemetry_converted_));
+  }
+#endif
+  return out;
+}
+
+// Decodes a UART telemetry frame for the filters. Returns false for
+// anything that isn't four-field telemetry.
+bool Gateway::decodeTelemetry(const FrameView& frame, wire::Message* msg) {
+#if GW_UART_BINARY
+  bool ok = wire::decode(frame.data, frame.len - 1, msg);
+#else
+  bool ok = wire::decodeAscii(frame.data, frame.len, msg);
+#endif
+  return ok && msg->type == wire::kTelemetry;
+}
+
+// Sends a frame that arrived at rx_us to a session now, or adds it to the
+// session's batch.
+void Gateway::sendTelemetry(int session, const uint8_t* data, size_t len,
+                            uint32_t rx_us) {
+  DatagramBatcher& batch = batches_[session];
+  if (batch_hold_us_ > 0) {
+    if (!batch.fits(len, batch_max_bytes_)) {
+      flushBatch(session);
+    }
+    if (batch.add(data, len, rx_us)) {
+      if (!batch.fits(1, batch_max_bytes_)) {
+        flushBatch(session);
+      }
+      return;
+    }
+  }
+  // Batching off, or a frame too big to batch at all
+  udp_.send(sessions_.at(session).peer, data, len);
+  counters_.uart_to_udp++;
+  telemetry_latency_.record(clock_.micros() - rx_us);
+}
+
+void Gateway::flushBatch(int session) {
+  DatagramBatcher& batch = batches_[session];
+  if (batch.empty()) {
+    return;
+  }
+  if (sessions_.at(session).live) {
+    udp_.send(sessions_.at(session).peer, batch.data(), batch.size());
+    counters_.uart_to_udp++;
+    telemetry_latency_.record(clock_.micros() - batch.oldestUs());
+  }
+  batch.clear();
+}
+
+void Gateway::flushDueBatches() {
+  if (batch_hold_us_ == 0) {
+    return;
+  }
+  uint32_t now = clock_.micros();
+  for (int i = 0; i < SessionTable::capacity(); i++) {
+    if (batches_[i].due(now, batch_hold_us_)) {
+      flushBatch(i);
+    }
+  }
+}
+
+void Gateway::markUartArrival(uint32_t pos, uint32_t now) {
+  uart_arrivals_[uart_arrival_next_].pos = pos;
+  uart_arrivals_[uart_arrival_next_].us = now;
+  uart_arrival_next_ = (uart_arrival_next_ + 1) % kUartArrivals;
+}
+
+// Time of the newest read that started at or before ring position pos. A
+// byte older than every mark gets the oldest one, understating its wait.
+uint32_t Gateway::uartArrivalTime(uint32_t pos) const {
+  int i = uart_arrival_next_;
+  for (int n = 0; n < kUartArrivals; n++) {
+    i = (i + kUartArrivals - 1) % kUartArrivals;
+    if ((int32_t)(pos - uart_arrivals_[i].pos) >= 0) {
+      return uart_arrivals_[i].us;
+    }
+  }
+  return uart_arrivals_[uart_arrival_next_].us;
+}
+
+void Gateway::expireSessions() {
+  if (sessions_.liveCount() == 0) {
+    return;
+  }
+  uint32_t now = clock_.micros();
+  int expired;
+  while ((expired = sessions_.expireNext(now, GW_SESSION_TIMEOUT_US)) >= 0) {
+    batches_[expired].clear();
+    logPeer(kLogClientExpired, sessions_.at(expired).peer);
+  }
+}
+
+// Counters mirrored from the components that keep their own.
+void Gateway::updateCounters() {
+  if (scanner_.overflowResets() != counters_.overflow_resets) {
+    counters_.overflow_resets = scanner_.overflowResets();
+    GW_LOG_I(log_, kLogOverflowReset, 0, 0);
+  }
+}
+
+void Gateway::updateUptime() {
+  uint32_t now = clock_.micros();
+  addTime(&uptime_us_, &uptime_ms_, now - uptime_mark_);
+  uptime_mark_ = now;
+}
+
+void Gateway::logPeer(uint8_t event, const Endpoint& peer) {
+#if GW_LOG_LEVEL >= GW_LOG_INFO
+  const uint8_t who[6] = {(uint8_t)(peer.ip >> 24), (uint8_t)(peer.ip >> 16),
+                          (uint8_t)(peer.ip >> 8), (uint8_t)peer.ip,
+                          (uint8_t)(peer.port >> 8), (uint8_t)peer.port};
+  GW_LOG_I(log_, event, who, sizeof(who));
+#else
+  (void)event;
+  (void)peer;
+#endif
+}
+
+}  // namespace gw
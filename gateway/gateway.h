@@ -0,0 +1,190 @@
+/*
+  Portable UDP <-> UART forwarding core.
+
+  - Tracks every UDP client in a session table (session_table.h).
+  - Accepts legacy ASCII and binary v1 (wire_protocol.h) commands and
+    writes them to the UART in the protocol it speaks (GW_UART_BINARY).
+  - Routes commands through the table in command_dispatch.h: commands
+    from the controller session go to the UART, "stop" is accepted from
+    any session and heartbeats only keep a session alive.
+  - Queues commands for the UART (uart_tx_queue.h) and writes only what
+    the line can take, start/stop ahead of moves, so neither direction
+    blocks the other.
+  - Runs each direction as a task of a cooperative scheduler
+    (scheduler.h) with its own time budget (GW_TASK_*_US).
+  - Drains pending datagrams each iteration. Binary commands carry
+    sequence numbers; stale ones are dropped and, of the moves received in
+    one iteration, only the newest reaches the UART.
+  - Sleeps between iterations with no traffic when given an IdleWaiter,
+    for no longer than the next timed task, batch flush or UART write.
+  - Forwards all complete UART frames to every live session, controller
+    first, converted to the protocol each session speaks, thinned out per
+    session on request (telemetry_filter.h) and optionally coalesced into
+    fewer datagrams (datagram_batcher.h).
+
+  The same class runs inside the Energia sketch (CC3200_UART.cpp) and inside
+  the Linux simulator (host/gateway_sim.cpp).
+*/
+
+#ifndef GATEWAY_GATEWAY_H_
+#define GATEWAY_GATEWAY_H_
+
+#include "command_dispatch.h"
+#include "datagram_batcher.h"
+#include "frame_scanner.h"
+#include "gateway_config.h"
+#include "gateway_log.h"
+#include "gateway_stats.h"
+#include "gateway_transport.h"
+#include "ring_buffer.h"
+#include "scheduler.h"
+#include "session_table.h"
+#include "telemetry_filter.h"
+#include "uart_tx_queue.h"
+#include "wire_protocol.h"
+
+namespace gw {
+
+class Gateway {
+ public:
+  // log may be null; see gateway_log.h for what gets recorded.
+  Gateway(DatagramTransport& udp, SerialPort& uart, Clock& clock,
+          LogSink* log = 0);
+
+  // Runs one iteration of the forwarding loop: one turn of every due task.
+  // Call it from loop(). Queued log records are written only on iterations
+  // with no traffic; with an idle waiter set, such iterations then sleep.
+  // Returns true if any data moved.
+  bool poll();
+
+  // Sleeps through idle iterations with waiter; null busy-polls.
+  void setIdleWaiter(IdleWaiter* waiter) { waiter_ = waiter; }
+
+  // Coalesces telemetry into datagrams of at most max_bytes, holding a
+  // frame for at most hold_us. hold_us == 0 sends every frame on its own.
+  void configureBatching(size_t max_bytes, uint32_t hold_us);
+
+  // The gateway's logger, for components that report through it
+  // (boot_sequence.h).
+  Logger& logger() { return log_; }
+
+  bool hasClient() const { return sessions_.liveCount() > 0; }
+  const SessionTable& sessions() const { return sessions_; }
+  const GatewayCounters& counters() const { return counters_; }
+
+  // Counters, latency histograms and task timings, as sent in reply to a
+  // stats request.
+  void stats(StatsSnapshot* out) const;
+
+ private:
+  // Scheduler tasks, in GatewayTask order; context is the Gateway.
+  static bool udpInTask(void* self, uint32_t deadline_us);
+  static bool uartOutTask(void* self, uint32_t deadline_us);
+  static bool uartInTask(void* self, uint32_t deadline_us);
+  static bool housekeepingTask(void* self, uint32_t deadline_us);
+  static bool statsTask(void* self, uint32_t deadline_us);
+
+  // Each returns true if it moved any data.
+  bool pollUdp(uint32_t deadline_us);
+  bool receiveCommands();
+  bool pollUart(uint32_t deadline_us);
+  bool fillUartRing();
+  void dispatchBinary(int session, size_t len);
+  void dispatchCommand(int session, uint8_t type, const uint8_t* frame,
+                       size_t len, bool binary);
+  void handleLocalCommand(int session, uint8_t type,
+                          const wire::Message* msg);
+  void holdMove(const uint8_t* frame, size_t len, const wire::Message* msg);
+  void flushHeldMove();
+  void forwardCommand(const uint8_t* frame, size_t len,
+                      const wire::Message* checked, TxLane lane,
+                      uint32_t rx_us);
+  void queueUart(const uint8_t* data, size_t len, TxLane lane, uint32_t rx_us);
+  bool drainUart();
+  void forwardFrame(const FrameView& frame);
+  FrameView convertTelemetry(const FrameView& frame);
+  bool decodeTelemetry(const FrameView& frame, wire::Message* msg);
+  void sendTelemetry(int session, const uint8_t* data, size_t len,
+                     uint32_t rx_us);
+  void flushBatch(int session);
+  void flushDueBatches();
+  void markUartArrival(uint32_t pos, uint32_t now);
+  uint32_t uartArrivalTime(uint32_t pos) const;
+  void expireSessions();
+  void updateCounters();
+  void updateUptime();
+  uint32_t idleTimeout(uint32_t now) const;
+  void addTime(uint32_t* us, uint32_t* ms, uint32_t elapsed_us);
+  void logPeer(uint8_t event, const Endpoint& peer);
+
+  DatagramTransport& udp_;
+  SerialPort& uart_;
+  Clock& clock_;
+  Logger log_;
+  Scheduler scheduler_;
+  IdleWaiter* waiter_;
+
+  SessionTable sessions_;
+
+  // One byte longer than a datagram may be, for a terminator (pollUdp()).
+  uint8_t packet_[GW_PACKET_BUFFER_SIZE + 1];
+
+  // The newest move of this iteration, written to the UART once the
+  // datagram backlog has been drained (binary frames keep their 0x00).
+  uint8_t held_move_[GW_PACKET_BUFFER_SIZE + 1];
+  size_t held_move_len_;  // 0 when nothing is held
+  bool held_move_binary_;
+  wire::Message held_move_msg_;  // Decoded frame, if binary
+  uint32_t held_move_rx_us_;
+
+  // Commands waiting for room in the UART transmitter.
+  UartTxQueue tx_queue_;
+
+  // UART receive path: bulk reads into the ring, frames scanned in place.
+  uint8_t uart_storage_[GW_UART_RING_SIZE];
+  uint8_t frame_scratch_[GW_UART_FRAME_SIZE];
+  SpscRing uart_ring_;
+  FrameScanner scanner_;
+
+  // When recent UART reads landed, by ring write position, so a frame can
+  // be traced back to the read that brought in its first byte.
+  struct UartArrival {
+    uint32_t pos;
+    uint32_t us;
+  };
+  static const int kUartArrivals = 8;
+  UartArrival uart_arrivals_[kUartArrivals];
+  int uart_arrival_next_;
+
+  // Telemetry converted for sessions speaking the other protocol.
+  uint8_t telemetry_converted_[wire::kMaxAsciiSize > wire::kMaxFrameSize
+                                   ? wire::kMaxAsciiSize
+                                   : wire::kMaxFrameSize];
+  // Telemetry policy per session, and a frame re-encoded under it.
+  TelemetryFilter filters_[GW_MAX_SESSIONS];
+  uint8_t telemetry_filtered_[sizeof(telemetry_converted_)];
+  // Telemetry batching, one pending datagram per session.
+  DatagramBatcher batches_[GW_MAX_SESSIONS];
+  size_t batch_max_bytes_;
+  uint32_t batch_hold_us_;
+
+  uint16_t uart_seq_;       // Binary frames the gateway writes to the UART
+  uint16_t telemetry_seq_;  // Binary telemetry the gateway generates
+
+  GatewayCounters counters_;
+  uint32_t rx_us_;  // When the datagram in packet_ was received
+  uint32_t awake_us_;  // Sub-millisecond remainders of the time counters
+  uint32_t idle_us_;
+
+  // Time since construction, accumulated by the housekeeping task so it
+  // survives the wrap of the u32 microsecond clock (~71.6 minutes).
+  uint32_t uptime_mark_;  // Clock reading up to which uptime is counted
+  uint32_t uptime_us_;    // Sub-millisecond remainder
+  uint32_t uptime_ms_;
+  LatencyHistogram command_latency_;
+  LatencyHistogram telemetry_latency_;
+};
+
+}  // namespace gw
+
+#endif  // GATEWAY_GATEWAY_H_
@@ -0,0 +1,219 @@
+/*
+  Compile-time configuration for the UDP <-> UART gateway core.
+
+  Every value can be overridden with -D on the compiler command line (host
+  build). Energia compiles the gateway sources separately from the sketch,
+  so for the firmware edit the defaults here rather than defining them in
+  CC3200_UART.cpp.
+*/
+
+#ifndef GATEWAY_CONFIG_H_
+#define GATEWAY_CONFIG_H_
+
+// --- Network ---
+#ifndef GW_UDP_PORT
+#define GW_UDP_PORT 8080
+#endif
+
+// Datagrams read per loop iteration. All pending commands are drained so a
+// backlog collapses to its newest move, but a flood can't starve the UART
+// direction indefinitely.
+#ifndef GW_UDP_DRAIN_MAX
+#define GW_UDP_DRAIN_MAX 16
+#endif
+
+// --- Sessions ---
+// Clients tracked at once (controller plus observers).
+#ifndef GW_MAX_SESSIONS
+#define GW_MAX_SESSIONS 4
+#endif
+
+// A session silent for this long expires. An idle app still sends a
+// heartbeat (or ping) every 250 ms (CommandSchedulerConfig.keepalive), so
+// it takes about 12 lost in a row to expire a live client.
+#ifndef GW_SESSION_TIMEOUT_US
+#define GW_SESSION_TIMEOUT_US 3000000UL
+#endif
+
+// Binary commands whose sequence number is at most this far behind the
+// newest one from the same session are stale and dropped. Anything further
+// behind means the sender restarted its counter.
+#ifndef GW_SEQ_WINDOW
+#define GW_SEQ_WINDOW 1024
+#endif
+
+// --- Telemetry batching ---
+// UART frames for a session are coalesced into one datagram until adding
+// the next would exceed GW_BATCH_MAX_BYTES or the oldest has waited
+// GW_BATCH_HOLD_US. A hold time of 0 sends every frame immediately, as the
+// original gateway did. Both can be changed at run time with
+// Gateway::configureBatching().
+#ifndef GW_BATCH_BUFFER_SIZE
+#define GW_BATCH_BUFFER_SIZE 512
+#endif
+
+#ifndef GW_BATCH_MAX_BYTES
+#define GW_BATCH_MAX_BYTES 256
+#endif
+
+#ifndef GW_BATCH_HOLD_US
+#define GW_BATCH_HOLD_US 0
+#endif
+
+// --- Telemetry policy ---
+// Policy of a session that hasn't sent a kTelemetryPolicy frame
+// (telemetry_filter.h). All 0 forwards every frame unchanged.
+#ifndef GW_TELEMETRY_DEFAULT_RATE_HZ
+#define GW_TELEMETRY_DEFAULT_RATE_HZ 0
+#endif
+
+#ifndef GW_TELEMETRY_DEFAULT_DEADBAND
+#define GW_TELEMETRY_DEFAULT_DEADBAND 0
+#endif
+
+#ifndef GW_TELEMETRY_DEFAULT_FLAGS
+#define GW_TELEMETRY_DEFAULT_FLAGS 0
+#endif
+
+// A deadband session gets a frame at least this often even if nothing
+// changed, so it can tell a quiet C2000 from a dead link.
+#ifndef GW_TELEMETRY_REFRESH_US
+#define GW_TELEMETRY_REFRESH_US 1000000UL
+#endif
+
+// With delta encoding, every n-th frame is sent in full.
+#ifndef GW_TELEMETRY_KEYFRAME_INTERVAL
+#define GW_TELEMETRY_KEYFRAME_INTERVAL 16
+#endif
+
+// --- UART link to the C2000 ---
+#ifndef GW_UART_BAUD
+#define GW_UART_BAUD 100000
+#endif
+
+// Transmit buffer of the Serial1 driver in bytes. The gateway never writes
+// more than the line can have drained into it, so Serial1.write() doesn't
+// block (tx_pacer.h).
+#ifndef GW_UART_TX_FIFO
+#define GW_UART_TX_FIFO 64
+#endif
+
+// Commands waiting for the UART, per lane (start/stop, moves). When the
+// move lane is full its oldest waiting move is dropped; a full start/stop
+// lane refuses new starts instead (uart_tx_queue.h).
+#ifndef GW_UART_TX_SLOTS
+#define GW_UART_TX_SLOTS 4
+#endif
+
+// Protocol spoken on the UART. 0: legacy ASCII STX/ETX text, which is what
+// the C2000 Simulink model in this repo expects; binary commands from the
+// app are converted to text. 1: binary v1 frames (wire_protocol.h) in both
+// directions, for C2000 firmware that speaks the binary protocol.
+#ifndef GW_UART_BINARY
+#define GW_UART_BINARY 0
+#endif
+
+// --- Scheduler ---
+// Time budget per turn of each loop task, in microseconds (scheduler.h).
+// A task stops at the first unit of work (datagram, UART frame) that ends
+// past its budget and picks up the rest on the next iteration, so the
+// budgets bound how long one direction can hold up the other.
+#ifndef GW_TASK_UDP_IN_US
+#define GW_TASK_UDP_IN_US 1000
+#endif
+
+#ifndef GW_TASK_UART_OUT_US
+#define GW_TASK_UART_OUT_US 200
+#endif
+
+#ifndef GW_TASK_UART_IN_US
+#define GW_TASK_UART_IN_US 1000
+#endif
+
+// Session expiry runs at most once per GW_HOUSEKEEPING_PERIOD_US.
+#ifndef GW_TASK_HOUSEKEEPING_US
+#define GW_TASK_HOUSEKEEPING_US 200
+#endif
+
+#ifndef GW_HOUSEKEEPING_PERIOD_US
+#define GW_HOUSEKEEPING_PERIOD_US 10000
+#endif
+
+// Counter upkeep and log output, on iterations with no traffic only.
+#ifndef GW_TASK_STATS_US
+#define GW_TASK_STATS_US 500
+#endif
+
+// --- Idle ---
+// When 1, the sketch sleeps the CPU on loop iterations with nothing to do
+// until the next interrupt (UART RX, the network processor or the 1 ms
+// tick). When 0 it busy-polls, as the original gateway did.
+#ifndef GW_IDLE_SLEEP
+#define GW_IDLE_SLEEP 1
+#endif
+
+// Longest single sleep. Bounds how late anything without a wake source is
+// noticed.
+#ifndef GW_IDLE_MAX_US
+#define GW_IDLE_MAX_US 10000
+#endif
+
+// Sleep while commands wait for the UART transmitter to drain: about one
+// character at GW_UART_BAUD.
+#ifndef GW_IDLE_TX_WAIT_US
+#define GW_IDLE_TX_WAIT_US 100
+#endif
+
+// --- Startup ---
+// The access point is restarted if it has no IP address this long after
+// being started (boot_sequence.h).
+#ifndef GW_BOOT_AP_TIMEOUT_US
+#define GW_BOOT_AP_TIMEOUT_US 10000000UL
+#endif
+
+// --- Buffers ---
+// Largest UDP datagram accepted from a client.
+#ifndef GW_PACKET_BUFFER_SIZE
+#define GW_PACKET_BUFFER_SIZE 255
+#endif
+
+// Largest UART frame, including its STX/ETX delimiters.
+#ifndef GW_UART_FRAME_SIZE
+#define GW_UART_FRAME_SIZE 255
+#endif
+
+// UART receive ring. Must be a power of two and larger than a frame.
+#ifndef GW_UART_RING_SIZE
+#define GW_UART_RING_SIZE 1024
+#endif
+
+// --- Logging ---
+// GW_LOG_LEVEL selects which log statements are compiled in at all (see
+// gateway_log.h). Per-frame traces are GW_LOG_DEBUG, so the default
+// production build carries no per-packet logging code.
+#ifndef GW_LOG_LEVEL
+#define GW_LOG_LEVEL 2  // GW_LOG_INFO
+#endif
+
+// When 1, log records are queued in RAM and written to the sink only on
+// loop iterations that had nothing to forward. When 0 they are written
+// synchronously, which blocks the loop for the duration of the print.
+#ifndef GW_LOG_DEFERRED
+#define GW_LOG_DEFERRED 1
+#endif
+
+// Records held by the deferred logger; the newest are dropped when full.
+#ifndef GW_LOG_QUEUE_SIZE
+#define GW_LOG_QUEUE_SIZE 32
+#endif
+
+// Records written to the sink per idle loop iteration (stats task).
+#ifndef GW_LOG_DRAIN_PER_IDLE
+#define GW_LOG_DRAIN_PER_IDLE 1
+#endif
+
+// --- Framing ---
+#define GW_STX 0x02
+#define GW_ETX 0x03
+
+#endif  // GATEWAY_CONFIG_H_
@@ -0,0 +1,126 @@
+#include "gateway_log.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace gw {
+
+const char* logEventName(uint8_t event) {
+  switch (event) {
+    case kLogUdpToUart:
+      return "UDP -> UART";
+    case kLogUartToUdp:
+      return "UART -> UDP";
+    case kLogOverflowReset:
+      return "UART overflow reset";
+    case kLogNewClient:
+      return "New client";
+    case kLogClientExpired:
+      return "Client expired";
+    case kLogBootPhase:
+      return "Boot";
+    default:
+      return "?";
+  }
+}
+
+void makeLogRecord(LogRecord* record, uint32_t time_us, uint8_t event,
+                   const uint8_t* data, size_t len) {
+  record->time_us = time_us;
+  record->event = event;
+  record->len = len > 0xff ? 0xff : (uint8_t)len;
+  size_t keep = len < kLogDataSize ? len : kLogDataSize;
+  if (keep > 0) {
+    memcpy(record->data, data, keep);
+  }
+}
+
+size_t formatLogRecord(const LogRecord& record, char* out, size_t cap) {
+  if (cap == 0) {
+    return 0;
+  }
+  int n = snprintf(out, cap, "%lu %s", (unsigned long)record.time_us,
+                   logEventName(record.event));
+  size_t pos = n < 0 ? 0 : (size_t)n;
+  size_t kept = record.len < kLogDataSize ? record.len : kLogDataSize;
+
+  if ((record.event == kLogNewClient || record.event == kLogClientExpired) &&
+      kept == 6) {
+    const uint8_t* d = record.data;
+    n = snprintf(out + (pos < cap ? pos : cap - 1), pos < cap ? cap - pos : 1,
+                 ": %u.%u.%u.%u:%u", d[0], d[1], d[2], d[3],
+                 (unsigned)((d[4] << 8) | d[5]));
+    pos += n < 0 ? 0 : (size_t)n;
+  } else if (record.event == kLogBootPhase && kept == 10) {
+    const uint8_t* d = record.data;
+    unsigned long us = ((unsigned long)d[6] << 24) |
+                       ((unsigned long)d[7] << 16) |
+                       ((unsigned long)d[8] << 8) | d[9];
+    n = snprintf(out + (pos < cap ? pos : cap - 1), pos < cap ? cap - pos : 1,
+                 " %.6s: %lu us", (const char*)d, us);
+    pos += n < 0 ? 0 : (size_t)n;
+  } else if (kept > 0) {
+    if (pos + 2 < cap) {
+      out[pos++] = ':';
+      out[pos++] = ' ';
+    }
+    for (size_t i = 0; i < kept && pos + 4 < cap; i++) {
+      uint8_t c = record.data[i];
+      if (c >= 0x20 && c < 0x7f) {
+        out[pos++] = (char)c;
+      } else {
+        snprintf(out + pos, cap - pos, "\\x%02x", c);
+        pos += 4;
+      }
+    }
+    if (record.len > kept && pos + 3 < cap) {
+      memcpy(out + pos, "...", 3);
+      pos += 3;
+    }
+  }
+  if (pos >= cap) {
+    pos = cap - 1;
+  }
+  out[pos] = '\0';
+  return pos;
+}
+
+Logger::Logger(Clock& clock, LogSink* sink) : clock_(clock), sink_(sink) {}
+
+void Logger::log(uint8_t event, const uint8_t* data, size_t len) {
+  if (!sink_) {
+    return;
+  }
+  LogRecord record;
+  makeLogRecord(&record, clock_.micros(), event, data, len);
+#if GW_LOG_DEFERRED
+  queue_.push(record);
+#else
+  sink_->write(record);
+#endif
+}
+
+size_t Logger::drain(size_t max) {
+#if GW_LOG_DEFERRED
+  size_t written = 0;
+  LogRecord record;
+  while (written < max && queue_.pop(&record)) {
+    sink_->write(record);
+    written++;
+  }
+  return written;
+#else
+  (void)max;
+  return 0;
+#endif
+}
+
+uint32_t Logger::dropped() const {
+#if GW_LOG_DEFERRED
+  return queue_.dropped();
+#else
+  return 0;
+#endif
+}
+
+}  // namespace gw
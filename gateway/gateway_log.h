@@ -0,0 +1,105 @@
+/*
+  Level-gated, allocation-free logging for the gateway core.
+
+  Log statements are macros that compile to nothing when their level is
+  above GW_LOG_LEVEL, so a production build pays nothing for them. What is
+  compiled in is captured as a fixed-size binary LogRecord (timestamp, event
+  id, up to kLogDataSize bytes of payload) and either written to a LogSink
+  immediately or queued in a DeferredLog and written while the loop is idle
+  (GW_LOG_DEFERRED).
+
+  Formatting to text happens only in the sink, off the forwarding path.
+*/
+
+#ifndef GATEWAY_GATEWAY_LOG_H_
+#define GATEWAY_GATEWAY_LOG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "deferred_log.h"
+#include "gateway_config.h"
+#include "gateway_transport.h"
+
+#define GW_LOG_NONE 0
+#define GW_LOG_ERROR 1
+#define GW_LOG_INFO 2
+#define GW_LOG_DEBUG 3
+
+namespace gw {
+
+enum LogEvent {
+  kLogUdpToUart = 1,     // data: command frame (head)
+  kLogUartToUdp = 2,     // data: telemetry frame (head)
+  kLogOverflowReset = 3, // data: none
+  kLogNewClient = 4,     // data: ip (4 bytes, big endian), port (2 bytes)
+  kLogClientExpired = 5, // data: as kLogNewClient
+  kLogBootPhase = 6,     // data: phase name (6 bytes, NUL padded),
+                         //       duration in us (4 bytes, big endian)
+};
+
+// Human-readable label for a LogEvent, e.g. "UDP -> UART".
+const char* logEventName(uint8_t event);
+
+// Fills a record, keeping at most kLogDataSize leading bytes of data.
+void makeLogRecord(LogRecord* record, uint32_t time_us, uint8_t event,
+                   const uint8_t* data, size_t len);
+
+// Renders a record as one line of text, e.g. "1234567 UDP -> UART: +0.50-0.25".
+// Returns the length written (truncated to cap - 1).
+size_t formatLogRecord(const LogRecord& record, char* out, size_t cap);
+
+// Destination for log records (debug console, stderr, ...).
+class LogSink {
+ public:
+  virtual ~LogSink() {}
+  virtual void write(const LogRecord& record) = 0;
+};
+
+// Front end used by the log macros. Stamps each record with the clock and
+// either writes it straight to the sink or queues it for drain().
+class Logger {
+ public:
+  Logger(Clock& clock, LogSink* sink);
+
+  void log(uint8_t event, const uint8_t* data, size_t len);
+
+  // Writes up to max queued records to the sink. Call when the loop is
+  // idle. Returns the number written.
+  size_t drain(size_t max);
+
+  // Records lost because the queue was full.
+  uint32_t dropped() const;
+
+ private:
+  Clock& clock_;
+  LogSink* sink_;
+#if GW_LOG_DEFERRED
+  DeferredLog queue_;
+#endif
+};
+
+}  // namespace gw
+
+// GW_LOG_E/I/D(logger, event, data, len) record an event through a Logger.
+// Above GW_LOG_LEVEL they expand to nothing and their arguments are not
+// evaluated.
+#if GW_LOG_LEVEL >= GW_LOG_ERROR
+#define GW_LOG_E(logger, event, data, len) (logger).log((event), (data), (len))
+#else
+#define GW_LOG_E(logger, event, data, len) ((void)0)
+#endif
+
+#if GW_LOG_LEVEL >= GW_LOG_INFO
+#define GW_LOG_I(logger, event, data, len) (logger).log((event), (data), (len))
+#else
+#define GW_LOG_I(logger, event, data, len) ((void)0)
+#endif
+
+#if GW_LOG_LEVEL >= GW_LOG_DEBUG
+#define GW_LOG_D(logger, event, data, len) (logger).log((event), (data), (len))
+#else
+#define GW_LOG_D(logger, event, data, len) ((void)0)
+#endif
+
+#endif  // GATEWAY_GATEWAY_LOG_H_
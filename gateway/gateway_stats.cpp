@@ -0,0 +1,166 @@
+#include "gateway_stats.h"
+
+#include <string.h>
+
+namespace gw {
+
+namespace {
+
+const char* const kCounterNames[kCounterCount] = {
+    "udp_to_uart",       "uart_frames",
+    "uart_to_udp",       "heartbeats",
+    "dropped_no_client", "dropped_not_controller",
+    "sessions_rejected", "malformed",
+    "overflow_resets",   "stale_commands",
+    "coalesced_moves",   "uart_tx_dropped",
+    "awake_ms",          "idle_ms",
+    "telemetry_filtered", "uart_tx_refused",
+};
+
+const char* const kTaskNames[kTaskCount] = {
+    "udp_in", "uart_out", "uart_in", "housekeeping", "stats",
+};
+
+inline void putU32(uint8_t* out, uint32_t v) {
+  out[0] = (uint8_t)v;
+  out[1] = (uint8_t)(v >> 8);
+  out[2] = (uint8_t)(v >> 16);
+  out[3] = (uint8_t)(v >> 24);
+}
+
+inline uint32_t getU32(const uint8_t* in) {
+  return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) |
+         ((uint32_t)in[3] << 24);
+}
+
+}  // namespace
+
+const char* counterName(size_t i) {
+  return i < kCounterCount ? kCounterNames[i] : "?";
+}
+
+const char* taskName(int i) {
+  return i >= 0 && i < kTaskCount ? kTaskNames[i] : "?";
+}
+
+void LatencyHistogram::clear() { memset(counts, 0, sizeof(counts)); }
+
+void LatencyHistogram::record(uint32_t us) {
+  // Bit length of us: 0 for 0, 1 for 1, 2 for 2..3, ...
+  int bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+  if (bucket >= kLatencyBuckets) {
+    bucket = kLatencyBuckets - 1;
+  }
+  counts[bucket]++;
+}
+
+uint32_t LatencyHistogram::total() const {
+  uint32_t n = 0;
+  for (int i = 0; i < kLatencyBuckets; i++) {
+    n += counts[i];
+  }
+  return n;
+}
+
+uint32_t LatencyHistogram::percentile(uint32_t permille) const {
+  uint32_t n = total();
+  if (n == 0) {
+    return 0;
+  }
+  // Rank of the sample at the quantile, rounded up, at least 1
+  uint32_t rank = (uint32_t)(((uint64_t)n * permille + 999) / 1000);
+  if (rank == 0) {
+    rank = 1;
+  }
+  uint32_t seen = 0;
+  for (int i = 0; i < kLatencyBuckets; i++) {
+    seen += counts[i];
+    if (seen >= rank) {
+      return bucketLimit(i);
+    }
+  }
+  return bucketLimit(kLatencyBuckets - 1);
+}
+
+uint32_t LatencyHistogram::bucketLimit(int i) {
+  return i >= kLatencyBuckets - 1 ? 0xffffffffUL : (uint32_t)1 << i;
+}
+
+size_t encodeStatsReply(const StatsSnapshot& stats, uint8_t* out) {
+  size_t n = 0;
+  out[n++] = 'G';
+  out[n++] = 'W';
+  out[n++] = 'S';
+  out[n++] = kStatsVersion;
+  putU32(out + n, stats.uptime_ms);
+  n += 4;
+  out[n++] = (uint8_t)kCounterCount;
+  out[n++] = (uint8_t)kStatsHistograms;
+  out[n++] = (uint8_t)kLatencyBuckets;
+  out[n++] = (uint8_t)kTaskCount;
+
+  const uint32_t* counters = (const uint32_t*)&stats.counters;
+  for (size_t i = 0; i < kCounterCount; i++, n += 4) {
+    putU32(out + n, counters[i]);
+  }
+  const LatencyHistogram* histograms[kStatsHistograms] = {
+      &stats.command, &stats.telemetry, &stats.loop};
+  for (int h = 0; h < kStatsHistograms; h++) {
+    for (int i = 0; i < kLatencyBuckets; i++, n += 4) {
+      putU32(out + n, histograms[h]->counts[i]);
+    }
+  }
+  for (int t = 0; t < kTaskCount; t++, n += 12) {
+    putU32(out + n, stats.tasks[t].runs);
+    putU32(out + n + 4, stats.tasks[t].max_us);
+    putU32(out + n + 8, stats.tasks[t].overruns);
+  }
+  return n;
+}
+
+bool decodeStatsReply(const uint8_t* data, size_t len, StatsSnapshot* stats) {
+  if (len < kStatsHeaderSize || data[0] != 'G' || data[1] != 'W' ||
+      data[2] != 'S' || data[3] != kStatsVersion) {
+    return false;
+  }
+  size_t counter_count = data[8];
+  size_t histogram_count = data[9];
+  size_t bucket_count = data[10];
+  size_t task_count = data[11];
+  if (len < kStatsHeaderSize + 4 * (counter_count +
+                                    histogram_count * bucket_count +
+                                    3 * task_count)) {
+    return false;
+  }
+  memset(stats, 0, sizeof(*stats));
+  stats->uptime_ms = getU32(data + 4);
+
+  const uint8_t* p = data + kStatsHeaderSize;
+  uint32_t* counters = (uint32_t*)&stats->counters;
+  for (size_t i = 0; i < counter_count; i++, p += 4) {
+    if (i < kCounterCount) {
+      counters[i] = getU32(p);
+    }
+  }
+  LatencyHistogram* histograms[kStatsHistograms] = {
+      &stats->command, &stats->telemetry, &stats->loop};
+  for (size_t h = 0; h < histogram_count; h++) {
+    for (size_t i = 0; i < bucket_count; i++, p += 4) {
+      if (h < (size_t)kStatsHistograms) {
+        // Samples beyond our last bucket belong in it
+        size_t bucket = i < (size_t)kLatencyBuckets ? i : kLatencyBuckets - 1;
+        histograms[h]->counts[bucket] += getU32(p);
+      }
+    }
+  }
+  for (size_t t = 0; t < task_count; t++, p += 12) {
+    if (t < (size_t)kTaskCount) {
+      stats->tasks[t].runs = getU32(p);
+      stats->tasks[t].max_us = getU32(p + 4);
+      stats->tasks[t].overruns = getU32(p + 8);
+    }
+  }
+  return true;
+}
+
+}  // namespace gw
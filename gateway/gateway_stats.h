@@ -0,0 +1,129 @@
+/*
+  Forwarding counters and latency histograms, and the stats reply that
+  carries them over UDP.
+
+  Latencies are measured in microseconds on the gateway's own clock:
+
+  - command:   from the datagram being received (Udp.parsePacket()) to the
+               command having been written to the UART (Serial1.write()).
+  - telemetry: from the read that brought a frame's first byte (STX) into
+               the UART ring to the datagram carrying it having been sent
+               (Udp.endPacket()). With batching this includes the hold time
+               and is recorded once per datagram, for its oldest frame.
+  - loop:      one iteration of the scheduler, every task included. Its
+               maximum bounds how long a byte waits before its direction
+               gets a turn.
+
+  Histograms use fixed log2 buckets: bucket 0 counts samples below 1 us,
+  bucket i samples in [2^(i-1), 2^i) us, and the last bucket everything
+  from 2^(kLatencyBuckets-2) us up. Recording is a count-leading-zeros and
+  an increment, so it is cheap enough to stay enabled in firmware.
+
+  A client sends a wire::kStatsRequest frame; the gateway answers that
+  client with a stats reply datagram (little endian, not COBS framed):
+
+    'G' 'W' 'S' version | uptime_ms:u32 | counter count:u8 |
+    histogram count:u8 | bucket count:u8 | task count:u8 | counters:u32... |
+    buckets:u32... per histogram (command, telemetry, loop) |
+    runs:u32 max_us:u32 overruns:u32 per task
+
+  Counters appear in GatewayCounters order, tasks in GatewayTask order; the
+  counts in the header let a newer tool read an older gateway and vice
+  versa.
+*/
+
+#ifndef GATEWAY_GATEWAY_STATS_H_
+#define GATEWAY_GATEWAY_STATS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace gw {
+
+struct GatewayCounters {
+  uint32_t udp_to_uart;             // Commands forwarded to the UART
+  uint32_t uart_frames;             // Complete frames received on the UART
+  uint32_t uart_to_udp;             // Datagrams sent to clients
+  uint32_t heartbeats;              // Heartbeats consumed by the gateway
+  uint32_t dropped_no_client;       // UART frames discarded with no session
+  uint32_t dropped_not_controller;  // Commands from observer sessions
+  uint32_t sessions_rejected;       // Datagrams refused, table full
+  uint32_t malformed;               // Undecodable or unexpected commands
+  uint32_t overflow_resets;         // UART frames too long for the buffer
+  uint32_t stale_commands;          // Repeated or out-of-order sequence numbers
+  uint32_t coalesced_moves;         // Moves superseded before the UART write
+  uint32_t uart_tx_dropped;         // Moves pushed out of a full TX queue
+  uint32_t awake_ms;                // Time spent running loop tasks
+  uint32_t idle_ms;                 // Time spent asleep in IdleWaiter::wait()
+  uint32_t telemetry_filtered;      // Frames withheld by a session's policy
+  uint32_t uart_tx_refused;         // Starts/stops refused, priority lane full
+};
+
+const size_t kCounterCount = sizeof(GatewayCounters) / sizeof(uint32_t);
+
+// Name of the i-th counter in GatewayCounters, e.g. "udp_to_uart".
+const char* counterName(size_t i);
+
+const int kLatencyBuckets = 20;
+
+struct LatencyHistogram {
+  uint32_t counts[kLatencyBuckets];
+
+  void clear();
+  void record(uint32_t us);
+  uint32_t total() const;
+
+  // Upper bound in us of the bucket holding the given quantile
+  // (0 .. 1000 per mille), or 0 if the histogram is empty.
+  uint32_t percentile(uint32_t permille) const;
+
+  // Exclusive upper bound in us of bucket i; 0xffffffff for the last.
+  static uint32_t bucketLimit(int i);
+};
+
+// Tasks of the gateway loop (scheduler.h), in the order they run.
+enum GatewayTask {
+  kTaskUdpIn,         // Datagrams -> commands queued for the UART
+  kTaskUartOut,       // TX queue -> UART
+  kTaskUartIn,        // UART -> telemetry datagrams, batch flushes
+  kTaskHousekeeping,  // Session expiry
+  kTaskStats,         // Counter upkeep and log output, when idle
+  kTaskCount
+};
+
+// Name of a GatewayTask, e.g. "udp_in".
+const char* taskName(int i);
+
+struct TaskStats {
+  uint32_t runs;
+  uint32_t max_us;    // Longest single turn
+  uint32_t overruns;  // Turns that took longer than the budget
+};
+
+struct StatsSnapshot {
+  uint32_t uptime_ms;  // Since the Gateway was constructed
+  GatewayCounters counters;
+  LatencyHistogram command;
+  LatencyHistogram telemetry;
+  LatencyHistogram loop;  // Duration of whole loop iterations
+  TaskStats tasks[kTaskCount];
+};
+
+const uint8_t kStatsVersion = 2;  // 2: uptime in ms, was us
+const size_t kStatsHeaderSize = 12;
+const int kStatsHistograms = 3;
+const size_t kStatsReplySize = kStatsHeaderSize + 4 * kCounterCount +
+                               kStatsHistograms * 4 * kLatencyBuckets +
+                               kTaskCount * 4 * 3;
+
+// Writes a stats reply into out, which needs kStatsReplySize bytes.
+// Returns the length written.
+size_t encodeStatsReply(const StatsSnapshot& stats, uint8_t* out);
+
+// Parses a stats reply. Counters, buckets and tasks the reply doesn't carry
+// are left at 0. Returns false if data isn't a stats reply.
+bool decodeStatsReply(const uint8_t* data, size_t len, StatsSnapshot* stats);
+
+}  // namespace gw
+
+#endif  // GATEWAY_GATEWAY_STATS_H_
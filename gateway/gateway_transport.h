@@ -0,0 +1,89 @@
+/*
+  Transport interfaces for the gateway core.
+
+  The forwarding logic never touches WiFiUDP or HardwareSerial directly; it
+  talks to these small interfaces instead. The Energia sketch implements them
+  on top of the board peripherals (energia_transport.h) and the Linux
+  simulator implements them on a UDP socket and a pseudo-terminal
+  (host/linux_transport.h).
+*/
+
+#ifndef GATEWAY_TRANSPORT_H_
+#define GATEWAY_TRANSPORT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace gw {
+
+// IPv4 address and port of a UDP peer. The address is kept in host byte
+// order, so 192.168.1.2 is 0xC0A80102.
+struct Endpoint {
+  uint32_t ip;
+  uint16_t port;
+};
+
+inline bool operator==(const Endpoint& a, const Endpoint& b) {
+  return a.ip == b.ip && a.port == b.port;
+}
+
+inline bool operator!=(const Endpoint& a, const Endpoint& b) {
+  return !(a == b);
+}
+
+// Packet-oriented side of the bridge (UDP on both targets).
+class DatagramTransport {
+ public:
+  virtual ~DatagramTransport() {}
+
+  // Copies the next pending datagram into buf and stores its sender in
+  // from. Returns the number of bytes copied, or 0 when nothing is pending.
+  // Datagrams larger than cap are truncated.
+  virtual size_t receive(uint8_t* buf, size_t cap, Endpoint* from) = 0;
+
+  // Sends one datagram. Returns false if the stack refused it.
+  virtual bool send(const Endpoint& to, const uint8_t* data, size_t len) = 0;
+};
+
+// Byte-stream side of the bridge (Serial1 on the CC3200, a pty on Linux).
+class SerialPort {
+ public:
+  virtual ~SerialPort() {}
+
+  // Number of bytes that can be read without blocking.
+  virtual size_t available() = 0;
+
+  // Reads up to cap bytes without blocking. Returns the number read.
+  virtual size_t read(uint8_t* buf, size_t cap) = 0;
+
+  // Number of bytes write() can take now without blocking. An estimate is
+  // fine as long as it errs low; write() may still accept fewer.
+  virtual size_t writable() = 0;
+
+  // Writes len bytes. Returns the number accepted.
+  virtual size_t write(const uint8_t* data, size_t len) = 0;
+};
+
+// Puts the loop to sleep while there is nothing to do (Gateway::poll()).
+// The Linux simulator waits in poll() on its socket and pty; the board
+// sleeps until the next interrupt.
+class IdleWaiter {
+ public:
+  virtual ~IdleWaiter() {}
+
+  // Blocks until a transport may have input or timeout_us has passed.
+  // Returning early is always allowed.
+  virtual void wait(uint32_t timeout_us) = 0;
+};
+
+// Free-running microsecond clock (micros() on the board). Wraps after about
+// 71 minutes; compare timestamps by unsigned subtraction only.
+class Clock {
+ public:
+  virtual ~Clock() {}
+  virtual uint32_t micros() = 0;
+};
+
+}  // namespace gw
+
+#endif  // GATEWAY_TRANSPORT_H_
@@ -0,0 +1,298 @@
+#include "capture.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace gw {
+
+static_assert(sizeof(CaptureHeader) == kCaptureRecordSize,
+              "capture header must be one record long");
+static_assert(sizeof(CaptureRecord) == kCaptureRecordSize,
+              "capture record layout changed");
+
+namespace {
+
+const char kMagic[8] = {'G', 'W', 'C', 'A', 'P', 0, 0, 0};
+
+uint64_t clockNs(clockid_t id) {
+  timespec ts;
+  clock_gettime(id, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000u +
+         static_cast<uint64_t>(ts.tv_nsec);
+}
+
+bool validHeader(const CaptureHeader& header) {
+  return memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+         header.version == kCaptureVersion &&
+         header.record_size == kCaptureRecordSize;
+}
+
+}  // namespace
+
+const char* captureDirectionName(int direction) {
+  switch (direction) {
+    case kCaptureUdpIn:
+      return "udp-in";
+    case kCaptureUdpOut:
+      return "udp-out";
+    case kCaptureUartIn:
+      return "uart-in";
+    case kCaptureUartOut:
+      return "uart-out";
+    default:
+      return "?";
+  }
+}
+
+// --- CaptureWriter ---
+
+CaptureWriter::CaptureWriter()
+    : file_(NULL), base_ns_(0), base_mono_ns_(0), records_(0), peer_count_(0) {}
+
+CaptureWriter::~CaptureWriter() { close(); }
+
+bool CaptureWriter::open(const char* path) {
+  close();
+  int fd = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    int saved = errno;
+    ::close(fd);
+    errno = saved;
+    return false;
+  }
+
+  if (st.st_size == 0) {
+    CaptureHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kCaptureVersion;
+    header.record_size = kCaptureRecordSize;
+    header.created_ns = clockNs(CLOCK_REALTIME);
+    if (::write(fd, &header, sizeof(header)) !=
+        static_cast<ssize_t>(sizeof(header))) {
+      int saved = errno;
+      ::close(fd);
+      errno = saved;
+      return false;
+    }
+  } else {
+    CaptureHeader header;
+    if (pread(fd, &header, sizeof(header), 0) !=
+            static_cast<ssize_t>(sizeof(header)) ||
+        !validHeader(header)) {
+      ::close(fd);
+      errno = EINVAL;
+      return false;
+    }
+    // Drops a record torn by a crash so appended ones stay aligned
+    off_t whole = st.st_size - st.st_size % kCaptureRecordSize;
+    if (whole != st.st_size && ftruncate(fd, whole) != 0) {
+      int saved = errno;
+      ::close(fd);
+      errno = saved;
+      return false;
+    }
+  }
+
+  file_ = fdopen(fd, "ab");
+  if (file_ == NULL) {
+    int saved = errno;
+    ::close(fd);
+    errno = saved;
+    return false;
+  }
+  base_ns_ = clockNs(CLOCK_REALTIME);
+  base_mono_ns_ = clockNs(CLOCK_MONOTONIC);
+  records_ = 0;
+  peer_count_ = 0;
+  return true;
+}
+
+void CaptureWriter::close() {
+  if (file_ != NULL) {
+    fclose(file_);
+    file_ = NULL;
+  }
+}
+
+void CaptureWriter::flush() {
+  if (file_ != NULL) {
+    fflush(file_);
+  }
+}
+
+uint8_t CaptureWriter::sessionOf(const Endpoint& peer) {
+  for (int i = 0; i < peer_count_; i++) {
+    if (peers_[i] == peer) {
+      return static_cast<uint8_t>(i);
+    }
+  }
+  if (peer_count_ == kCaptureMaxPeers) {
+    return kCaptureMaxPeers;  // Shared by every peer beyond the table
+  }
+  peers_[peer_count_] = peer;
+  return static_cast<uint8_t>(peer_count_++);
+}
+
+void CaptureWriter::write(CaptureDirection direction, const Endpoint& peer,
+                          const uint8_t* data, size_t len) {
+  if (file_ == NULL) {
+    return;
+  }
+  if (len > 0xffff) {
+    len = 0xffff;
+  }
+  bool uart = direction == kCaptureUartIn || direction == kCaptureUartOut;
+
+  CaptureRecord record;
+  memset(&record, 0, sizeof(record));
+  record.time_ns = base_ns_ + (clockNs(CLOCK_MONOTONIC) - base_mono_ns_);
+  record.peer_ip = uart ? 0 : peer.ip;
+  record.peer_port = uart ? 0 : peer.port;
+  record.direction = static_cast<uint8_t>(direction);
+  record.session = uart ? kCaptureUartSession : sessionOf(peer);
+  record.len = static_cast<uint16_t>(len);
+
+  size_t offset = 0;
+  do {
+    size_t n = len - offset;
+    if (n > kCaptureDataSize) {
+      n = kCaptureDataSize;
+    }
+    record.offset = static_cast<uint16_t>(offset);
+    memcpy(record.data, data + offset, n);
+    memset(record.data + n, 0, kCaptureDataSize - n);
+    fwrite(&record, sizeof(record), 1, file_);
+    records_++;
+    offset += n;
+  } while (offset < len);
+}
+
+// --- CaptureReader ---
+
+CaptureReader::CaptureReader()
+    : map_(NULL), map_len_(0), header_(NULL), records_(NULL), count_(0) {}
+
+CaptureReader::~CaptureReader() { close(); }
+
+bool CaptureReader::open(const char* path) {
+  close();
+  int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      st.st_size < static_cast<off_t>(sizeof(CaptureHeader))) {
+    ::close(fd);
+    errno = EINVAL;
+    return false;
+  }
+  void* map = mmap(NULL, static_cast<size_t>(st.st_size), PROT_READ,
+                   MAP_PRIVATE, fd, 0);
+  int saved = errno;
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    errno = saved;
+    return false;
+  }
+  map_ = map;
+  map_len_ = static_cast<size_t>(st.st_size);
+  header_ = static_cast<const CaptureHeader*>(map_);
+  if (!validHeader(*header_)) {
+    close();
+    errno = EINVAL;
+    return false;
+  }
+  records_ = reinterpret_cast<const CaptureRecord*>(header_ + 1);
+  count_ = (map_len_ - sizeof(CaptureHeader)) / kCaptureRecordSize;
+  return true;
+}
+
+void CaptureReader::close() {
+  if (map_ != NULL) {
+    munmap(map_, map_len_);
+    map_ = NULL;
+  }
+  map_len_ = 0;
+  header_ = NULL;
+  records_ = NULL;
+  count_ = 0;
+}
+
+bool CaptureReader::next(size_t* index, CaptureUnit* unit) const {
+  // Skips continuation records whose first record is missing
+  while (*index < count_ && records_[*index].offset != 0) {
+    ++*index;
+  }
+  if (*index >= count_) {
+    return false;
+  }
+  const CaptureRecord& first = records_[*index];
+  unit->time_ns = first.time_ns;
+  unit->peer.ip = first.peer_ip;
+  unit->peer.port = first.peer_port;
+  unit->direction = first.direction;
+  unit->session = first.session;
+  unit->len = 0;
+
+  size_t len = first.len;
+  size_t offset = 0;
+  do {
+    const CaptureRecord& r = records_[*index];
+    size_t n = len - offset < kCaptureDataSize ? len - offset
+                                               : kCaptureDataSize;
+    if (offset + n <= kCaptureMaxUnit) {
+      memcpy(unit->data + offset, r.data, n);
+      unit->len = offset + n;
+    }
+    offset += n;
+    ++*index;
+  } while (offset < len && *index < count_ &&
+           records_[*index].offset == offset);
+  return true;
+}
+
+// --- CaptureUdp / CaptureSerial ---
+
+size_t CaptureUdp::receive(uint8_t* buf, size_t cap, Endpoint* from) {
+  size_t n = inner_.receive(buf, cap, from);
+  if (n > 0) {
+    writer_.write(kCaptureUdpIn, *from, buf, n);
+  }
+  return n;
+}
+
+bool CaptureUdp::send(const Endpoint& to, const uint8_t* data, size_t len) {
+  writer_.write(kCaptureUdpOut, to, data, len);
+  return inner_.send(to, data, len);
+}
+
+size_t CaptureSerial::read(uint8_t* buf, size_t cap) {
+  size_t n = inner_.read(buf, cap);
+  if (n > 0) {
+    Endpoint none = {0, 0};
+    writer_.write(kCaptureUartIn, none, buf, n);
+  }
+  return n;
+}
+
+size_t CaptureSerial::write(const uint8_t* data, size_t len) {
+  size_t n = inner_.write(data, len);
+  if (n > 0) {
+    Endpoint none = {0, 0};
+    writer_.write(kCaptureUartOut, none, data, n);
+  }
+  return n;
+}
+
+}  // namespace gw
@@ -0,0 +1,181 @@
+/*
+  Binary capture of bridge traffic.
+
+  A capture file is a 64-byte header followed by 64-byte records, little
+  endian, append-only. Every record is self-describing, so a file cut
+  short by a crash still parses up to its last whole record, and a file
+  can be mmap()ed and indexed directly (CaptureReader).
+
+    header: magic "GWCAP\0\0\0" | version:u16 | record size:u16 |
+            reserved:u32 | created_ns:u64 (CLOCK_REALTIME) | reserved
+
+    record: time_ns:u64 | peer ip:u32 | peer port:u16 | direction:u8 |
+            session:u8 | len:u16 | offset:u16 | reserved:u32 |
+            data:40 bytes
+
+  A unit is one datagram, or one chunk of bytes read from or written to
+  the UART. Units longer than kCaptureDataSize span consecutive records
+  with the same time, direction and session and increasing offset; len is
+  the length of the whole unit in each. time_ns is wall-clock time in
+  nanoseconds, advanced by the monotonic clock from the moment the writer
+  opened the file, so intervals within a run are exact.
+
+  session numbers the UDP peers of one writer in order of appearance
+  (0xff for the UART); the peer address is kept as well.
+*/
+
+#ifndef GATEWAY_HOST_CAPTURE_H_
+#define GATEWAY_HOST_CAPTURE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "gateway_transport.h"
+
+namespace gw {
+
+enum CaptureDirection {
+  kCaptureUdpIn = 1,    // Client -> gateway datagram
+  kCaptureUdpOut = 2,   // Gateway -> client datagram
+  kCaptureUartIn = 3,   // C2000 -> gateway bytes
+  kCaptureUartOut = 4,  // Gateway -> C2000 bytes
+};
+
+const char* captureDirectionName(int direction);
+
+const uint16_t kCaptureVersion = 1;
+const size_t kCaptureRecordSize = 64;
+const size_t kCaptureDataSize = 40;
+const uint8_t kCaptureUartSession = 0xff;
+const int kCaptureMaxPeers = 254;
+// Largest unit a reader reassembles; longer ones are truncated.
+const size_t kCaptureMaxUnit = 2048;
+
+struct CaptureHeader {
+  char magic[8];
+  uint16_t version;
+  uint16_t record_size;
+  uint32_t reserved0;
+  uint64_t created_ns;
+  uint8_t reserved[40];
+};
+
+struct CaptureRecord {
+  uint64_t time_ns;
+  uint32_t peer_ip;
+  uint16_t peer_port;
+  uint8_t direction;
+  uint8_t session;
+  uint16_t len;
+  uint16_t offset;
+  uint32_t reserved;
+  uint8_t data[kCaptureDataSize];
+};
+
+// One reassembled datagram or UART chunk.
+struct CaptureUnit {
+  uint64_t time_ns;
+  Endpoint peer;
+  uint8_t direction;
+  uint8_t session;
+  size_t len;  // Bytes in data, at most kCaptureMaxUnit
+  uint8_t data[kCaptureMaxUnit];
+};
+
+class CaptureWriter {
+ public:
+  CaptureWriter();
+  ~CaptureWriter();
+
+  // Creates path, or appends to it if it is already a capture. Returns
+  // false on failure (errno set; EINVAL for a file that isn't a capture).
+  bool open(const char* path);
+  void close();
+  bool isOpen() const { return file_ != NULL; }
+
+  // Appends one unit. peer is ignored for the UART directions.
+  void write(CaptureDirection direction, const Endpoint& peer,
+             const uint8_t* data, size_t len);
+
+  // Writes buffered records to the file.
+  void flush();
+
+  uint64_t records() const { return records_; }
+
+ private:
+  CaptureWriter(const CaptureWriter&);
+  CaptureWriter& operator=(const CaptureWriter&);
+
+  uint8_t sessionOf(const Endpoint& peer);
+
+  FILE* file_;
+  uint64_t base_ns_;       // Wall clock when opened
+  uint64_t base_mono_ns_;  // Monotonic clock when opened
+  uint64_t records_;
+  Endpoint peers_[kCaptureMaxPeers];
+  int peer_count_;
+};
+
+class CaptureReader {
+ public:
+  CaptureReader();
+  ~CaptureReader();
+
+  // Maps path read-only. Returns false if it can't be opened or isn't a
+  // capture (errno set).
+  bool open(const char* path);
+  void close();
+
+  const CaptureHeader& header() const { return *header_; }
+  size_t count() const { return count_; }
+  const CaptureRecord& at(size_t i) const { return records_[i]; }
+
+  // Reassembles the unit starting at record *index and advances *index
+  // past it. Returns false at the end of the file.
+  bool next(size_t* index, CaptureUnit* unit) const;
+
+ private:
+  CaptureReader(const CaptureReader&);
+  CaptureReader& operator=(const CaptureReader&);
+
+  void* map_;
+  size_t map_len_;
+  const CaptureHeader* header_;
+  const CaptureRecord* records_;
+  size_t count_;
+};
+
+// Transports that record everything passing through them, for the
+// simulator (--capture).
+class CaptureUdp : public DatagramTransport {
+ public:
+  CaptureUdp(DatagramTransport& inner, CaptureWriter& writer)
+      : inner_(inner), writer_(writer) {}
+
+  virtual size_t receive(uint8_t* buf, size_t cap, Endpoint* from);
+  virtual bool send(const Endpoint& to, const uint8_t* data, size_t len);
+
+ private:
+  DatagramTransport& inner_;
+  CaptureWriter& writer_;
+};
+
+class CaptureSerial : public SerialPort {
+ public:
+  CaptureSerial(SerialPort& inner, CaptureWriter& writer)
+      : inner_(inner), writer_(writer) {}
+
+  virtual size_t available() { return inner_.available(); }
+  virtual size_t read(uint8_t* buf, size_t cap);
+  virtual size_t writable() { return inner_.writable(); }
+  virtual size_t write(const uint8_t* data, size_t len);
+
+ private:
+  SerialPort& inner_;
+  CaptureWriter& writer_;
+};
+
+}  // namespace gw
+
+#endif  // GATEWAY_HOST_CAPTURE_H_
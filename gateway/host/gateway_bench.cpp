@@ -0,0 +1,500 @@
+/*
+  Loopback benchmark for the gateway core.
+
+  Drives one gw::Gateway in-process through LoopbackUdp and LoopbackSerial
+  (loopback_transport.h), so it runs on any Linux box without a network
+  or a serial port:
+
+    gateway_bench [--duration-s N] [--cmd-rate HZ] [--telemetry-rate HZ]
+                  [--telemetry-size BYTES] [--observers N] [--ascii]
+                  [--flood] [--batch-bytes N] [--batch-hold-us N]
+                  [--uart-paced] [--json]
+
+  A controller client sends move commands at --cmd-rate and a simulated
+  C2000 emits telemetry frames at --telemetry-rate (0 disables either);
+  --flood injects one of each on every loop iteration instead, to find the
+  ceiling. Every command and frame carries a tag in its first field, so it
+  is matched on the far side and timed end to end, including the loop
+  iteration that delivered it. --telemetry-size pads ASCII telemetry
+  frames with leading zeros; binary frames have a fixed size. --uart-paced
+  limits the simulated Serial1 to what GW_UART_BAUD can carry, as on the
+  board.
+
+  Reported: delivered rate, p50/p99/p99.9/max latency, losses on each
+  path, the gateway's own counters and histograms, and the wall time spent
+  in poll() calls that moved data, divided by the packets moved. --json
+  prints one JSON object for scripts and regression checks.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "gateway.h"
+#include "linux_transport.h"
+#include "loopback_transport.h"
+#include "stats_report.h"
+#include "wire_protocol.h"
+
+namespace {
+
+const int kTags = 30000;  // Tags live in an int16 field
+const uint64_t kKeepaliveNs = 500000000ull;
+const uint64_t kSettleNs = 200000000ull;
+
+struct Options {
+  double duration_s;
+  double cmd_rate;
+  double telemetry_rate;
+  size_t telemetry_size;
+  int observers;
+  bool ascii;
+  bool flood;
+  unsigned long batch_bytes;
+  unsigned long batch_hold_us;
+  bool uart_paced;
+  bool json;
+};
+
+uint64_t nowNs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull +
+         static_cast<uint64_t>(ts.tv_nsec);
+}
+
+double processCpuSeconds() {
+  timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// One direction of traffic: tags in flight and the latencies of the ones
+// that arrived.
+struct Stream {
+  Stream() : sent(0), delivered(0), next_tag(0) {
+    memset(sent_at, 0, sizeof(sent_at));
+  }
+
+  int16_t start(uint64_t now) {
+    int16_t tag = static_cast<int16_t>(next_tag);
+    next_tag = (next_tag + 1) % kTags;
+    sent_at[tag] = now;
+    sent++;
+    return tag;
+  }
+
+  void arrived(int16_t tag, uint64_t now) {
+    if (tag < 0 || tag >= kTags || sent_at[tag] == 0) {
+      return;
+    }
+    latencies_ns.push_back(static_cast<uint32_t>(now - sent_at[tag]));
+    sent_at[tag] = 0;
+    delivered++;
+  }
+
+  // Latency at the given quantile in microseconds.
+  double percentileUs(double q) {
+    if (latencies_ns.empty()) {
+      return 0;
+    }
+    size_t rank = static_cast<size_t>(q * (latencies_ns.size() - 1) + 0.5);
+    std::nth_element(latencies_ns.begin(), latencies_ns.begin() + rank,
+                     latencies_ns.end());
+    return latencies_ns[rank] / 1000.0;
+  }
+
+  uint32_t sent;
+  uint32_t delivered;
+  int next_tag;
+  uint64_t sent_at[kTags];
+  std::vector<uint32_t> latencies_ns;
+};
+
+void usage(const char* argv0) {
+  fprintf(stderr,
+          "usage: %s [--duration-s N] [--cmd-rate HZ] [--telemetry-rate HZ]\n"
+          "       [--telemetry-size BYTES] [--observers N] [--ascii]\n"
+          "       [--flood] [--batch-bytes N] [--batch-hold-us N]\n"
+          "       [--uart-paced] [--json]\n",
+          argv0);
+}
+
+bool parseOptions(int argc, char** argv, Options* opt) {
+  opt->duration_s = 5;
+  opt->cmd_rate = 100;
+  opt->telemetry_rate = 100;
+  opt->telemetry_size = 0;
+  opt->observers = 0;
+  opt->ascii = false;
+  opt->flood = false;
+  opt->batch_bytes = GW_BATCH_MAX_BYTES;
+  opt->batch_hold_us = GW_BATCH_HOLD_US;
+  opt->uart_paced = false;
+  opt->json = false;
+
+  for (int i = 1; i < argc; i++) {
+    bool more = i + 1 < argc;
+    if (strcmp(argv[i], "--duration-s") == 0 && more) {
+      opt->duration_s = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--cmd-rate") == 0 && more) {
+      opt->cmd_rate = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--telemetry-rate") == 0 && more) {
+      opt->telemetry_rate = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--telemetry-size") == 0 && more) {
+      opt->telemetry_size = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--observers") == 0 && more) {
+      opt->observers = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--batch-bytes") == 0 && more) {
+      opt->batch_bytes = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--batch-hold-us") == 0 && more) {
+      opt->batch_hold_us = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--ascii") == 0) {
+      opt->ascii = true;
+    } else if (strcmp(argv[i], "--flood") == 0) {
+      opt->flood = true;
+    } else if (strcmp(argv[i], "--uart-paced") == 0) {
+      opt->uart_paced = true;
+    } else if (strcmp(argv[i], "--json") == 0) {
+      opt->json = true;
+    } else {
+      return false;
+    }
+  }
+  return opt->duration_s > 0 && opt->observers >= 0;
+}
+
+class Bench {
+ public:
+  explicit Bench(const Options& opt)
+      : opt_(opt),
+        gateway_(udp_, serial_, clock_),
+        seq_(0),
+        uart_len_(0),
+        telemetry_datagrams_(0),
+        observer_datagrams_(0),
+        polls_(0),
+        busy_polls_(0),
+        busy_ns_(0) {
+    gateway_.configureBatching(opt.batch_bytes,
+                               static_cast<uint32_t>(opt.batch_hold_us));
+    serial_.setPaced(opt.uart_paced);
+    controller_.ip = 0x7f000001;
+    controller_.port = 40000;
+  }
+
+  void run();
+  void report();
+
+ private:
+  gw::Endpoint observer(int i) const {
+    gw::Endpoint e = controller_;
+    e.port = static_cast<uint16_t>(controller_.port + 1 + i);
+    return e;
+  }
+
+  void sendCommand(uint64_t now);
+  void sendHeartbeat(const gw::Endpoint& from, bool ascii);
+  void sendTelemetry(uint64_t now);
+  void poll();
+  void collectUart(uint64_t now);
+  void collectUdp(uint64_t now);
+  uint32_t moved() const;
+
+  Options opt_;
+  gw::LoopbackUdp udp_;
+  gw::LoopbackSerial serial_;
+  gw::MonotonicClock clock_;
+  gw::Gateway gateway_;
+  gw::Endpoint controller_;
+  uint16_t seq_;
+
+  Stream commands_;
+  Stream telemetry_;
+
+  uint8_t uart_buf_[4096];  // Gateway UART output not yet split into frames
+  size_t uart_len_;
+  uint32_t telemetry_datagrams_;
+  uint32_t observer_datagrams_;
+
+  uint64_t polls_;
+  uint64_t busy_polls_;
+  uint64_t busy_ns_;
+  double elapsed_s_;
+  double cpu_s_;
+};
+
+void Bench::sendCommand(uint64_t now) {
+  gw::wire::Message msg;
+  msg.type = gw::wire::kMove;
+  msg.seq = seq_++;
+  msg.field_count = 2;
+  msg.fields[0] = commands_.start(now);
+  msg.fields[1] = 0;
+  uint8_t frame[gw::wire::kMaxFrameSize + gw::wire::kMaxAsciiSize];
+  size_t len = opt_.ascii ? gw::wire::encodeAscii(msg, frame)
+                          : gw::wire::encode(msg, frame, sizeof(frame));
+  udp_.inject(controller_, frame, len);
+}
+
+void Bench::sendHeartbeat(const gw::Endpoint& from, bool ascii) {
+  gw::wire::Message msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.type = gw::wire::kHeartbeat;
+  msg.seq = seq_++;
+  uint8_t frame[gw::wire::kMaxFrameSize + gw::wire::kMaxAsciiSize];
+  size_t len = ascii ? gw::wire::encodeAscii(msg, frame)
+                     : gw::wire::encode(msg, frame, sizeof(frame));
+  udp_.inject(from, frame, len);
+}
+
+void Bench::sendTelemetry(uint64_t now) {
+  gw::wire::Message msg;
+  msg.type = gw::wire::kTelemetry;
+  msg.seq = 0;
+  msg.field_count = 4;
+  msg.fields[0] = telemetry_.start(now);
+  msg.fields[1] = 0;
+  msg.fields[2] = 0;
+  msg.fields[3] = 0;
+  uint8_t frame[GW_UART_FRAME_SIZE + gw::wire::kMaxAsciiSize];
+#if GW_UART_BINARY
+  size_t len = gw::wire::encode(msg, frame, sizeof(frame));
+#else
+  size_t len = gw::wire::encodeAscii(msg, frame);
+  size_t target = opt_.telemetry_size < GW_UART_FRAME_SIZE
+                      ? opt_.telemetry_size
+                      : GW_UART_FRAME_SIZE;
+  if (target > len) {
+    // Pad the last field with leading zeros: "+0.00" -> "+0000.00"
+    size_t pad = target - len;
+    size_t at = len - 1 - 4;  // After the sign of the last field
+    memmove(frame + at + pad, frame + at, len - at);
+    memset(frame + at, '0', pad);
+    len = target;
+  }
+#endif
+  serial_.inject(frame, len);
+}
+
+uint32_t Bench::moved() const {
+  const gw::GatewayCounters& c = gateway_.counters();
+  return c.udp_to_uart + c.uart_frames + c.uart_to_udp + c.heartbeats +
+         c.malformed + c.dropped_not_controller;
+}
+
+void Bench::poll() {
+  uint32_t before = moved();
+  uint64_t t0 = nowNs();
+  gateway_.poll();
+  uint64_t t1 = nowNs();
+  polls_++;
+  if (moved() != before) {
+    busy_polls_++;
+    busy_ns_ += t1 - t0;
+  }
+  collectUart(t1);
+  collectUdp(t1);
+}
+
+// Splits what the gateway wrote to the UART into frames and matches moves.
+void Bench::collectUart(uint64_t now) {
+  uart_len_ += serial_.drain(uart_buf_ + uart_len_,
+                             sizeof(uart_buf_) - uart_len_);
+  const uint8_t end_byte = GW_UART_BINARY ? 0x00 : GW_ETX;
+  size_t start = 0;
+  for (;;) {
+    const uint8_t* end = static_cast<const uint8_t*>(
+        memchr(uart_buf_ + start, end_byte, uart_len_ - start));
+    if (!end) {
+      break;
+    }
+    size_t len = static_cast<size_t>(end - uart_buf_) - start + 1;
+    gw::wire::Message msg;
+#if GW_UART_BINARY
+    bool ok = gw::wire::decode(uart_buf_ + start, len - 1, &msg);
+#else
+    bool ok = gw::wire::decodeAscii(uart_buf_ + start, len, &msg);
+#endif
+    if (ok && msg.type == gw::wire::kMove) {
+      commands_.arrived(msg.fields[0], now);
+    }
+    start += len;
+  }
+  memmove(uart_buf_, uart_buf_ + start, uart_len_ - start);
+  uart_len_ -= start;
+  if (uart_len_ == sizeof(uart_buf_)) {
+    uart_len_ = 0;  // Garbage without delimiters; start over
+  }
+}
+
+// Matches telemetry frames in the datagrams sent to the controller.
+void Bench::collectUdp(uint64_t now) {
+  gw::Endpoint to;
+  const uint8_t* data;
+  size_t len;
+  while ((len = udp_.takeSent(&to, &data)) > 0) {
+    if (to != controller_) {
+      observer_datagrams_++;
+      continue;
+    }
+    telemetry_datagrams_++;
+    const uint8_t end_byte = opt_.ascii ? GW_ETX : 0x00;
+    size_t start = 0;
+    while (start < len) {
+      const uint8_t* end = static_cast<const uint8_t*>(
+          memchr(data + start, end_byte, len - start));
+      size_t frame_len =
+          end ? static_cast<size_t>(end - data) - start + 1 : len - start;
+      gw::wire::Message msg;
+      bool ok = opt_.ascii
+                    ? gw::wire::decodeAscii(data + start, frame_len, &msg)
+                    : gw::wire::decode(data + start, frame_len - 1, &msg);
+      if (ok && msg.type == gw::wire::kTelemetry) {
+        telemetry_.arrived(msg.fields[0], now);
+      }
+      start += frame_len;
+    }
+  }
+}
+
+void Bench::run() {
+  uint64_t cmd_period =
+      opt_.cmd_rate > 0 ? static_cast<uint64_t>(1e9 / opt_.cmd_rate) : 0;
+  uint64_t telemetry_period =
+      opt_.telemetry_rate > 0 ? static_cast<uint64_t>(1e9 / opt_.telemetry_rate)
+                              : 0;
+  double cpu_start = processCpuSeconds();
+  uint64_t start = nowNs();
+  uint64_t stop = start + static_cast<uint64_t>(opt_.duration_s * 1e9);
+  uint64_t next_cmd = start;
+  uint64_t next_telemetry = start;
+  uint64_t next_keepalive = start;
+
+  // Let the controller claim its session before telemetry starts flowing
+  sendHeartbeat(controller_, opt_.ascii);
+  poll();
+
+  uint64_t now;
+  while ((now = nowNs()) < stop) {
+    if (now >= next_keepalive) {
+      for (int i = 0; i < opt_.observers; i++) {
+        sendHeartbeat(observer(i), i % 2 != 0);
+      }
+      if (cmd_period == 0 && !opt_.flood) {
+        sendHeartbeat(controller_, opt_.ascii);
+      }
+      next_keepalive += kKeepaliveNs;
+    }
+    if (opt_.flood) {
+      sendCommand(now);
+      sendTelemetry(now);
+    } else {
+      // One per iteration at most; a loop that falls behind shows up as
+      // latency rather than as bursts
+      if (cmd_period && now >= next_cmd) {
+        sendCommand(now);
+        next_cmd += cmd_period;
+      }
+      if (telemetry_period && now >= next_telemetry) {
+        sendTelemetry(now);
+        next_telemetry += telemetry_period;
+      }
+    }
+    poll();
+  }
+  elapsed_s_ = (nowNs() - start) * 1e-9;
+
+  // Let batches and queued frames drain before counting losses
+  uint64_t settle = nowNs() + kSettleNs + opt_.batch_hold_us * 1000ull;
+  while (nowNs() < settle) {
+    poll();
+  }
+  cpu_s_ = processCpuSeconds() - cpu_start;
+}
+
+void Bench::report() {
+  gw::StatsSnapshot stats;
+  gateway_.stats(&stats);
+  uint32_t packets = stats.counters.udp_to_uart + stats.counters.uart_frames +
+                     stats.counters.heartbeats;
+  double busy_ns_per_packet = packets ? double(busy_ns_) / packets : 0;
+  Stream* streams[2] = {&commands_, &telemetry_};
+  const char* names[2] = {"commands", "telemetry"};
+
+  if (!opt_.json) {
+    printf("%.1f s, %s client, %d observer(s)%s\n", elapsed_s_,
+           opt_.ascii ? "ASCII" : "binary", opt_.observers,
+           opt_.flood ? ", flood" : "");
+    for (int i = 0; i < 2; i++) {
+      Stream& s = *streams[i];
+      printf("%-9s sent %u, delivered %u (%.0f/s), lost %u, "
+             "p50 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us\n",
+             names[i], s.sent, s.delivered, s.delivered / elapsed_s_,
+             s.sent - s.delivered, s.percentileUs(0.5), s.percentileUs(0.99),
+             s.percentileUs(0.999), s.percentileUs(1.0));
+    }
+    printf("telemetry datagrams %u to controller, %u to observers\n",
+           telemetry_datagrams_, observer_datagrams_);
+    printf("injection drops: udp %u, uart %u\n", udp_.injectDropped(),
+           serial_.injectDropped());
+    printf("busy poll time %.0f ns/packet (%llu of %llu polls busy), "
+           "process cpu %.2f s\n",
+           busy_ns_per_packet, static_cast<unsigned long long>(busy_polls_),
+           static_cast<unsigned long long>(polls_), cpu_s_);
+    printf("gateway view:\n");
+    gw::printStats(stdout, stats);
+    return;
+  }
+
+  printf("{\"config\": {\"duration_s\": %g, \"cmd_rate\": %g, "
+         "\"telemetry_rate\": %g, \"telemetry_size\": %zu, "
+         "\"observers\": %d, \"ascii\": %s, \"flood\": %s, "
+         "\"batch_bytes\": %lu, \"batch_hold_us\": %lu, "
+         "\"uart_paced\": %s, \"uart_binary\": %s},\n",
+         opt_.duration_s, opt_.cmd_rate, opt_.telemetry_rate,
+         opt_.telemetry_size, opt_.observers, opt_.ascii ? "true" : "false",
+         opt_.flood ? "true" : "false", opt_.batch_bytes, opt_.batch_hold_us,
+         opt_.uart_paced ? "true" : "false", GW_UART_BINARY ? "true" : "false");
+  printf(" \"elapsed_s\": %.3f,\n", elapsed_s_);
+  for (int i = 0; i < 2; i++) {
+    Stream& s = *streams[i];
+    printf(" \"%s\": {\"sent\": %u, \"delivered\": %u, \"lost\": %u, "
+           "\"per_s\": %.1f, \"p50_us\": %.1f, \"p99_us\": %.1f, "
+           "\"p999_us\": %.1f, \"max_us\": %.1f},\n",
+           names[i], s.sent, s.delivered, s.sent - s.delivered,
+           s.delivered / elapsed_s_, s.percentileUs(0.5),
+           s.percentileUs(0.99), s.percentileUs(0.999), s.percentileUs(1.0));
+  }
+  printf(" \"datagrams\": {\"controller\": %u, \"observers\": %u},\n",
+         telemetry_datagrams_, observer_datagrams_);
+  printf(" \"injection_drops\": {\"udp\": %u, \"uart\": %u},\n",
+         udp_.injectDropped(), serial_.injectDropped());
+  printf(" \"cpu\": {\"busy_ns_per_packet\": %.1f, \"polls\": %llu, "
+         "\"busy_polls\": %llu, \"process_cpu_s\": %.3f},\n",
+         busy_ns_per_packet, static_cast<unsigned long long>(polls_),
+         static_cast<unsigned long long>(busy_polls_), cpu_s_);
+  printf(" \"gateway\": ");
+  gw::printStatsJson(stdout, stats);
+  printf("}\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!parseOptions(argc, argv, &opt)) {
+    usage(argv[0]);
+    return 2;
+  }
+  // Large: the loopback queues and the tag tables
+  Bench* bench = new Bench(opt);
+  bench->run();
+  bench->report();
+  delete bench;
+  return 0;
+}
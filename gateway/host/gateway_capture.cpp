@@ -0,0 +1,222 @@
+/*
+  Records bridge traffic without the gateway, or prints a capture:
+
+    gateway_capture --out FILE [--listen PORT] [--gateway IP[:PORT]]
+    gateway_capture --dump FILE [--limit N]
+
+  With --out it is a UDP proxy: point the app at this host's PORT (default
+  GW_UDP_PORT) and every datagram is relayed to the gateway (default
+  192.168.1.1) and recorded in both directions (capture.h). Each client
+  gets its own upstream socket, so the gateway still sees one session per
+  client. Stop with Ctrl-C; a capture appended to an existing file keeps
+  its earlier records.
+
+  --dump prints one line per unit: time since the first, direction,
+  session, peer, length and the first bytes of data.
+*/
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "capture.h"
+#include "gateway_config.h"
+#include "linux_transport.h"
+
+namespace {
+
+const int kMaxClients = 8;
+const size_t kDumpBytes = 24;
+
+volatile sig_atomic_t g_stop = 0;
+
+void onSignal(int) { g_stop = 1; }
+
+void usage(const char* argv0) {
+  fprintf(stderr,
+          "usage: %s --out FILE [--listen PORT] [--gateway IP[:PORT]]\n"
+          "       %s --dump FILE [--limit N]\n",
+          argv0, argv0);
+}
+
+bool parseEndpoint(const char* text, gw::Endpoint* out) {
+  char host[32];
+  const char* colon = strchr(text, ':');
+  size_t n = colon ? static_cast<size_t>(colon - text) : strlen(text);
+  if (n >= sizeof(host)) {
+    return false;
+  }
+  memcpy(host, text, n);
+  host[n] = '\0';
+  if (!gw::parseIpv4(host, &out->ip)) {
+    return false;
+  }
+  out->port = colon ? static_cast<uint16_t>(strtoul(colon + 1, NULL, 10))
+                    : static_cast<uint16_t>(GW_UDP_PORT);
+  return out->port != 0;
+}
+
+void printData(const uint8_t* data, size_t len) {
+  size_t shown = len < kDumpBytes ? len : kDumpBytes;
+  for (size_t i = 0; i < shown; i++) {
+    uint8_t c = data[i];
+    if (c >= 0x20 && c < 0x7f && c != '\\') {
+      putchar(c);
+    } else {
+      printf("\\x%02x", c);
+    }
+  }
+  if (shown < len) {
+    printf("...");
+  }
+}
+
+int dump(const char* path, unsigned long limit) {
+  gw::CaptureReader reader;
+  if (!reader.open(path)) {
+    fprintf(stderr, "cannot read %s: %s\n", path, strerror(errno));
+    return 1;
+  }
+  gw::CaptureUnit unit;
+  size_t index = 0;
+  uint64_t first_ns = 0;
+  unsigned long units = 0;
+  while ((limit == 0 || units < limit) && reader.next(&index, &unit)) {
+    if (units++ == 0) {
+      first_ns = unit.time_ns;
+    }
+    printf("%12.6f %-8s ", (unit.time_ns - first_ns) / 1e9,
+           gw::captureDirectionName(unit.direction));
+    if (unit.session == gw::kCaptureUartSession) {
+      printf("uart                  ");
+    } else {
+      char peer[24];
+      snprintf(peer, sizeof(peer), "%u.%u.%u.%u:%u", unit.peer.ip >> 24,
+               (unit.peer.ip >> 16) & 0xff, (unit.peer.ip >> 8) & 0xff,
+               unit.peer.ip & 0xff, unit.peer.port);
+      printf("s%-3u %-21s ", unit.session, peer);
+    }
+    printf("%4zu  ", unit.len);
+    printData(unit.data, unit.len);
+    putchar('\n');
+  }
+  fprintf(stderr, "%lu units in %zu records\n", units, reader.count());
+  return 0;
+}
+
+struct Client {
+  gw::Endpoint peer;
+  gw::UdpSocket upstream;
+};
+
+int proxy(const char* path, unsigned port, const gw::Endpoint& gateway) {
+  gw::CaptureWriter writer;
+  if (!writer.open(path)) {
+    fprintf(stderr, "cannot write %s: %s\n", path, strerror(errno));
+    return 1;
+  }
+  gw::UdpSocket listen;
+  if (!listen.open(static_cast<uint16_t>(port))) {
+    fprintf(stderr, "cannot bind UDP port %u: %s\n", port, strerror(errno));
+    return 1;
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  Client clients[kMaxClients];
+  int client_count = 0;
+  uint8_t buf[1500];
+  fprintf(stderr, "Relaying UDP port %u to %u.%u.%u.%u:%u, recording to %s\n",
+          port, gateway.ip >> 24, (gateway.ip >> 16) & 0xff,
+          (gateway.ip >> 8) & 0xff, gateway.ip & 0xff, gateway.port, path);
+
+  while (!g_stop) {
+    pollfd fds[1 + kMaxClients];
+    fds[0].fd = listen.fd();
+    fds[0].events = POLLIN;
+    for (int i = 0; i < client_count; i++) {
+      fds[1 + i].fd = clients[i].upstream.fd();
+      fds[1 + i].events = POLLIN;
+    }
+    if (poll(fds, 1 + client_count, 200) <= 0) {
+      writer.flush();
+      continue;
+    }
+
+    gw::Endpoint from;
+    size_t n;
+    while ((n = listen.receive(buf, sizeof(buf), &from)) > 0) {
+      int c = 0;
+      while (c < client_count && clients[c].peer != from) {
+        c++;
+      }
+      if (c == client_count) {
+        if (client_count == kMaxClients || !clients[c].upstream.open(0)) {
+          continue;
+        }
+        clients[c].peer = from;
+        client_count++;
+        fprintf(stderr, "client %d: %u.%u.%u.%u:%u\n", c, from.ip >> 24,
+                (from.ip >> 16) & 0xff, (from.ip >> 8) & 0xff, from.ip & 0xff,
+                from.port);
+      }
+      writer.write(gw::kCaptureUdpIn, from, buf, n);
+      clients[c].upstream.send(gateway, buf, n);
+    }
+    for (int c = 0; c < client_count; c++) {
+      while ((n = clients[c].upstream.receive(buf, sizeof(buf), &from)) > 0) {
+        if (from != gateway) {
+          continue;
+        }
+        writer.write(gw::kCaptureUdpOut, clients[c].peer, buf, n);
+        listen.send(clients[c].peer, buf, n);
+      }
+    }
+  }
+  fprintf(stderr, "\n%llu records written\n",
+          static_cast<unsigned long long>(writer.records()));
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* out = NULL;
+  const char* dump_path = NULL;
+  unsigned long limit = 0;
+  unsigned port = GW_UDP_PORT;
+  gw::Endpoint gateway = {0xC0A80101, GW_UDP_PORT};  // 192.168.1.1
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+      out = argv[++i];
+    } else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+      dump_path = argv[++i];
+    } else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) {
+      limit = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+      port = static_cast<unsigned>(strtoul(argv[++i], NULL, 10));
+    } else if (strcmp(argv[i], "--gateway") == 0 && i + 1 < argc) {
+      if (!parseEndpoint(argv[++i], &gateway)) {
+        fprintf(stderr, "bad address %s\n", argv[i]);
+        return 2;
+      }
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  if (dump_path != NULL && out == NULL) {
+    return dump(dump_path, limit);
+  }
+  if (out != NULL && dump_path == NULL) {
+    return proxy(out, port, gateway);
+  }
+  usage(argv[0]);
+  return 2;
+}
@@ -0,0 +1,256 @@
+/*
+  Re-injects a capture (capture.h) into a running simulator:
+
+    gateway_replay FILE [--host IP] [--port N] [--link PATH]
+                   [--speed X] [--only udp|uart]
+
+  Client datagrams (udp-in) are sent to the simulator's UDP port, from one
+  socket per captured session so the gateway sees the same set of
+  clients. UART bytes from the C2000 (uart-in) are written to the pty the
+  simulator was started with (--link). What the gateway sends back is
+  read and discarded. Records the gateway produced (udp-out, uart-out)
+  are not replayed.
+
+  --speed 1 (the default) keeps the captured timing, 10 plays ten times
+  faster, 0 sends as fast as possible. On exit it prints how many units
+  went each way and how late they were against the schedule, so a run
+  that couldn't keep up shows.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "capture.h"
+#include "gateway_config.h"
+#include "linux_transport.h"
+
+namespace {
+
+const int kMaxSessions = 256;
+// Sleeps until this close to a deadline, then spins, for sub-ms accuracy.
+const uint64_t kSpinNs = 200000;
+
+void usage(const char* argv0) {
+  fprintf(stderr,
+          "usage: %s FILE [--host IP] [--port N] [--link PATH]\n"
+          "       [--speed X] [--only udp|uart]\n",
+          argv0);
+}
+
+uint64_t nowNs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull +
+         static_cast<uint64_t>(ts.tv_nsec);
+}
+
+class Replayer {
+ public:
+  Replayer(const gw::Endpoint& gateway, int pty)
+      : gateway_(gateway), pty_(pty) {}
+
+  bool sendUdp(uint8_t session, const uint8_t* data, size_t len);
+  bool writeUart(const uint8_t* data, size_t len);
+  void drain();
+  void waitUntil(uint64_t deadline_ns);
+
+ private:
+  gw::Endpoint gateway_;
+  int pty_;
+  gw::UdpSocket sockets_[kMaxSessions];
+  std::vector<int> open_;
+};
+
+bool Replayer::sendUdp(uint8_t session, const uint8_t* data, size_t len) {
+  gw::UdpSocket& socket = sockets_[session];
+  if (socket.fd() < 0) {
+    if (!socket.open(0)) {
+      return false;
+    }
+    open_.push_back(session);
+  }
+  return socket.send(gateway_, data, len);
+}
+
+bool Replayer::writeUart(const uint8_t* data, size_t len) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = write(pty_, data + done, len - done);
+    if (n < 0) {
+      if (errno != EAGAIN) {
+        return false;
+      }
+      drain();
+      continue;
+    }
+    done += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+// Discards replies and UART output so neither side's buffers fill up.
+void Replayer::drain() {
+  uint8_t buf[2048];
+  gw::Endpoint from;
+  for (size_t i = 0; i < open_.size(); i++) {
+    while (sockets_[open_[i]].receive(buf, sizeof(buf), &from) > 0) {
+    }
+  }
+  if (pty_ >= 0) {
+    while (read(pty_, buf, sizeof(buf)) > 0) {
+    }
+  }
+}
+
+void Replayer::waitUntil(uint64_t deadline_ns) {
+  for (;;) {
+    drain();
+    uint64_t now = nowNs();
+    if (now >= deadline_ns) {
+      return;
+    }
+    uint64_t left = deadline_ns - now;
+    if (left > kSpinNs) {
+      timespec ts;
+      uint64_t sleep = left - kSpinNs;
+      ts.tv_sec = static_cast<time_t>(sleep / 1000000000ull);
+      ts.tv_nsec = static_cast<long>(sleep % 1000000000ull);
+      nanosleep(&ts, NULL);
+    }
+  }
+}
+
+double percentile(std::vector<double>& v, double q) {
+  if (v.empty()) {
+    return 0;
+  }
+  size_t i = static_cast<size_t>(q * (v.size() - 1));
+  std::nth_element(v.begin(), v.begin() + i, v.end());
+  return v[i];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* path = NULL;
+  const char* host = "127.0.0.1";
+  unsigned port = GW_UDP_PORT;
+  const char* link = NULL;
+  double speed = 1.0;
+  bool udp = true;
+  bool uart = true;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) {
+      host = argv[++i];
+    } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+      port = static_cast<unsigned>(strtoul(argv[++i], NULL, 10));
+    } else if (strcmp(argv[i], "--link") == 0 && i + 1 < argc) {
+      link = argv[++i];
+    } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+      speed = strtod(argv[++i], NULL);
+    } else if (strcmp(argv[i], "--only") == 0 && i + 1 < argc) {
+      ++i;
+      udp = strcmp(argv[i], "udp") == 0;
+      uart = strcmp(argv[i], "uart") == 0;
+    } else if (argv[i][0] != '-' && path == NULL) {
+      path = argv[i];
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (path == NULL || speed < 0 || (!udp && !uart)) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  gw::CaptureReader reader;
+  if (!reader.open(path)) {
+    fprintf(stderr, "cannot read %s: %s\n", path, strerror(errno));
+    return 1;
+  }
+  gw::Endpoint gateway;
+  if (!gw::parseIpv4(host, &gateway.ip)) {
+    fprintf(stderr, "bad address %s\n", host);
+    return 2;
+  }
+  gateway.port = static_cast<uint16_t>(port);
+
+  int pty = -1;
+  if (uart && link != NULL) {
+    pty = open(link, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (pty < 0) {
+      fprintf(stderr, "cannot open %s: %s\n", link, strerror(errno));
+      return 1;
+    }
+  } else if (uart) {
+    fprintf(stderr, "no --link given, skipping UART records\n");
+    uart = false;
+  }
+
+  Replayer replayer(gateway, pty);
+  gw::CaptureUnit unit;
+  size_t index = 0;
+  uint64_t first_ns = 0;
+  bool started = false;
+  uint64_t start = nowNs();
+  unsigned long sent_udp = 0;
+  unsigned long sent_uart = 0;
+  unsigned long failed = 0;
+  std::vector<double> late_us;
+
+  while (reader.next(&index, &unit)) {
+    bool is_udp = unit.direction == gw::kCaptureUdpIn;
+    bool is_uart = unit.direction == gw::kCaptureUartIn;
+    if (!(is_udp && udp) && !(is_uart && uart)) {
+      continue;
+    }
+    if (!started) {
+      first_ns = unit.time_ns;
+      start = nowNs();
+      started = true;
+    }
+    uint64_t due = start;
+    if (speed > 0) {
+      due += static_cast<uint64_t>((unit.time_ns - first_ns) / speed);
+      replayer.waitUntil(due);
+    }
+    bool ok = is_udp ? replayer.sendUdp(unit.session, unit.data, unit.len)
+                     : replayer.writeUart(unit.data, unit.len);
+    if (!ok) {
+      failed++;
+    } else if (is_udp) {
+      sent_udp++;
+    } else {
+      sent_uart++;
+    }
+    if (speed > 0) {
+      late_us.push_back((nowNs() - due) / 1e3);
+    }
+  }
+  double elapsed = (nowNs() - start) / 1e9;
+  replayer.waitUntil(nowNs() + 100000000ull);  // Let the last replies land
+
+  printf("replayed %lu datagrams, %lu UART chunks in %.3f s (%lu failed)\n",
+         sent_udp, sent_uart, elapsed, failed);
+  if (!late_us.empty()) {
+    double p50 = percentile(late_us, 0.5);
+    double p99 = percentile(late_us, 0.99);
+    double max = *std::max_element(late_us.begin(), late_us.end());
+    printf("lateness p50 %.1f us, p99 %.1f us, max %.1f us\n", p50, p99, max);
+  }
+  if (pty >= 0) {
+    close(pty);
+  }
+  return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,154 @@
+/*
+  Linux simulator for the CC3200 UDP <-> UART gateway.
+
+  Runs the same gw::Gateway core as the firmware against a real UDP socket
+  and a pseudo-terminal standing in for Serial1:
+
+    gateway_sim [--port N] [--link PATH] [--quiet] [--spin]
+                [--batch-bytes N] [--batch-hold-us N] [--capture FILE]
+
+  The pty slave path is printed on startup (and symlinked to PATH with
+  --link) so a C2000 stand-in can attach to it. Point the app or a load
+  generator at this host's UDP port. --batch-hold-us enables telemetry
+  batching (see Gateway::configureBatching()). Between bursts of traffic
+  the loop sleeps in ppoll() on the socket and pty; --spin busy-polls
+  instead, like the original firmware. Counters, latency percentiles, the
+  duty cycle and the CPU time used are printed on exit; query them while
+  running with gateway_stats. --capture records all UDP and UART traffic
+  to FILE (capture.h) for gateway_capture --dump and gateway_replay.
+*/
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "capture.h"
+#include "gateway.h"
+#include "linux_transport.h"
+#include "stats_report.h"
+
+namespace {
+
+volatile sig_atomic_t g_stop = 0;
+
+void onSignal(int) { g_stop = 1; }
+
+void usage(const char* argv0) {
+  fprintf(stderr,
+          "usage: %s [--port N] [--link PATH] [--quiet] [--spin]\n"
+          "       [--batch-bytes N] [--batch-hold-us N] [--capture FILE]\n",
+          argv0);
+}
+
+double clockSeconds(clockid_t id) {
+  timespec ts;
+  clock_gettime(id, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  unsigned port = GW_UDP_PORT;
+  const char* link = NULL;
+  bool quiet = false;
+  bool spin = false;
+  const char* capture = NULL;
+  unsigned long batch_bytes = GW_BATCH_MAX_BYTES;
+  unsigned long batch_hold_us = GW_BATCH_HOLD_US;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+      port = static_cast<unsigned>(strtoul(argv[++i], NULL, 10));
+    } else if (strcmp(argv[i], "--link") == 0 && i + 1 < argc) {
+      link = argv[++i];
+    } else if (strcmp(argv[i], "--batch-bytes") == 0 && i + 1 < argc) {
+      batch_bytes = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--batch-hold-us") == 0 && i + 1 < argc) {
+      batch_hold_us = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--quiet") == 0) {
+      quiet = true;
+    } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+      capture = argv[++i];
+    } else if (strcmp(argv[i], "--spin") == 0) {
+      spin = true;
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  gw::UdpSocket udp;
+  if (!udp.open(static_cast<uint16_t>(port))) {
+    fprintf(stderr, "cannot bind UDP port %u: %s\n", port, strerror(errno));
+    return 1;
+  }
+  gw::PtySerial uart;
+  if (!uart.open()) {
+    fprintf(stderr, "cannot allocate pty: %s\n", strerror(errno));
+    return 1;
+  }
+  if (link) {
+    unlink(link);
+    if (symlink(uart.slaveName(), link) != 0) {
+      fprintf(stderr, "cannot link %s: %s\n", link, strerror(errno));
+      return 1;
+    }
+  }
+
+  gw::CaptureWriter writer;
+  if (capture && !writer.open(capture)) {
+    fprintf(stderr, "cannot write %s: %s\n", capture, strerror(errno));
+    return 1;
+  }
+  gw::CaptureUdp captured_udp(udp, writer);
+  gw::CaptureSerial captured_uart(uart, writer);
+  gw::DatagramTransport& udp_side =
+      capture ? static_cast<gw::DatagramTransport&>(captured_udp) : udp;
+  gw::SerialPort& uart_side =
+      capture ? static_cast<gw::SerialPort&>(captured_uart) : uart;
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  gw::MonotonicClock clock;
+  gw::StderrLogSink logSink;
+  gw::Gateway gateway(udp_side, uart_side, clock, quiet ? NULL : &logSink);
+  gateway.configureBatching(batch_bytes, static_cast<uint32_t>(batch_hold_us));
+  gw::PollWaiter waiter(udp.fd(), uart.fd());
+  if (!spin) {
+    gateway.setIdleWaiter(&waiter);
+  }
+
+  fprintf(stderr, "Async UDP <-> UART Gateway simulator\n");
+  fprintf(stderr, "Listening on UDP port %u\n", port);
+  fprintf(stderr, "Serial1 is %s%s%s\n", uart.slaveName(), link ? " -> " : "",
+          link ? link : "");
+
+  double start = clockSeconds(CLOCK_MONOTONIC);
+  while (!g_stop) {
+    gateway.poll();
+  }
+  double elapsed = clockSeconds(CLOCK_MONOTONIC) - start;
+  double cpu = clockSeconds(CLOCK_PROCESS_CPUTIME_ID);
+
+  gw::StatsSnapshot stats;
+  gateway.stats(&stats);
+  fprintf(stderr, "\n%.1f s, cpu %.2f s (%.1f%%)\n", elapsed, cpu,
+          elapsed > 0 ? 100 * cpu / elapsed : 0.0);
+  gw::printStats(stderr, stats);
+  if (capture) {
+    writer.close();
+    fprintf(stderr, "%llu capture records written to %s\n",
+            static_cast<unsigned long long>(writer.records()), capture);
+  }
+
+  if (link) {
+    unlink(link);
+  }
+  return 0;
+}
@@ -0,0 +1,106 @@
+/*
+  Queries a running gateway (firmware or simulator) for its counters and
+  latency histograms:
+
+    gateway_stats [--host IP] [--port N] [--timeout-ms N] [--json]
+
+  Sends one stats request (gateway_stats.h) and prints the reply. The
+  request opens an observer session on the gateway, so telemetry may
+  arrive before the reply; it is skipped.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "gateway_config.h"
+#include "gateway_stats.h"
+#include "linux_transport.h"
+#include "stats_report.h"
+#include "wire_protocol.h"
+
+namespace {
+
+void usage(const char* argv0) {
+  fprintf(stderr,
+          "usage: %s [--host IP] [--port N] [--timeout-ms N] [--json]\n",
+          argv0);
+}
+
+double nowSeconds() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* host = "127.0.0.1";
+  unsigned port = GW_UDP_PORT;
+  unsigned long timeout_ms = 1000;
+  bool json = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) {
+      host = argv[++i];
+    } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+      port = static_cast<unsigned>(strtoul(argv[++i], NULL, 10));
+    } else if (strcmp(argv[i], "--timeout-ms") == 0 && i + 1 < argc) {
+      timeout_ms = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--json") == 0) {
+      json = true;
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  gw::Endpoint gateway;
+  if (!gw::parseIpv4(host, &gateway.ip)) {
+    fprintf(stderr, "bad address %s\n", host);
+    return 2;
+  }
+  gateway.port = static_cast<uint16_t>(port);
+
+  gw::UdpSocket udp;
+  if (!udp.open(0)) {
+    fprintf(stderr, "cannot open UDP socket: %s\n", strerror(errno));
+    return 1;
+  }
+
+  gw::wire::Message request;
+  memset(&request, 0, sizeof(request));
+  request.type = gw::wire::kStatsRequest;
+  uint8_t frame[gw::wire::kMaxFrameSize];
+  size_t len = gw::wire::encode(request, frame, sizeof(frame));
+  if (!udp.send(gateway, frame, len)) {
+    fprintf(stderr, "cannot send to %s:%u: %s\n", host, port, strerror(errno));
+    return 1;
+  }
+
+  double deadline = nowSeconds() + timeout_ms / 1000.0;
+  uint8_t reply[1500];
+  gw::StatsSnapshot stats;
+  while (nowSeconds() < deadline) {
+    gw::Endpoint from;
+    size_t n = udp.receive(reply, sizeof(reply), &from);
+    if (n == 0) {
+      usleep(1000);
+      continue;
+    }
+    if (from == gateway && gw::decodeStatsReply(reply, n, &stats)) {
+      if (json) {
+        gw::printStatsJson(stdout, stats);
+      } else {
+        gw::printStats(stdout, stats);
+      }
+      return 0;
+    }
+  }
+  fprintf(stderr, "no stats reply from %s:%u\n", host, port);
+  return 1;
+}
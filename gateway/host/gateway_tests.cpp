@@ -0,0 +1,394 @@
+/*
+  Unit tests for the gateway core, run by CTest:
+
+    cmake --build build && ctest --test-dir build
+
+  Tests call the portable sources directly, or drive one gw::Gateway
+  through LoopbackUdp and LoopbackSerial (loopback_transport.h) with a
+  manual clock, so they need no network, serial port or real time. There
+  is no framework: CHECK() prints the failing expression, and the binary
+  exits non-zero if any check failed.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "gateway.h"
+#include "gateway_stats.h"
+#include "loopback_transport.h"
+#include "session_table.h"
+#include "uart_tx_queue.h"
+#include "wire_protocol.h"
+
+namespace {
+
+int g_failures = 0;
+
+#define CHECK(cond)                                                   \
+  do {                                                                \
+    if (!(cond)) {                                                    \
+      fprintf(stderr, "  %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, \
+              #cond);                                                 \
+      g_failures++;                                                   \
+    }                                                                 \
+  } while (0)
+
+// Advances by step on every reading, so the loop's timings stay sane.
+class ManualClock : public gw::Clock {
+ public:
+  explicit ManualClock(uint32_t start) : now(start), step(1) {}
+  virtual uint32_t micros() { return now += step; }
+
+  uint32_t now;
+  uint32_t step;
+};
+
+// One gateway with a single client. Too large for the stack.
+struct Rig {
+  explicit Rig(uint32_t clock_start = 0)
+      : clock(clock_start), gateway(udp, serial, clock) {}
+
+  void inject(const uint8_t* data, size_t len) {
+    udp.inject(kClient, data, len);
+  }
+
+  void poll(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+      gateway.poll();
+    }
+  }
+
+  // Decodes every command the gateway wrote to the (ASCII) UART.
+  int drainCommands(gw::wire::Message* out, int max) {
+    uint8_t buf[1024];
+    size_t len = serial.drain(buf, sizeof(buf));
+    int count = 0;
+    size_t start = 0;
+    for (size_t i = 0; i < len; i++) {
+      if (buf[i] == 0x03) {
+        if (count < max &&
+            gw::wire::decodeAscii(buf + start, i + 1 - start, &out[count])) {
+          count++;
+        }
+        start = i + 1;
+      }
+    }
+    return count;
+  }
+
+  static const gw::Endpoint kClient;
+
+  gw::LoopbackUdp udp;
+  gw::LoopbackSerial serial;
+  ManualClock clock;
+  gw::Gateway gateway;
+};
+
+const gw::Endpoint Rig::kClient = {0x0a000002, 50000};
+
+size_t encodeMove(uint16_t seq, int16_t x, uint8_t* out, size_t cap) {
+  gw::wire::Message msg = gw::wire::Message();
+  msg.type = gw::wire::kMove;
+  msg.seq = seq;
+  msg.field_count = 2;
+  msg.fields[0] = x;
+  msg.fields[1] = 0;
+  return gw::wire::encode(msg, out, cap);
+}
+
+void sendMove(Rig& rig, uint16_t seq, int16_t x) {
+  uint8_t frame[gw::wire::kMaxFrameSize];
+  rig.inject(frame, encodeMove(seq, x, frame, sizeof(frame)));
+}
+
+void sendCommand(Rig& rig, uint8_t type, uint16_t seq) {
+  gw::wire::Message msg = gw::wire::Message();
+  msg.type = type;
+  msg.seq = seq;
+  uint8_t frame[gw::wire::kMaxFrameSize];
+  rig.inject(frame, gw::wire::encode(msg, frame, sizeof(frame)));
+}
+
+bool decodeText(const char* text, gw::wire::Message* msg) {
+  return gw::wire::decodeAscii(reinterpret_cast<const uint8_t*>(text),
+                               strlen(text), msg);
+}
+
+// --- Wire codecs ---
+
+void testBinaryRoundTrip() {
+  gw::wire::Message in = gw::wire::Message();
+  in.type = gw::wire::kTelemetry;
+  in.seq = 0x1234;
+  in.field_count = 4;
+  in.fields[0] = 0;  // Zeros exercise COBS
+  in.fields[1] = -1;
+  in.fields[2] = 32767;
+  in.fields[3] = -32768;
+  uint8_t frame[gw::wire::kMaxFrameSize];
+  size_t len = gw::wire::encode(in, frame, sizeof(frame));
+  CHECK(len > 0 && frame[len - 1] == 0x00);
+
+  gw::wire::Message out;
+  CHECK(gw::wire::decode(frame, len - 1, &out));  // Terminator excluded
+  CHECK(out.type == in.type && out.seq == in.seq);
+  CHECK(out.field_count == 4);
+  CHECK(memcmp(out.fields, in.fields, 4 * sizeof(int16_t)) == 0);
+}
+
+void testBinaryRejectsBadCrc() {
+  uint8_t frame[gw::wire::kMaxFrameSize];
+  size_t len = encodeMove(7, 50, frame, sizeof(frame));
+  gw::wire::Message out;
+  for (size_t i = 1; i < len - 1; i++) {
+    frame[i] ^= 0x10;  // Any single corrupted byte is caught
+    CHECK(!gw::wire::decode(frame, len - 1, &out));
+    frame[i] ^= 0x10;
+  }
+  CHECK(gw::wire::decode(frame, len - 1, &out));
+}
+
+void testBinaryRejectsBadCobs() {
+  uint8_t frame[gw::wire::kMaxFrameSize];
+  size_t len = encodeMove(7, 50, frame, sizeof(frame));
+  gw::wire::Message out;
+  uint8_t code = frame[0];
+  frame[0] = 0xfe;  // Block runs past the end of the frame
+  CHECK(!gw::wire::decode(frame, len - 1, &out));
+  frame[0] = code;
+  frame[1] = 0x00;  // Zero inside a frame
+  CHECK(!gw::wire::decode(frame, len - 1, &out));
+  CHECK(!gw::wire::decode(frame, 0, &out));
+}
+
+void testAsciiRoundTrip() {
+  gw::wire::Message in = gw::wire::Message();
+  in.type = gw::wire::kMove;
+  in.field_count = 2;
+  in.fields[0] = 50;
+  in.fields[1] = -10532;
+  uint8_t text[gw::wire::kMaxAsciiSize];
+  size_t len = gw::wire::encodeAscii(in, text);
+  const char kExpected[] = "\x02+0.50-105.32\x03";
+  CHECK(len == sizeof(kExpected) - 1 && memcmp(text, kExpected, len) == 0);
+
+  gw::wire::Message out;
+  CHECK(gw::wire::decodeAscii(text, len, &out));
+  CHECK(out.type == gw::wire::kMove && out.field_count == 2);
+  CHECK(out.fields[0] == 50 && out.fields[1] == -10532);
+  CHECK(decodeText("\x02stop\x03", &out) && out.type == gw::wire::kStop);
+}
+
+void testAsciiRejectsTrailingBytes() {
+  gw::wire::Message out;
+  CHECK(!decodeText("\x02+0.50-0.25garbage\x03", &out));
+  CHECK(!decodeText("\x02+1.00+2.00+3.00-4.00xx\x03", &out));
+  CHECK(!decodeText("\x02+0.50-0.25+\x03", &out));
+  CHECK(!decodeText("\x02stopp\x03", &out));
+  CHECK(!decodeText("\x02+0.5-0.25\x03", &out));
+  CHECK(decodeText("\x02+1.00+2.00+3.00-4.00\x03", &out));
+  CHECK(out.type == gw::wire::kTelemetry);
+}
+
+// Same input as the app's wire_protocol_test.dart, which must agree.
+void testAsciiSaturates() {
+  gw::wire::Message out;
+  CHECK(decodeText("\x02+327.67+327.68-999.99+99999999.00\x03", &out));
+  CHECK(out.fields[0] == 32767 && out.fields[1] == 32767);
+  CHECK(out.fields[2] == -32767 && out.fields[3] == 32767);
+}
+
+// --- Sequence numbers and coalescing ---
+
+void testStaleSeqDropped() {
+  gw::SessionTable table;
+  bool created;
+  int s = table.touch(Rig::kClient, 0, &created);
+  CHECK(table.advanceSeq(s, 100));
+  CHECK(table.advanceSeq(s, 101));
+  CHECK(!table.advanceSeq(s, 101));  // Repeated
+  CHECK(!table.advanceSeq(s, 99));   // Out of order
+  CHECK(table.advanceSeq(s, 102));
+  CHECK(table.at(s).last_seq == 102);
+
+  CHECK(table.advanceSeq(s, 0xf000));  // Far behind: taken as a restart
+  CHECK(table.advanceSeq(s, 0xfffe));
+  CHECK(table.advanceSeq(s, 1));  // Ahead across the wrap
+  CHECK(!table.advanceSeq(s, 0xffff));
+}
+
+void testRestartAccepted() {
+  gw::SessionTable table;
+  bool created;
+  int s = table.touch(Rig::kClient, 0, &created);
+  CHECK(table.advanceSeq(s, 5000));
+  CHECK(!table.advanceSeq(s, 5000 - (GW_SEQ_WINDOW - 1)));
+  // Further behind than the window: the sender restarted its counter
+  CHECK(table.advanceSeq(s, 5000 - GW_SEQ_WINDOW - 1));
+  CHECK(table.advanceSeq(s, 5000 - GW_SEQ_WINDOW));
+}
+
+void testCorruptFrameKeepsSeq() {
+  Rig* rig = new Rig();
+  sendMove(*rig, 1, 10);
+  rig->poll(4);
+
+  uint8_t frame[gw::wire::kMaxFrameSize];
+  size_t len = encodeMove(900, 20, frame, sizeof(frame));
+  frame[4] ^= 0x01;  // A payload byte; the CRC no longer matches
+  rig->inject(frame, len);
+  rig->poll(4);
+  for (uint16_t seq = 2; seq <= 5; seq++) {
+    sendMove(*rig, seq, (int16_t)(10 * seq));
+    rig->poll(4);
+  }
+
+  const gw::GatewayCounters& c = rig->gateway.counters();
+  CHECK(c.malformed == 1);
+  CHECK(c.stale_commands == 0);
+  CHECK(c.udp_to_uart == 5);
+  CHECK(rig->gateway.sessions().at(0).last_seq == 5);
+  gw::wire::Message out[8];
+  CHECK(rig->drainCommands(out, 8) == 5);
+  CHECK(out[4].fields[0] == 50);
+  delete rig;
+}
+
+void testNewestMovePerIteration() {
+  Rig* rig = new Rig();
+  // Queued together, so one udp_in turn reads all three
+  sendMove(*rig, 1, 10);
+  sendMove(*rig, 2, 20);
+  sendMove(*rig, 3, 30);
+  rig->poll(1);
+
+  gw::wire::Message out[4];
+  CHECK(rig->drainCommands(out, 4) == 1);
+  CHECK(out[0].type == gw::wire::kMove && out[0].fields[0] == 30);
+  CHECK(rig->gateway.counters().coalesced_moves == 2);
+
+  // A stale move in a later iteration doesn't replace anything
+  sendMove(*rig, 2, 20);
+  rig->poll(1);
+  CHECK(rig->drainCommands(out, 4) == 0);
+  CHECK(rig->gateway.counters().stale_commands == 1);
+  delete rig;
+}
+
+// --- UART transmit queue ---
+
+void testMoveLaneDropsOldest() {
+  gw::UartTxQueue queue;
+  for (uint8_t i = 0; i < GW_UART_TX_SLOTS + 2; i++) {
+    CHECK(queue.push(gw::kTxNormal, &i, 1, 0));
+  }
+  CHECK(queue.dropped() == 2);
+  CHECK(queue.front()->data[0] == 2);  // The two oldest moves went
+}
+
+void testPriorityLaneRefuses() {
+  gw::UartTxQueue queue;
+  for (uint8_t i = 0; i < GW_UART_TX_SLOTS; i++) {
+    CHECK(queue.push(gw::kTxPriority, &i, 1, 0));
+  }
+  uint8_t extra = 0xff;
+  CHECK(!queue.push(gw::kTxPriority, &extra, 1, 0));
+  CHECK(queue.refused() == 1);
+  CHECK(queue.dropped() == 0);
+  CHECK(queue.front()->data[0] == 0);  // Nothing queued was dropped
+}
+
+// A stop queued behind a slow line must survive the starts that follow it.
+void testStopNeverDropped() {
+  Rig* rig = new Rig();
+  rig->serial.setPaced(true);
+  // Fill the TX FIFO (GW_UART_TX_FIFO bytes, 7 per start) and leave the
+  // last start partly written, so the stop waits behind it
+  const uint16_t kFifoStarts = 10;
+  uint16_t seq = 1;
+  for (; seq <= kFifoStarts; seq++) {
+    sendCommand(*rig, gw::wire::kStart, seq);
+  }
+  sendCommand(*rig, gw::wire::kStop, seq++);
+  // More starts than the priority lane has slots left; all of it is read
+  // in one iteration (GW_UDP_DRAIN_MAX)
+  for (int i = 0; i < GW_UART_TX_SLOTS; i++) {
+    sendCommand(*rig, gw::wire::kStart, seq++);
+  }
+  rig->poll(1);
+  CHECK(rig->gateway.counters().uart_tx_refused == 2);
+  rig->serial.setPaced(false);  // The line catches up (it paces on wall time)
+  rig->poll(4);
+
+  gw::wire::Message out[16];
+  int n = rig->drainCommands(out, 16);
+  CHECK(n == kFifoStarts + 1 + (GW_UART_TX_SLOTS - 2));
+  CHECK(n > kFifoStarts && out[kFifoStarts].type == gw::wire::kStop);
+  delete rig;
+}
+
+// --- Stats ---
+
+// Uptime counts from construction and survives the u32 clock wrapping.
+void testUptimeAcrossClockWrap() {
+  const uint32_t kStart = 0xfff00000;  // About a second before the wrap
+  Rig* rig = new Rig(kStart);
+  const uint32_t kSeconds = 2 * 3600;  // Longer than the ~71.6 min wrap
+  for (uint32_t i = 0; i < kSeconds; i++) {
+    rig->clock.now += 1000000;
+    rig->gateway.poll();
+  }
+  sendCommand(*rig, gw::wire::kStatsRequest, 1);
+  rig->poll(1);
+
+  gw::Endpoint to;
+  const uint8_t* reply;
+  size_t len = rig->udp.takeSent(&to, &reply);
+  CHECK(len >= gw::kStatsHeaderSize);
+  CHECK(len > 3 && reply[3] == gw::kStatsVersion && gw::kStatsVersion == 2);
+  gw::StatsSnapshot stats;
+  CHECK(gw::decodeStatsReply(reply, len, &stats));
+  // Plus the 1 us tick of every clock reading; losing a wrap would be
+  // 4295 s short
+  CHECK(stats.uptime_ms >= kSeconds * 1000);
+  CHECK(stats.uptime_ms < (kSeconds + 1) * 1000);
+  delete rig;
+}
+
+struct Test {
+  const char* name;
+  void (*run)();
+};
+
+const Test kTests[] = {
+    {"binary_round_trip", testBinaryRoundTrip},
+    {"binary_rejects_bad_crc", testBinaryRejectsBadCrc},
+    {"binary_rejects_bad_cobs", testBinaryRejectsBadCobs},
+    {"ascii_round_trip", testAsciiRoundTrip},
+    {"ascii_rejects_trailing_bytes", testAsciiRejectsTrailingBytes},
+    {"ascii_saturates", testAsciiSaturates},
+    {"stale_seq_dropped", testStaleSeqDropped},
+    {"restart_accepted", testRestartAccepted},
+    {"corrupt_frame_keeps_seq", testCorruptFrameKeepsSeq},
+    {"newest_move_per_iteration", testNewestMovePerIteration},
+    {"move_lane_drops_oldest", testMoveLaneDropsOldest},
+    {"priority_lane_refuses", testPriorityLaneRefuses},
+    {"stop_never_dropped", testStopNeverDropped},
+    {"uptime_across_clock_wrap", testUptimeAcrossClockWrap},
+};
+
+}  // namespace
+
+int main() {
+  int failed_tests = 0;
+  for (size_t i = 0; i < sizeof(kTests) / sizeof(kTests[0]); i++) {
+    int before = g_failures;
+    kTests[i].run();
+    bool ok = g_failures == before;
+    printf("%s %s\n", ok ? "ok  " : "FAIL", kTests[i].name);
+    failed_tests += ok ? 0 : 1;
+  }
+  printf("%d of %d tests failed\n", failed_tests,
+         (int)(sizeof(kTests) / sizeof(kTests[0])));
+  return failed_tests == 0 ? 0 : 1;
+}
@@ -0,0 +1,185 @@
+#include "linux_transport.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace gw {
+
+// --- UdpSocket ---
+
+UdpSocket::UdpSocket() : fd_(-1) {}
+
+UdpSocket::~UdpSocket() { close(); }
+
+bool UdpSocket::open(uint16_t port) {
+  close();
+  fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd_ < 0) {
+    return false;
+  }
+  int one = 1;
+  setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+    int saved = errno;
+    close();
+    errno = saved;
+    return false;
+  }
+  return true;
+}
+
+void UdpSocket::close() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+size_t UdpSocket::receive(uint8_t* buf, size_t cap, Endpoint* from) {
+  sockaddr_in addr;
+  socklen_t addr_len = sizeof(addr);
+  ssize_t n = recvfrom(fd_, buf, cap, MSG_DONTWAIT,
+                       reinterpret_cast<sockaddr*>(&addr), &addr_len);
+  if (n <= 0) {
+    return 0;
+  }
+  from->ip = ntohl(addr.sin_addr.s_addr);
+  from->port = ntohs(addr.sin_port);
+  return static_cast<size_t>(n);
+}
+
+bool UdpSocket::send(const Endpoint& to, const uint8_t* data, size_t len) {
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(to.ip);
+  addr.sin_port = htons(to.port);
+  ssize_t n = sendto(fd_, data, len, MSG_DONTWAIT,
+                     reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+  return n == static_cast<ssize_t>(len);
+}
+
+// --- PtySerial ---
+
+PtySerial::PtySerial() : master_(-1), slave_(-1) { slave_name_[0] = '\0'; }
+
+PtySerial::~PtySerial() { close(); }
+
+bool PtySerial::open() {
+  close();
+  master_ = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (master_ < 0) {
+    return false;
+  }
+  if (grantpt(master_) != 0 || unlockpt(master_) != 0 ||
+      ptsname_r(master_, slave_name_, sizeof(slave_name_)) != 0) {
+    close();
+    return false;
+  }
+  slave_ = ::open(slave_name_, O_RDWR | O_NOCTTY | O_CLOEXEC);
+  if (slave_ < 0) {
+    close();
+    return false;
+  }
+
+  // Raw 8-bit line: no echo, no CR/LF translation, no signals on STX/ETX.
+  termios tio;
+  if (tcgetattr(slave_, &tio) == 0) {
+    cfmakeraw(&tio);
+    tcsetattr(slave_, TCSANOW, &tio);
+  }
+  return true;
+}
+
+void PtySerial::close() {
+  if (slave_ >= 0) {
+    ::close(slave_);
+    slave_ = -1;
+  }
+  if (master_ >= 0) {
+    ::close(master_);
+    master_ = -1;
+  }
+  slave_name_[0] = '\0';
+}
+
+size_t PtySerial::available() {
+  int n = 0;
+  if (ioctl(master_, FIONREAD, &n) != 0 || n < 0) {
+    return 0;
+  }
+  return static_cast<size_t>(n);
+}
+
+size_t PtySerial::read(uint8_t* buf, size_t cap) {
+  ssize_t n = ::read(master_, buf, cap);
+  return n > 0 ? static_cast<size_t>(n) : 0;
+}
+
+// The master is non-blocking and write() reports what fit, so offering a
+// page at a time is enough.
+size_t PtySerial::writable() { return 4096; }
+
+size_t PtySerial::write(const uint8_t* data, size_t len) {
+  ssize_t n = ::write(master_, data, len);
+  return n > 0 ? static_cast<size_t>(n) : 0;
+}
+
+// --- MonotonicClock ---
+
+uint32_t MonotonicClock::micros() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint32_t>(static_cast<uint64_t>(ts.tv_sec) * 1000000u +
+                               static_cast<uint64_t>(ts.tv_nsec) / 1000u);
+}
+
+// --- PollWaiter ---
+
+void PollWaiter::wait(uint32_t timeout_us) {
+  pollfd fds[2];
+  fds[0].fd = udp_fd_;
+  fds[0].events = POLLIN;
+  fds[1].fd = uart_fd_;
+  fds[1].events = POLLIN;
+  timespec timeout;
+  timeout.tv_sec = timeout_us / 1000000u;
+  timeout.tv_nsec = static_cast<long>(timeout_us % 1000000u) * 1000;
+  ppoll(fds, 2, &timeout, NULL);
+}
+
+// --- StderrLogSink ---
+
+void StderrLogSink::write(const LogRecord& record) {
+  char line[128];
+  formatLogRecord(record, line, sizeof(line));
+  fprintf(stderr, "%s\n", line);
+}
+
+bool parseIpv4(const char* text, uint32_t* ip) {
+  in_addr addr;
+  if (inet_pton(AF_INET, text, &addr) != 1) {
+    return false;
+  }
+  *ip = ntohl(addr.s_addr);
+  return true;
+}
+
+}  // namespace gw
@@ -0,0 +1,96 @@
+/*
+  Linux implementations of the gateway transport interfaces, used by the
+  simulator and the host tools.
+
+  - UdpSocket: a non-blocking IPv4 UDP socket bound to a local port.
+  - PtySerial: the master side of a pseudo-terminal standing in for Serial1.
+    Point a C2000 simulator (or `cat`, `socat`, a test script) at
+    slaveName().
+  - PollWaiter: sleeps in ppoll() until either of them is readable.
+*/
+
+#ifndef GATEWAY_HOST_LINUX_TRANSPORT_H_
+#define GATEWAY_HOST_LINUX_TRANSPORT_H_
+
+#include "gateway_log.h"
+#include "gateway_transport.h"
+
+namespace gw {
+
+class UdpSocket : public DatagramTransport {
+ public:
+  UdpSocket();
+  virtual ~UdpSocket();
+
+  // Binds to port on all interfaces. Returns false on failure (errno set).
+  bool open(uint16_t port);
+  void close();
+  int fd() const { return fd_; }
+
+  virtual size_t receive(uint8_t* buf, size_t cap, Endpoint* from);
+  virtual bool send(const Endpoint& to, const uint8_t* data, size_t len);
+
+ private:
+  UdpSocket(const UdpSocket&);
+  UdpSocket& operator=(const UdpSocket&);
+
+  int fd_;
+};
+
+class PtySerial : public SerialPort {
+ public:
+  PtySerial();
+  virtual ~PtySerial();
+
+  // Allocates a raw-mode pseudo-terminal. Returns false on failure.
+  bool open();
+  void close();
+  int fd() const { return master_; }
+  const char* slaveName() const { return slave_name_; }
+
+  virtual size_t available();
+  virtual size_t read(uint8_t* buf, size_t cap);
+  virtual size_t writable();
+  virtual size_t write(const uint8_t* data, size_t len);
+
+ private:
+  PtySerial(const PtySerial&);
+  PtySerial& operator=(const PtySerial&);
+
+  int master_;
+  // Held open so the master does not see EIO while no peer is attached.
+  int slave_;
+  char slave_name_[64];
+};
+
+// Idle wait on file descriptors, typically UdpSocket::fd() and
+// PtySerial::fd(). Wakes as soon as one is readable.
+class PollWaiter : public IdleWaiter {
+ public:
+  PollWaiter(int udp_fd, int uart_fd) : udp_fd_(udp_fd), uart_fd_(uart_fd) {}
+
+  virtual void wait(uint32_t timeout_us);
+
+ private:
+  int udp_fd_;
+  int uart_fd_;
+};
+
+// CLOCK_MONOTONIC in microseconds, truncated to 32 bits like micros().
+class MonotonicClock : public Clock {
+ public:
+  virtual uint32_t micros();
+};
+
+// Prints log records on stderr, one line each.
+class StderrLogSink : public LogSink {
+ public:
+  virtual void write(const LogRecord& record);
+};
+
+// Parses "a.b.c.d" into a host-order address. Returns false on bad input.
+bool parseIpv4(const char* text, uint32_t* ip);
+
+}  // namespace gw
+
+#endif  // GATEWAY_HOST_LINUX_TRANSPORT_H_
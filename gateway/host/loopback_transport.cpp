@@ -0,0 +1,117 @@
+#include "loopback_transport.h"
+
+#include <string.h>
+#include <time.h>
+
+#include "gateway_config.h"
+
+namespace gw {
+
+// --- LoopbackUdp ---
+
+LoopbackUdp::LoopbackUdp() {
+  memset(&inbound_, 0, sizeof(inbound_));
+  memset(&outbound_, 0, sizeof(outbound_));
+}
+
+bool LoopbackUdp::Queue::push(const Endpoint& peer, const uint8_t* data,
+                              size_t len) {
+  if (head - tail == static_cast<uint32_t>(kSlots) || len > kMaxDatagram) {
+    dropped++;
+    return false;
+  }
+  Slot& slot = slots[head % kSlots];
+  slot.peer = peer;
+  slot.len = len;
+  memcpy(slot.data, data, len);
+  head++;
+  return true;
+}
+
+bool LoopbackUdp::inject(const Endpoint& from, const uint8_t* data,
+                         size_t len) {
+  return inbound_.push(from, data, len);
+}
+
+size_t LoopbackUdp::takeSent(Endpoint* to, const uint8_t** data) {
+  if (outbound_.head == outbound_.tail) {
+    return 0;
+  }
+  const Slot& slot = outbound_.slots[outbound_.tail % kSlots];
+  outbound_.tail++;
+  *to = slot.peer;
+  *data = slot.data;
+  return slot.len;
+}
+
+size_t LoopbackUdp::receive(uint8_t* buf, size_t cap, Endpoint* from) {
+  if (inbound_.head == inbound_.tail) {
+    return 0;
+  }
+  const Slot& slot = inbound_.slots[inbound_.tail % kSlots];
+  inbound_.tail++;
+  size_t n = slot.len < cap ? slot.len : cap;
+  memcpy(buf, slot.data, n);
+  *from = slot.peer;
+  return n;
+}
+
+bool LoopbackUdp::send(const Endpoint& to, const uint8_t* data, size_t len) {
+  return outbound_.push(to, data, len);
+}
+
+// --- LoopbackSerial ---
+
+LoopbackSerial::LoopbackSerial()
+    : rx_(rx_storage_, kRingSize),
+      tx_(tx_storage_, kRingSize),
+      paced_(false),
+      pacer_(GW_UART_BAUD, GW_UART_TX_FIFO),
+      inject_dropped_(0),
+      write_dropped_(0) {}
+
+size_t LoopbackSerial::inject(const uint8_t* data, size_t len) {
+  size_t n = rx_.write(data, len);
+  inject_dropped_ += static_cast<uint32_t>(len - n);
+  return n;
+}
+
+size_t LoopbackSerial::drain(uint8_t* buf, size_t cap) {
+  size_t n = tx_.readable() < cap ? tx_.readable() : cap;
+  tx_.copyOut(0, buf, n);
+  tx_.consume(n);
+  return n;
+}
+
+size_t LoopbackSerial::available() { return rx_.readable(); }
+
+size_t LoopbackSerial::read(uint8_t* buf, size_t cap) {
+  size_t n = rx_.readable() < cap ? rx_.readable() : cap;
+  rx_.copyOut(0, buf, n);
+  rx_.consume(n);
+  return n;
+}
+
+size_t LoopbackSerial::writable() {
+  size_t room = tx_.capacity() - tx_.readable();
+  if (!paced_) {
+    return room;
+  }
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  uint32_t now_us = static_cast<uint32_t>(ts.tv_sec * 1000000ull +
+                                          ts.tv_nsec / 1000);
+  size_t line = pacer_.writable(now_us);
+  return line < room ? line : room;
+}
+
+size_t LoopbackSerial::write(const uint8_t* data, size_t len) {
+  size_t n = tx_.write(data, len);
+  if (paced_) {
+    pacer_.wrote(n);
+  }
+  write_dropped_ += static_cast<uint32_t>(len - n);
+  return n;
+}
+
+}  // namespace gw
@@ -0,0 +1,105 @@
+/*
+  In-memory implementations of the gateway transport interfaces, for
+  driving a gw::Gateway from a test harness in the same process.
+
+  - LoopbackUdp: datagrams injected with inject() are returned by
+    receive(); everything the gateway sends is queued for takeSent().
+  - LoopbackSerial: a simulated serial endpoint. Bytes injected with
+    inject() are what the gateway reads; what it writes collects in a ring
+    the harness reads with drain(). With setPaced(true) writes are limited
+    to what a GW_UART_BAUD line would take, like the board's Serial1.
+
+  Both are bounded. Data that doesn't fit is refused and counted, the way
+  a full socket buffer or UART FIFO would lose it.
+*/
+
+#ifndef GATEWAY_HOST_LOOPBACK_TRANSPORT_H_
+#define GATEWAY_HOST_LOOPBACK_TRANSPORT_H_
+
+#include "gateway_transport.h"
+#include "ring_buffer.h"
+#include "tx_pacer.h"
+
+namespace gw {
+
+class LoopbackUdp : public DatagramTransport {
+ public:
+  static const int kSlots = 256;
+  static const size_t kMaxDatagram = 1500;
+
+  LoopbackUdp();
+
+  // Queues a datagram for the gateway. Returns false if the queue is full.
+  bool inject(const Endpoint& from, const uint8_t* data, size_t len);
+
+  // Takes the oldest datagram the gateway sent. Returns its length, or 0
+  // if there is none. data stays valid until the next call.
+  size_t takeSent(Endpoint* to, const uint8_t** data);
+
+  uint32_t injectDropped() const { return inbound_.dropped; }
+  uint32_t sendDropped() const { return outbound_.dropped; }
+
+  virtual size_t receive(uint8_t* buf, size_t cap, Endpoint* from);
+  virtual bool send(const Endpoint& to, const uint8_t* data, size_t len);
+
+ private:
+  struct Slot {
+    Endpoint peer;
+    size_t len;
+    uint8_t data[kMaxDatagram];
+  };
+  struct Queue {
+    Slot slots[kSlots];
+    uint32_t head;
+    uint32_t tail;
+    uint32_t dropped;
+
+    bool push(const Endpoint& peer, const uint8_t* data, size_t len);
+  };
+
+  LoopbackUdp(const LoopbackUdp&);
+  LoopbackUdp& operator=(const LoopbackUdp&);
+
+  Queue inbound_;
+  Queue outbound_;
+};
+
+class LoopbackSerial : public SerialPort {
+ public:
+  static const uint32_t kRingSize = 1 << 16;
+
+  LoopbackSerial();
+
+  // Bytes "sent by the C2000". Returns the number accepted.
+  size_t inject(const uint8_t* data, size_t len);
+
+  // Bytes the gateway wrote, oldest first. Returns the number copied.
+  size_t drain(uint8_t* buf, size_t cap);
+
+  void setPaced(bool paced) { paced_ = paced; }
+
+  uint32_t injectDropped() const { return inject_dropped_; }
+  uint32_t writeDropped() const { return write_dropped_; }
+
+  virtual size_t available();
+  virtual size_t read(uint8_t* buf, size_t cap);
+  virtual size_t writable();
+  virtual size_t write(const uint8_t* data, size_t len);
+
+ private:
+  LoopbackSerial(const LoopbackSerial&);
+  LoopbackSerial& operator=(const LoopbackSerial&);
+
+  uint8_t rx_storage_[kRingSize];
+  uint8_t tx_storage_[kRingSize];
+  SpscRing rx_;  // C2000 -> gateway
+  SpscRing tx_;  // gateway -> C2000
+  bool paced_;
+  TxPacer pacer_;
+  uint32_t inject_dropped_;
+  uint32_t write_dropped_;
+};
+
+}  // namespace gw
+
+#endif  // GATEWAY_HOST_LOOPBACK_TRANSPORT_H_
@@ -0,0 +1,341 @@
+/*
+  Microbenchmark for UART frame extraction on a block of synthetic serial
+  input:
+
+    scanner_bench [--mode stx|cobs] [--frame-bytes N] [--noise PCT]
+                  [--chunk N] [--mb N] [--runs N]
+
+  The input is --mb megabytes of frames of about --frame-bytes each (ASCII
+  telemetry between STX and ETX, or COBS-style bytes ending in 0x00), with
+  --noise percent of them preceded by line noise, a truncated frame or an
+  empty frame. It is fed in --chunk byte reads, the way a bulk read() of
+  the serial port delivers it, to:
+
+    bytewise      one byte at a time through a state machine, as loop()
+                  used to read Serial1, copying each frame out
+    ring          FrameScanner over an SpscRing (the gateway's path)
+    span          SpanFrameExtractor on the read buffer, findDelimiter()
+    span-scalar   SpanFrameExtractor with the portable word-at-a-time search
+
+  Each reports MB/s and ns per frame (best of --runs); all of them must
+  agree on the frame count and a checksum over the frames, or the
+  benchmark fails.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+
+#include "frame_scanner.h"
+#include "frame_span.h"
+#include "gateway_config.h"
+#include "ring_buffer.h"
+#include "span_frame_extractor.h"
+
+namespace {
+
+const size_t kMaxFrame = GW_UART_FRAME_SIZE;
+// Largest --frame-bytes whose truncated-plus-whole pairs still fit
+const size_t kMaxSize = (kMaxFrame - 8) * 2 / 3;
+
+struct Options {
+  gw::FrameMode mode;
+  size_t frame_bytes;
+  unsigned noise_pct;
+  size_t chunk;
+  double mb;
+  int runs;
+};
+
+struct Result {
+  unsigned long frames;
+  uint32_t checksum;
+};
+
+uint64_t nowNs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull +
+         static_cast<uint64_t>(ts.tv_nsec);
+}
+
+void usage(const char* argv0) {
+  fprintf(stderr,
+          "usage: %s [--mode stx|cobs] [--frame-bytes N] [--noise PCT]\n"
+          "       [--chunk N] [--mb N] [--runs N]\n",
+          argv0);
+}
+
+bool parseOptions(int argc, char** argv, Options* opt) {
+  opt->mode = gw::kFrameStxEtx;
+  opt->frame_bytes = 48;
+  opt->noise_pct = 1;
+  opt->chunk = 4096;
+  opt->mb = 64;
+  opt->runs = 5;
+
+  for (int i = 1; i < argc; i++) {
+    bool more = i + 1 < argc;
+    if (strcmp(argv[i], "--mode") == 0 && more) {
+      ++i;
+      if (strcmp(argv[i], "stx") == 0) {
+        opt->mode = gw::kFrameStxEtx;
+      } else if (strcmp(argv[i], "cobs") == 0) {
+        opt->mode = gw::kFrameCobs;
+      } else {
+        return false;
+      }
+    } else if (strcmp(argv[i], "--frame-bytes") == 0 && more) {
+      opt->frame_bytes = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--noise") == 0 && more) {
+      opt->noise_pct = static_cast<unsigned>(strtoul(argv[++i], NULL, 10));
+    } else if (strcmp(argv[i], "--chunk") == 0 && more) {
+      opt->chunk = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--mb") == 0 && more) {
+      opt->mb = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--runs") == 0 && more) {
+      opt->runs = atoi(argv[++i]);
+    } else {
+      return false;
+    }
+  }
+  // Overlong frames are dropped at read boundaries by the buffered
+  // extractors but byte by byte here, so the input must not contain any
+  return opt->frame_bytes >= 3 && opt->frame_bytes <= kMaxSize &&
+         opt->chunk > 0 && opt->mb > 0 && opt->runs > 0;
+}
+
+// --- Input ---
+
+uint32_t g_seed = 12345;
+
+uint32_t random32() {
+  g_seed = g_seed * 1664525u + 1013904223u;
+  return g_seed >> 8;
+}
+
+void appendFrame(const Options& opt, std::vector<uint8_t>* out) {
+  size_t body = opt.frame_bytes - 2 + random32() % 9;
+  if (opt.mode == gw::kFrameStxEtx) {
+    out->push_back(GW_STX);
+    for (size_t i = 0; i < body; i++) {
+      out->push_back(i % 6 == 5 ? ',' : '0' + random32() % 10);
+    }
+    out->push_back(GW_ETX);
+  } else {
+    for (size_t i = 0; i < body + 1; i++) {
+      out->push_back(static_cast<uint8_t>(1 + random32() % 255));
+    }
+    out->push_back(0x00);
+  }
+}
+
+void appendNoise(const Options& opt, std::vector<uint8_t>* out) {
+  switch (random32() % 3) {
+    case 0:  // Line noise, no delimiters
+      for (int i = random32() % 16; i >= 0; i--) {
+        out->push_back(static_cast<uint8_t>(0x20 + random32() % 0x5f));
+      }
+      break;
+    case 1: {  // A frame cut short: STX with no ETX, or a run with no 0x00
+      std::vector<uint8_t> frame;
+      appendFrame(opt, &frame);
+      out->insert(out->end(), frame.begin(), frame.begin() + frame.size() / 2);
+      break;
+    }
+    default:  // Empty frame
+      if (opt.mode == gw::kFrameStxEtx) {
+        out->push_back(GW_STX);
+        out->push_back(GW_ETX);
+      } else {
+        out->push_back(0x00);
+      }
+      break;
+  }
+}
+
+// --- Extractors ---
+
+inline void account(const uint8_t* data, size_t len, Result* r) {
+  // Order-sensitive, so a frame cut in the wrong place changes it
+  uint32_t h = r->checksum;
+  for (size_t i = 0; i < len; i += 8) {
+    h = (h ^ data[i]) * 16777619u;
+  }
+  r->checksum = (h ^ (uint32_t)len ^ data[len - 1]) * 16777619u;
+  r->frames++;
+}
+
+// The state machine the sketch used to run per byte, with FrameScanner's
+// rules so the results are comparable.
+class ByteWise {
+ public:
+  explicit ByteWise(gw::FrameMode mode)
+      : mode_(mode), in_frame_(false), len_(0) {}
+
+  void feed(const uint8_t* data, size_t n, Result* r) {
+    for (size_t i = 0; i < n; i++) {
+      uint8_t c = data[i];
+      if (mode_ == gw::kFrameCobs) {
+        frame_[len_++] = c;
+        if (c == 0x00) {
+          if (len_ > 1) {
+            account(frame_, len_, r);
+          }
+          len_ = 0;
+        } else if (len_ >= kMaxFrame) {
+          len_ = 0;
+        }
+        continue;
+      }
+      if (c == GW_STX) {
+        frame_[0] = c;
+        len_ = 1;
+        in_frame_ = true;
+      } else if (!in_frame_) {
+        continue;
+      } else if (c == GW_ETX) {
+        frame_[len_++] = c;
+        if (len_ > 2) {
+          account(frame_, len_, r);
+        }
+        in_frame_ = false;
+      } else if (len_ + 1 < kMaxFrame) {
+        frame_[len_++] = c;
+      } else {
+        in_frame_ = false;  // No room left for the ETX
+      }
+    }
+  }
+
+ private:
+  gw::FrameMode mode_;
+  bool in_frame_;
+  size_t len_;
+  uint8_t frame_[kMaxFrame];
+};
+
+Result runByteWise(const Options& opt, const std::vector<uint8_t>& input) {
+  Result r = {0, 2166136261u};
+  ByteWise machine(opt.mode);
+  uint8_t* buf = new uint8_t[opt.chunk];
+  for (size_t at = 0; at < input.size(); at += opt.chunk) {
+    size_t n = input.size() - at < opt.chunk ? input.size() - at : opt.chunk;
+    memcpy(buf, &input[at], n);  // The read() into a user buffer
+    machine.feed(buf, n, &r);
+  }
+  delete[] buf;
+  return r;
+}
+
+Result runRing(const Options& opt, const std::vector<uint8_t>& input) {
+  Result r = {0, 2166136261u};
+  uint32_t capacity = 1;
+  while (capacity < opt.chunk + kMaxFrame) {
+    capacity <<= 1;
+  }
+  std::vector<uint8_t> storage(capacity);
+  uint8_t scratch[kMaxFrame];
+  gw::SpscRing ring(&storage[0], capacity);
+  gw::FrameScanner scanner(ring, scratch, kMaxFrame, opt.mode);
+  gw::FrameView frame;
+  for (size_t at = 0; at < input.size(); at += opt.chunk) {
+    size_t n = input.size() - at < opt.chunk ? input.size() - at : opt.chunk;
+    ring.write(&input[at], n);
+    while (scanner.next(&frame)) {
+      account(frame.data, frame.len, &r);
+    }
+  }
+  scanner.release();
+  return r;
+}
+
+Result runSpan(const Options& opt, const std::vector<uint8_t>& input,
+               bool scalar) {
+  Result r = {0, 2166136261u};
+  std::vector<uint8_t> buf(opt.chunk + kMaxFrame);
+  gw::SpanFrameExtractor extractor(opt.mode, kMaxFrame, scalar);
+  gw::FrameView frame;
+  size_t len = 0;
+  for (size_t at = 0; at < input.size(); at += opt.chunk) {
+    size_t n = input.size() - at < opt.chunk ? input.size() - at : opt.chunk;
+    memcpy(&buf[len], &input[at], n);  // The read() after the kept tail
+    len += n;
+    extractor.reset(&buf[0], len);
+    while (extractor.next(&frame)) {
+      account(frame.data, frame.len, &r);
+    }
+    len -= extractor.consumed();
+    memmove(&buf[0], &buf[extractor.consumed()], len);
+  }
+  return r;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!parseOptions(argc, argv, &opt)) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  std::vector<uint8_t> input;
+  size_t total = static_cast<size_t>(opt.mb * 1024 * 1024);
+  input.reserve(total + kMaxFrame * 2);
+  while (input.size() < total) {
+    if (random32() % 100 < opt.noise_pct) {
+      appendNoise(opt, &input);
+    }
+    appendFrame(opt, &input);
+  }
+
+  printf("%.1f MB, %s frames of ~%zu bytes, %u%% noise, %zu-byte reads, "
+         "findDelimiter: %s\n",
+         input.size() / 1048576.0,
+         opt.mode == gw::kFrameCobs ? "COBS" : "STX/ETX", opt.frame_bytes,
+         opt.noise_pct, opt.chunk, gw::findDelimiterKind());
+
+  const char* names[] = {"bytewise", "ring", "span", "span-scalar"};
+  Result first = {0, 0};
+  bool agree = true;
+  for (int e = 0; e < 4; e++) {
+    Result r = {0, 0};
+    uint64_t best = ~0ull;
+    for (int run = 0; run < opt.runs; run++) {
+      uint64_t start = nowNs();
+      switch (e) {
+        case 0:
+          r = runByteWise(opt, input);
+          break;
+        case 1:
+          r = runRing(opt, input);
+          break;
+        default:
+          r = runSpan(opt, input, e == 3);
+          break;
+      }
+      uint64_t took = nowNs() - start;
+      if (took < best) {
+        best = took;
+      }
+    }
+    if (e == 0) {
+      first = r;
+    } else if (r.frames != first.frames || r.checksum != first.checksum) {
+      agree = false;
+    }
+    printf("%-12s %8.0f MB/s %8.1f ns/frame  %lu frames  %08x\n", names[e],
+           input.size() / 1048576.0 / (best / 1e9),
+           r.frames ? static_cast<double>(best) / r.frames : 0.0, r.frames,
+           r.checksum);
+  }
+  if (!agree) {
+    fprintf(stderr, "extractors disagree\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,103 @@
+#include "span_frame_extractor.h"
+
+#include "frame_span.h"
+#include "gateway_config.h"
+
+namespace gw {
+
+SpanFrameExtractor::SpanFrameExtractor(FrameMode mode, size_t max_frame,
+                                       bool force_scalar)
+    : mode_(mode),
+      max_frame_(max_frame),
+      force_scalar_(force_scalar),
+      data_(0),
+      len_(0),
+      pos_(0),
+      overflow_resets_(0) {}
+
+void SpanFrameExtractor::reset(const uint8_t* data, size_t len) {
+  data_ = data;
+  len_ = len;
+  pos_ = 0;
+}
+
+size_t SpanFrameExtractor::find(size_t from, uint8_t a, uint8_t b) const {
+  size_t n = len_ - from;
+  return from + (force_scalar_ ? findDelimiterScalar(data_ + from, n, a, b)
+                               : findDelimiter(data_ + from, n, a, b));
+}
+
+bool SpanFrameExtractor::next(FrameView* frame) {
+  return mode_ == kFrameCobs ? nextCobs(frame) : nextStxEtx(frame);
+}
+
+bool SpanFrameExtractor::nextStxEtx(FrameView* frame) {
+  for (;;) {
+    // Discard line noise up to the next STX
+    size_t start = find(pos_, GW_STX, GW_STX);
+    if (start == len_) {
+      pos_ = len_;
+      return false;
+    }
+    size_t end = find(start + 1, GW_STX, GW_ETX);
+    if (end == len_) {
+      // Incomplete frame; kept for the next buffer unless it can't fit
+      if (len_ - start >= max_frame_) {
+        pos_ = len_;
+        overflow_resets_++;
+      } else {
+        pos_ = start;
+      }
+      return false;
+    }
+    if (data_[end] == GW_STX) {
+      // A new STX before the ETX: the partial frame is abandoned
+      if (end - start >= max_frame_) {
+        overflow_resets_++;
+      }
+      pos_ = end;
+      continue;
+    }
+
+    size_t len = end - start + 1;
+    pos_ = end + 1;
+    if (len > max_frame_) {
+      overflow_resets_++;
+      continue;
+    }
+    if (len == 2) {
+      continue;  // Empty STX ETX
+    }
+    frame->data = data_ + start;
+    frame->len = len;
+    return true;
+  }
+}
+
+bool SpanFrameExtractor::nextCobs(FrameView* frame) {
+  for (;;) {
+    size_t end = find(pos_, 0x00, 0x00);
+    if (end == len_) {
+      if (len_ - pos_ >= max_frame_) {
+        pos_ = len_;
+        overflow_resets_++;
+      }
+      return false;
+    }
+    size_t start = pos_;
+    size_t len = end - start + 1;
+    pos_ = end + 1;
+    if (len > max_frame_) {
+      overflow_resets_++;
+      continue;
+    }
+    if (len == 1) {
+      continue;
+    }
+    frame->data = data_ + start;
+    frame->len = len;
+    return true;
+  }
+}
+
+}  // namespace gw
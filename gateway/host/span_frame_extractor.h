@@ -0,0 +1,64 @@
+/*
+  Frame extraction from one contiguous read() buffer, for comparison with
+  FrameScanner in gateway_scanner_bench.
+
+  SpanFrameExtractor applies the FrameScanner framing rules
+  (frame_scanner.h) to the buffer and hands out views into it without
+  copying, finding delimiters with findDelimiter() (frame_span.h). A
+  frame cut off by the end of the buffer is left unconsumed; the caller
+  moves the tail from consumed() on to the front and appends the next
+  read:
+
+    extractor.reset(buf, len);
+    while (extractor.next(&frame)) handle(frame);
+    len -= extractor.consumed(); memmove(buf, buf + extractor.consumed(), len);
+
+  The gateway itself reads the UART through FrameScanner on its ring, so
+  this lives with the host tools rather than in the core.
+*/
+
+#ifndef GATEWAY_HOST_SPAN_FRAME_EXTRACTOR_H_
+#define GATEWAY_HOST_SPAN_FRAME_EXTRACTOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frame_scanner.h"
+
+namespace gw {
+
+class SpanFrameExtractor {
+ public:
+  // force_scalar selects findDelimiterScalar(), for benchmarks.
+  SpanFrameExtractor(FrameMode mode, size_t max_frame,
+                     bool force_scalar = false);
+
+  // Starts on a new buffer. Framing state does not carry over: the buffer
+  // must start with the unconsumed tail of the previous one.
+  void reset(const uint8_t* data, size_t len);
+
+  // Finds the next complete frame; the view points into the buffer.
+  bool next(FrameView* frame);
+
+  // Bytes that are done with: frames handed out and discarded noise.
+  size_t consumed() const { return pos_; }
+
+  uint32_t overflowResets() const { return overflow_resets_; }
+
+ private:
+  size_t find(size_t from, uint8_t a, uint8_t b) const;
+  bool nextStxEtx(FrameView* frame);
+  bool nextCobs(FrameView* frame);
+
+  FrameMode mode_;
+  size_t max_frame_;
+  bool force_scalar_;
+  const uint8_t* data_;
+  size_t len_;
+  size_t pos_;
+  uint32_t overflow_resets_;
+};
+
+}  // namespace gw
+
+#endif  // GATEWAY_HOST_SPAN_FRAME_EXTRACTOR_H_
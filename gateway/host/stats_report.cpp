@@ -0,0 +1,98 @@
+#include "stats_report.h"
+
+namespace gw {
+
+namespace {
+
+const uint32_t kUnbounded = 0xffffffffUL;
+
+void printPercentile(FILE* out, const char* label, uint32_t us) {
+  if (us == kUnbounded) {
+    fprintf(out, " %s>=%u us", label,
+            LatencyHistogram::bucketLimit(kLatencyBuckets - 2));
+  } else {
+    fprintf(out, " %s<%u us", label, us);
+  }
+}
+
+void printHistogram(FILE* out, const char* name, const LatencyHistogram& h) {
+  fprintf(out, "%s latency: %u samples", name, h.total());
+  if (h.total() > 0) {
+    printPercentile(out, "p50", h.percentile(500));
+    printPercentile(out, "p99", h.percentile(990));
+    printPercentile(out, "p99.9", h.percentile(999));
+  }
+  fprintf(out, "\n");
+}
+
+void printHistogramJson(FILE* out, const char* name,
+                        const LatencyHistogram& h) {
+  fprintf(out,
+          "\"%s\": {\"count\": %u, \"p50_us\": %u, \"p99_us\": %u, "
+          "\"p999_us\": %u, \"buckets\": [",
+          name, h.total(), h.percentile(500), h.percentile(990),
+          h.percentile(999));
+  for (int i = 0; i < kLatencyBuckets; i++) {
+    fprintf(out, "%s%u", i ? ", " : "", h.counts[i]);
+  }
+  fprintf(out, "]}");
+}
+
+void printTasks(FILE* out, const StatsSnapshot& stats) {
+  for (int i = 0; i < kTaskCount; i++) {
+    const TaskStats& t = stats.tasks[i];
+    fprintf(out, "task %-12s %u runs, max %u us, %u over budget\n",
+            taskName(i), t.runs, t.max_us, t.overruns);
+  }
+}
+
+void printTasksJson(FILE* out, const StatsSnapshot& stats) {
+  fprintf(out, "\"tasks\": {");
+  for (int i = 0; i < kTaskCount; i++) {
+    const TaskStats& t = stats.tasks[i];
+    fprintf(out,
+            "%s\"%s\": {\"runs\": %u, \"max_us\": %u, \"overruns\": %u}",
+            i ? ", " : "", taskName(i), t.runs, t.max_us, t.overruns);
+  }
+  fprintf(out, "}");
+}
+
+}  // namespace
+
+void printStats(FILE* out, const StatsSnapshot& stats) {
+  const uint32_t* counters = reinterpret_cast<const uint32_t*>(&stats.counters);
+  fprintf(out, "uptime %.1f s\n", stats.uptime_ms / 1e3);
+  for (size_t i = 0; i < kCounterCount; i++) {
+    fprintf(out, "%s%s %u", i ? ", " : "", counterName(i), counters[i]);
+  }
+  fprintf(out, "\n");
+  uint32_t total_ms = stats.counters.awake_ms + stats.counters.idle_ms;
+  if (total_ms > 0) {
+    fprintf(out, "duty cycle %.1f%% (awake %u ms, asleep %u ms)\n",
+            100.0 * stats.counters.awake_ms / total_ms,
+            stats.counters.awake_ms, stats.counters.idle_ms);
+  }
+  printHistogram(out, "command", stats.command);
+  printHistogram(out, "telemetry", stats.telemetry);
+  printHistogram(out, "loop", stats.loop);
+  printTasks(out, stats);
+}
+
+void printStatsJson(FILE* out, const StatsSnapshot& stats) {
+  const uint32_t* counters = reinterpret_cast<const uint32_t*>(&stats.counters);
+  fprintf(out, "{\"uptime_ms\": %u, \"counters\": {", stats.uptime_ms);
+  for (size_t i = 0; i < kCounterCount; i++) {
+    fprintf(out, "%s\"%s\": %u", i ? ", " : "", counterName(i), counters[i]);
+  }
+  fprintf(out, "}, ");
+  printHistogramJson(out, "command", stats.command);
+  fprintf(out, ", ");
+  printHistogramJson(out, "telemetry", stats.telemetry);
+  fprintf(out, ", ");
+  printHistogramJson(out, "loop", stats.loop);
+  fprintf(out, ", ");
+  printTasksJson(out, stats);
+  fprintf(out, "}\n");
+}
+
+}  // namespace gw
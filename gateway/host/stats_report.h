@@ -0,0 +1,23 @@
+/*
+  Text and JSON rendering of a gateway StatsSnapshot for the host tools.
+*/
+
+#ifndef GATEWAY_HOST_STATS_REPORT_H_
+#define GATEWAY_HOST_STATS_REPORT_H_
+
+#include <stdio.h>
+
+#include "gateway_stats.h"
+
+namespace gw {
+
+// Counters, p50/p99/p99.9 of each histogram and per-task timings, human
+// readable.
+void printStats(FILE* out, const StatsSnapshot& stats);
+
+// The same plus raw bucket counts, as one JSON object.
+void printStatsJson(FILE* out, const StatsSnapshot& stats);
+
+}  // namespace gw
+
+#endif  // GATEWAY_HOST_STATS_REPORT_H_
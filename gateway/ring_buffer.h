@@ -0,0 +1,132 @@
+/*
+  Lock-free single-producer / single-consumer byte ring.
+
+  The producer (UART receive: an ISR or a bulk read in the main loop) and
+  the consumer (the frame scanner) each own one index, so no lock is needed
+  as long as there is exactly one of each. Both sides work on contiguous
+  spans of the storage rather than single bytes.
+
+  Indices run freely and are masked on access, which is why the capacity
+  must be a power of two.
+*/
+
+#ifndef GATEWAY_RING_BUFFER_H_
+#define GATEWAY_RING_BUFFER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace gw {
+
+class SpscRing {
+ public:
+  // storage must outlive the ring; capacity must be a power of two.
+  SpscRing(uint8_t* storage, uint32_t capacity)
+      : buf_(storage), mask_(capacity - 1), head_(0), tail_(0) {}
+
+  uint32_t capacity() const { return mask_ + 1; }
+
+  // Free-running byte positions: everything ever committed / consumed.
+  uint32_t writePosition() const {
+    return __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+  }
+  uint32_t readPosition() const {
+    return __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+  }
+
+  // --- Producer side ---
+
+  // Returns the contiguous free span starting at the write position. At
+  // most two calls to writeSpan()/commit() fill all free space.
+  size_t writeSpan(uint8_t** span) {
+    uint32_t head = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+    uint32_t free_bytes = capacity() - (head - tail);
+    uint32_t to_end = capacity() - (head & mask_);
+    *span = buf_ + (head & mask_);
+    return free_bytes < to_end ? free_bytes : to_end;
+  }
+
+  // Publishes n bytes written into the last writeSpan().
+  void commit(size_t n) {
+    uint32_t head = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+    __atomic_store_n(&head_, head + (uint32_t)n, __ATOMIC_RELEASE);
+  }
+
+  // Copies as much of data as fits. Returns the number of bytes queued.
+  size_t write(const uint8_t* data, size_t len) {
+    size_t done = 0;
+    for (int pass = 0; pass < 2 && done < len; pass++) {
+      uint8_t* span;
+      size_t n = writeSpan(&span);
+      if (n == 0) {
+        break;
+      }
+      if (n > len - done) {
+        n = len - done;
+      }
+      memcpy(span, data + done, n);
+      commit(n);
+      done += n;
+    }
+    return done;
+  }
+
+  // --- Consumer side ---
+
+  size_t readable() const {
+    uint32_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+    uint32_t tail = __atomic_load_n(&tail_, __ATOMIC_RELAXED);
+    return head - tail;
+  }
+
+  // Returns the contiguous readable span starting offset bytes past the
+  // read position. offset must be below readable().
+  size_t readSpan(size_t offset, const uint8_t** span) const {
+    uint32_t pos = __atomic_load_n(&tail_, __ATOMIC_RELAXED) + (uint32_t)offset;
+    size_t avail = readable() - offset;
+    size_t to_end = capacity() - (pos & mask_);
+    *span = buf_ + (pos & mask_);
+    return avail < to_end ? avail : to_end;
+  }
+
+  // Byte at offset past the read position. offset must be below readable().
+  uint8_t at(size_t offset) const {
+    return buf_[(__atomic_load_n(&tail_, __ATOMIC_RELAXED) + offset) & mask_];
+  }
+
+  // Copies len bytes starting offset past the read position into out.
+  void copyOut(size_t offset, uint8_t* out, size_t len) const {
+    while (len > 0) {
+      const uint8_t* span;
+      size_t n = readSpan(offset, &span);
+      if (n > len) {
+        n = len;
+      }
+      memcpy(out, span, n);
+      out += n;
+      offset += n;
+      len -= n;
+    }
+  }
+
+  // Releases n bytes back to the producer.
+  void consume(size_t n) {
+    uint32_t tail = __atomic_load_n(&tail_, __ATOMIC_RELAXED);
+    __atomic_store_n(&tail_, tail + (uint32_t)n, __ATOMIC_RELEASE);
+  }
+
+ private:
+  SpscRing(const SpscRing&);
+  SpscRing& operator=(const SpscRing&);
+
+  uint8_t* const buf_;
+  const uint32_t mask_;
+  uint32_t head_;  // Written by the producer only
+  uint32_t tail_;  // Written by the consumer only
+};
+
+}  // namespace gw
+
+#endif  // GATEWAY_RING_BUFFER_H_
@@ -0,0 +1,80 @@
+#include "scheduler.h"
+
+#include <string.h>
+
+namespace gw {
+
+Scheduler::Scheduler(Clock& clock) : clock_(clock), count_(0) {
+  memset(tasks_, 0, sizeof(tasks_));
+  loop_time_.clear();
+}
+
+int Scheduler::add(TaskFn fn, void* context, uint32_t budget_us,
+                   uint32_t period_us, bool idle_only) {
+  if (count_ == kMaxTasks) {
+    return -1;
+  }
+  Task& t = tasks_[count_];
+  t.fn = fn;
+  t.context = context;
+  t.budget_us = budget_us;
+  t.period_us = period_us;
+  t.idle_only = idle_only;
+  t.last_run_us = clock_.micros() - period_us;  // Due straight away
+  return count_++;
+}
+
+bool Scheduler::runTask(Task& task, uint32_t now) {
+  task.last_run_us = now;
+  bool busy = task.fn(task.context, now + task.budget_us);
+  uint32_t took = clock_.micros() - now;
+  task.stats.runs++;
+  if (took > task.stats.max_us) {
+    task.stats.max_us = took;
+  }
+  if (took > task.budget_us) {
+    task.stats.overruns++;
+  }
+  return busy;
+}
+
+bool Scheduler::runOnce() {
+  uint32_t start = clock_.micros();
+  uint32_t now = start;
+  bool busy = false;
+  for (int pass = 0; pass < 2; pass++) {
+    // Pass 0 runs the regular tasks, pass 1 the idle-only ones
+    if (pass == 1 && busy) {
+      break;
+    }
+    for (int i = 0; i < count_; i++) {
+      Task& t = tasks_[i];
+      if (t.idle_only != (pass == 1) ||
+          (t.period_us > 0 && now - t.last_run_us < t.period_us)) {
+        continue;
+      }
+      busy |= runTask(t, now);
+      now = clock_.micros();
+    }
+  }
+  loop_time_.record(now - start);
+  return busy;
+}
+
+uint32_t Scheduler::untilDue(uint32_t now_us, uint32_t max_us) const {
+  uint32_t wait = max_us;
+  for (int i = 0; i < count_; i++) {
+    const Task& t = tasks_[i];
+    if (t.period_us == 0) {
+      continue;
+    }
+    uint32_t since = now_us - t.last_run_us;
+    uint32_t left = since < t.period_us ? t.period_us - since : 0;
+    if (left < wait) {
+      wait = left;
+    }
+  }
+  return wait;
+}
+
+}  // namespace gw
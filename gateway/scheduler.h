@@ -0,0 +1,80 @@
+/*
+  Cooperative scheduler for the gateway loop.
+
+  Each task is a function that gets a deadline and returns once its work
+  is done or the deadline has passed, leaving the rest for its next turn
+  (frames stay in the UART ring, datagrams in the network stack). One
+  runOnce() call, made from loop(), gives every due task one turn in the
+  order they were added, so a burst in one direction can delay the other
+  by at most that task's budget plus one unit of work.
+
+  A task may run every iteration (period 0) or at most once per period,
+  and may be marked idle-only: it then runs only on iterations where no
+  other task reported work.
+
+  Every turn is timed. Per task the scheduler keeps its longest run and
+  how often it overran its budget; per iteration a latency histogram of
+  the whole loop. These are what bound the latency of each direction.
+*/
+
+#ifndef GATEWAY_SCHEDULER_H_
+#define GATEWAY_SCHEDULER_H_
+
+#include <stdint.h>
+
+#include "gateway_stats.h"
+#include "gateway_transport.h"
+
+namespace gw {
+
+const int kMaxTasks = 8;
+
+// True once the clock has reached deadline_us (wrap-safe).
+inline bool pastDeadline(Clock& clock, uint32_t deadline_us) {
+  return (int32_t)(clock.micros() - deadline_us) >= 0;
+}
+
+class Scheduler {
+ public:
+  // Runs one turn. Returns true if the task did any work.
+  typedef bool (*TaskFn)(void* context, uint32_t deadline_us);
+
+  explicit Scheduler(Clock& clock);
+
+  // Adds a task; returns its index, or -1 if the table is full.
+  int add(TaskFn fn, void* context, uint32_t budget_us, uint32_t period_us,
+          bool idle_only);
+
+  // Gives every due task one turn. Returns true if any did work.
+  bool runOnce();
+
+  // Microseconds until the next periodic task is due, at most max_us;
+  // how long the loop may sleep as far as the scheduler is concerned.
+  uint32_t untilDue(uint32_t now_us, uint32_t max_us) const;
+
+  int taskCount() const { return count_; }
+  const TaskStats& taskStats(int i) const { return tasks_[i].stats; }
+  const LatencyHistogram& loopTime() const { return loop_time_; }
+
+ private:
+  struct Task {
+    TaskFn fn;
+    void* context;
+    uint32_t budget_us;
+    uint32_t period_us;
+    bool idle_only;
+    uint32_t last_run_us;
+    TaskStats stats;
+  };
+
+  bool runTask(Task& task, uint32_t now);
+
+  Clock& clock_;
+  Task tasks_[kMaxTasks];
+  int count_;
+  LatencyHistogram loop_time_;
+};
+
+}  // namespace gw
+
+#endif  // GATEWAY_SCHEDULER_H_
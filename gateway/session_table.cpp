@@ -0,0 +1,73 @@
+#include "session_table.h"
+
+#include <string.h>
+
+namespace gw {
+
+SessionTable::SessionTable() : controller_(-1), live_count_(0) {
+  memset(sessions_, 0, sizeof(sessions_));
+}
+
+int SessionTable::touch(const Endpoint& peer, uint32_t now_us, bool* created) {
+  *created = false;
+  int free_slot = -1;
+  for (int i = 0; i < GW_MAX_SESSIONS; i++) {
+    Session& s = sessions_[i];
+    if (!s.live) {
+      if (free_slot < 0) {
+        free_slot = i;
+      }
+    } else if (s.peer == peer) {
+      s.last_seen_us = now_us;
+      return i;
+    }
+  }
+  if (free_slot < 0) {
+    return -1;
+  }
+  Session& s = sessions_[free_slot];
+  s.peer = peer;
+  s.last_seen_us = now_us;
+  s.live = true;
+  s.binary = false;
+  s.seq_valid = false;
+  s.last_seq = 0;
+  live_count_++;
+  *created = true;
+  return free_slot;
+}
+
+int SessionTable::expireNext(uint32_t now_us, uint32_t timeout_us) {
+  for (int i = 0; i < GW_MAX_SESSIONS; i++) {
+    Session& s = sessions_[i];
+    if (s.live && now_us - s.last_seen_us > timeout_us) {
+      s.live = false;
+      live_count_--;
+      if (controller_ == i) {
+        controller_ = -1;
+      }
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool SessionTable::claimController(int session) {
+  if (controller_ < 0) {
+    controller_ = session;
+  }
+  return controller_ == session;
+}
+
+bool SessionTable::advanceSeq(int session, uint16_t seq) {
+  Session& s = sessions_[session];
+  uint16_t behind = (uint16_t)(s.last_seq - seq);
+  if (s.seq_valid && behind < GW_SEQ_WINDOW) {
+    return false;
+  }
+  s.last_seq = seq;
+  s.seq_valid = true;
+  return true;
+}
+
+}  // namespace gw
@@ -0,0 +1,72 @@
+/*
+  Fixed-capacity table of UDP client sessions.
+
+  Every datagram from a client refreshes its session; a session that has
+  been silent for GW_SESSION_TIMEOUT_US (3 s; the app sends a heartbeat
+  or ping at least every 250 ms, its keepalive) expires. Telemetry fans
+  out to every live session.
+
+  At most one session is the controller: the only one whose motion
+  commands reach the C2000. The role is claimed by the first session that
+  sends a command while no live controller exists, and is released when
+  that session expires. Observers (a logging laptop, a second tablet) can
+  therefore join at any time without taking over the telemetry stream or
+  the motor.
+*/
+
+#ifndef GATEWAY_SESSION_TABLE_H_
+#define GATEWAY_SESSION_TABLE_H_
+
+#include "gateway_config.h"
+#include "gateway_transport.h"
+
+namespace gw {
+
+struct Session {
+  Endpoint peer;
+  uint32_t last_seen_us;
+  bool live;
+  bool binary;  // Last datagram used the binary protocol, not ASCII
+  bool seq_valid;     // last_seq holds a sequence number
+  uint16_t last_seq;  // Newest binary command sequence number seen
+};
+
+class SessionTable {
+ public:
+  SessionTable();
+
+  // Finds or creates the session for peer and refreshes it. Returns its
+  // index, or -1 if the table is full of live sessions. *created is set
+  // when a new session was opened.
+  int touch(const Endpoint& peer, uint32_t now_us, bool* created);
+
+  // Expires the first session idle for longer than timeout_us and returns
+  // its index (its peer stays readable through at()), or -1 if none. Call
+  // until it returns -1. Releases the controller role with its session.
+  int expireNext(uint32_t now_us, uint32_t timeout_us);
+
+  // Returns true if session may send motion commands, claiming the free
+  // controller role on its behalf.
+  bool claimController(int session);
+
+  // Records a command sequence number from session. Returns false if it is
+  // not newer than the last one (a repeat, or overtaken in the network).
+  // A number more than GW_SEQ_WINDOW behind is taken as the sender having
+  // restarted and is accepted.
+  bool advanceSeq(int session, uint16_t seq);
+
+  int controller() const { return controller_; }
+  int liveCount() const { return live_count_; }
+  const Session& at(int index) const { return sessions_[index]; }
+  Session& at(int index) { return sessions_[index]; }
+  static int capacity() { return GW_MAX_SESSIONS; }
+
+ private:
+  Session sessions_[GW_MAX_SESSIONS];
+  int controller_;  // -1 when unclaimed
+  int live_count_;
+};
+
+}  // namespace gw
+
+#endif  // GATEWAY_SESSION_TABLE_H_
@@ -0,0 +1,104 @@
+#include "telemetry_filter.h"
+
+#include <string.h>
+
+#include "gateway_config.h"
+
+namespace gw {
+
+TelemetryPolicy policyFromMessage(const wire::Message& msg) {
+  TelemetryPolicy policy;
+  policy.max_rate_hz = (uint16_t)msg.fields[0];
+  policy.deadband = (uint16_t)msg.fields[1];
+  policy.flags = (uint8_t)msg.fields[2];
+  return policy;
+}
+
+TelemetryFilter::TelemetryFilter() {
+  TelemetryPolicy policy = {0, 0, 0};
+  reset(policy);
+}
+
+void TelemetryFilter::reset(const TelemetryPolicy& policy) {
+  policy_ = policy;
+  have_last_ = false;
+  memset(last_, 0, sizeof(last_));
+  last_sent_us_ = 0;
+  next_due_us_ = 0;
+  seq_ = 0;
+  since_keyframe_ = 0;
+}
+
+bool TelemetryFilter::admit(const wire::Message& sample,
+                            uint32_t now_us) const {
+  if (!have_last_) {
+    return true;
+  }
+  if (policy_.max_rate_hz > 0 && (int32_t)(now_us - next_due_us_) < 0) {
+    return false;
+  }
+  if (policy_.deadband > 0 &&
+      now_us - last_sent_us_ < GW_TELEMETRY_REFRESH_US) {
+    for (int i = 0; i < kFields; i++) {
+      int32_t change = (int32_t)sample.fields[i] - last_[i];
+      if (change > policy_.deadband || -change > policy_.deadband) {
+        return true;
+      }
+    }
+    return false;
+  }
+  return true;
+}
+
+size_t TelemetryFilter::filter(const wire::Message& sample, bool binary,
+                               uint32_t now_us, uint8_t* out, size_t cap) {
+  if (sample.field_count != kFields || !admit(sample, now_us)) {
+    return 0;
+  }
+  if (policy_.max_rate_hz > 0) {
+    // Keeps the schedule, so the average rate is exact; restarts it after
+    // a gap longer than one period.
+    uint32_t period = 1000000UL / policy_.max_rate_hz;
+    next_due_us_ = have_last_ ? next_due_us_ + period : now_us + period;
+    if ((int32_t)(now_us - next_due_us_) >= 0) {
+      next_due_us_ = now_us + period;
+    }
+  }
+
+  wire::Message msg;
+  msg.seq = seq_++;
+  bool delta = binary && (policy_.flags & kPolicyDelta) && have_last_ &&
+               since_keyframe_ + 1 < GW_TELEMETRY_KEYFRAME_INTERVAL;
+  if (delta) {
+    // Fields within the deadband are left out; the client keeps its value
+    // and so does last_.
+    int16_t mask = 0;
+    msg.type = wire::kTelemetryDelta;
+    msg.field_count = 1;
+    for (int i = 0; i < kFields; i++) {
+      int32_t change = (int32_t)sample.fields[i] - last_[i];
+      if (change > policy_.deadband || -change > policy_.deadband) {
+        mask |= (int16_t)(1 << i);
+        msg.fields[msg.field_count++] = (int16_t)change;
+        last_[i] = sample.fields[i];
+      }
+    }
+    msg.fields[0] = mask;
+    since_keyframe_++;
+  } else {
+    msg.type = wire::kTelemetry;
+    msg.field_count = kFields;
+    memcpy(msg.fields, sample.fields, sizeof(last_));
+    memcpy(last_, sample.fields, sizeof(last_));
+    since_keyframe_ = 0;
+  }
+  have_last_ = true;
+  last_sent_us_ = now_us;
+
+  if (!binary) {
+    return cap >= wire::kMaxAsciiSize ? wire::encodeAscii(msg, out) : 0;
+  }
+  return wire::encode(msg, out, cap);
+}
+
+}  // namespace gw
@@ -0,0 +1,90 @@
+/*
+  Per-session telemetry policy.
+
+  The C2000 sends telemetry far faster than a phone can display it. Each
+  session can ask the gateway, with a wire::kTelemetryPolicy frame, to
+  thin out what it receives:
+
+  - max_rate_hz: at most this many frames per second, evenly spaced; the
+    frames in between are dropped (0: no limit).
+  - deadband:    a frame goes out only if some field moved by more than
+    this many hundredths since the last one sent, or nothing was sent for
+    GW_TELEMETRY_REFRESH_US (0: every frame).
+  - kPolicyDelta (binary sessions only): frames are sent as
+    wire::kTelemetryDelta, carrying only the fields that changed, relative
+    to the previous frame sent to the same session (modulo 2^16). Every
+    GW_TELEMETRY_KEYFRAME_INTERVAL-th frame is a full kTelemetry frame so
+    a client that lost one can resynchronise; a client applies a delta
+    only if its seq follows the last frame it has.
+
+  All zero is pass-through: the frame is forwarded as the C2000 sent it,
+  which is also the default for new sessions (GW_TELEMETRY_DEFAULT_*). A
+  recording client simply keeps that while a display client on the same
+  gateway asks for, say, 60 Hz.
+
+  Filtered frames are re-encoded by the gateway with a per-session
+  sequence number, so seq gaps seen by the client are network losses.
+*/
+
+#ifndef GATEWAY_TELEMETRY_FILTER_H_
+#define GATEWAY_TELEMETRY_FILTER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "wire_protocol.h"
+
+namespace gw {
+
+enum TelemetryPolicyFlags {
+  kPolicyDelta = 0x01,
+};
+
+struct TelemetryPolicy {
+  uint16_t max_rate_hz;
+  uint16_t deadband;  // Hundredths, like the fields
+  uint8_t flags;
+};
+
+// Reads a policy from the fields of a kTelemetryPolicy message.
+TelemetryPolicy policyFromMessage(const wire::Message& msg);
+
+class TelemetryFilter {
+ public:
+  TelemetryFilter();
+
+  // Starts over with a new policy; the next frame is sent in full.
+  void reset(const TelemetryPolicy& policy);
+
+  const TelemetryPolicy& policy() const { return policy_; }
+
+  // True if frames go out as they came from the UART.
+  bool passThrough() const {
+    return policy_.max_rate_hz == 0 && policy_.deadband == 0 &&
+           (policy_.flags & kPolicyDelta) == 0;
+  }
+
+  // Applies the policy to a decoded telemetry sample arriving at now_us.
+  // Returns the length of the frame written to out (binary, or legacy
+  // ASCII if !binary), or 0 if the sample is withheld. out needs
+  // max(wire::kMaxFrameSize, wire::kMaxAsciiSize) bytes.
+  size_t filter(const wire::Message& sample, bool binary, uint32_t now_us,
+                uint8_t* out, size_t cap);
+
+ private:
+  bool admit(const wire::Message& sample, uint32_t now_us) const;
+
+  static const int kFields = 4;
+
+  TelemetryPolicy policy_;
+  bool have_last_;
+  int16_t last_[kFields];  // Values as the client has them
+  uint32_t last_sent_us_;
+  uint32_t next_due_us_;  // Rate limit: earliest time for the next frame
+  uint16_t seq_;
+  uint16_t since_keyframe_;
+};
+
+}  // namespace gw
+
+#endif  // GATEWAY_TELEMETRY_FILTER_H_
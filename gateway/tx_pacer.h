@@ -0,0 +1,58 @@
+/*
+  Byte budget for a UART whose driver can't report free transmit space.
+
+  HardwareSerial::write() blocks once the driver's transmit buffer is full.
+  TxPacer models the line instead: credit accrues at the baud rate (ten bit
+  times per byte, 8N1) up to a burst of burst_bytes, the amount the driver
+  is known to buffer, and every byte written spends it. A caller that never
+  writes more than writable() therefore never blocks.
+*/
+
+#ifndef GATEWAY_TX_PACER_H_
+#define GATEWAY_TX_PACER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace gw {
+
+class TxPacer {
+ public:
+  TxPacer(uint32_t baud, uint32_t burst_bytes)
+      : byte_ns_((uint32_t)(10000000000ULL / baud)),
+        max_credit_ns_(burst_bytes * (uint32_t)(10000000000ULL / baud)),
+        credit_ns_(max_credit_ns_),
+        last_us_(0) {}
+
+  // Bytes that can be written at now_us without blocking.
+  size_t writable(uint32_t now_us) {
+    uint32_t elapsed_us = now_us - last_us_;
+    last_us_ = now_us;
+    uint32_t room_ns = max_credit_ns_ - credit_ns_;
+    // Compare in us first so the ns product can't overflow
+    if (elapsed_us >= room_ns / 1000 + 1) {
+      credit_ns_ = max_credit_ns_;
+    } else {
+      credit_ns_ += elapsed_us * 1000;
+      if (credit_ns_ > max_credit_ns_) {
+        credit_ns_ = max_credit_ns_;
+      }
+    }
+    return credit_ns_ / byte_ns_;
+  }
+
+  void wrote(size_t n) {
+    uint32_t cost = (uint32_t)n * byte_ns_;
+    credit_ns_ = cost < credit_ns_ ? credit_ns_ - cost : 0;
+  }
+
+ private:
+  uint32_t byte_ns_;
+  uint32_t max_credit_ns_;
+  uint32_t credit_ns_;
+  uint32_t last_us_;
+};
+
+}  // namespace gw
+
+#endif  // GATEWAY_TX_PACER_H_
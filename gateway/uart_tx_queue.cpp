@@ -0,0 +1,86 @@
+#include "uart_tx_queue.h"
+
+#include <string.h>
+
+namespace gw {
+
+UartTxQueue::UartTxQueue() : front_lane_(-1), dropped_(0), refused_(0) {
+  memset(lanes_, 0, sizeof(lanes_));
+}
+
+bool UartTxQueue::push(TxLane lane, const uint8_t* data, size_t len,
+                       uint32_t rx_us) {
+  if (len == 0 || len > kTxSlotSize) {
+    return false;
+  }
+  Lane& l = lanes_[lane];
+  if (l.count == GW_UART_TX_SLOTS && lane == kTxPriority) {
+    refused_++;  // Never make room by dropping a start or stop
+    return false;
+  }
+  if (l.count == GW_UART_TX_SLOTS) {
+    // Full: drop the oldest move that hasn't started going out
+    int victim = started(l) ? 1 : 0;
+    for (int i = victim; i < GW_UART_TX_SLOTS - 1; i++) {
+      l.slots[(l.head + i) % GW_UART_TX_SLOTS] =
+          l.slots[(l.head + i + 1) % GW_UART_TX_SLOTS];
+    }
+    l.count--;
+    dropped_++;
+  }
+  TxFrame& f = l.slots[(l.head + l.count) % GW_UART_TX_SLOTS];
+  f.rx_us = rx_us;
+  f.len = (uint8_t)len;
+  f.sent = 0;
+  memcpy(f.data, data, len);
+  l.count++;
+  return true;
+}
+
+TxFrame* UartTxQueue::front() {
+  front_lane_ = -1;
+  for (int lane = 0; lane < kTxLanes; lane++) {
+    if (started(lanes_[lane])) {
+      front_lane_ = lane;  // Finish what is on the wire first
+      break;
+    }
+    if (front_lane_ < 0 && lanes_[lane].count > 0) {
+      front_lane_ = lane;
+    }
+  }
+  if (front_lane_ < 0) {
+    return 0;
+  }
+  Lane& l = lanes_[front_lane_];
+  return &l.slots[l.head];
+}
+
+bool UartTxQueue::advance(size_t n) {
+  if (front_lane_ < 0) {
+    return false;
+  }
+  Lane& l = lanes_[front_lane_];
+  TxFrame& f = l.slots[l.head];
+  f.sent = (uint8_t)(f.sent + n);
+  if (f.sent < f.len) {
+    return false;
+  }
+  l.head = (uint8_t)((l.head + 1) % GW_UART_TX_SLOTS);
+  l.count--;
+  front_lane_ = -1;
+  return true;
+}
+
+uint32_t UartTxQueue::clear(TxLane lane) {
+  Lane& l = lanes_[lane];
+  uint8_t keep = started(l) ? 1 : 0;
+  uint32_t n = l.count - keep;
+  l.count = keep;
+  return n;
+}
+
+bool UartTxQueue::empty() const {
+  return lanes_[kTxPriority].count == 0 && lanes_[kTxNormal].count == 0;
+}
+
+}  // namespace gw
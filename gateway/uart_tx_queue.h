@@ -0,0 +1,98 @@
+/*
+  Bounded, non-blocking transmit queue for commands going to the C2000.
+
+  Two lanes of fixed-size frame slots:
+
+  - priority: start and stop.
+  - normal:   moves.
+
+  The frame being transmitted is always finished first (a frame is never
+  interleaved with another), after which the priority lane is served
+  before the normal lane, so a start/stop overtakes moves that are still
+  waiting. When the move lane is full the oldest move that hasn't started
+  is dropped to make room for the new one and counted; that is the
+  position the operator has since moved on from. A full priority lane
+  refuses the new frame instead, so a queued stop is never dropped (the
+  gateway clears the start/stops waiting ahead of a stop, so a stop
+  always finds room).
+
+  The queue only holds bytes. The gateway moves them to the UART in
+  whatever amount SerialPort::writable() allows (Gateway::drainUart()), so
+  a slow line delays commands instead of blocking the loop.
+*/
+
+#ifndef GATEWAY_UART_TX_QUEUE_H_
+#define GATEWAY_UART_TX_QUEUE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gateway_config.h"
+#include "wire_protocol.h"
+
+namespace gw {
+
+enum TxLane {
+  kTxPriority = 0,
+  kTxNormal = 1,
+  kTxLanes = 2,
+};
+
+// Largest command the queue stores: a binary frame or a legacy text frame.
+const size_t kTxSlotSize = wire::kMaxAsciiSize > wire::kMaxFrameSize
+                               ? wire::kMaxAsciiSize
+                               : wire::kMaxFrameSize;
+
+struct TxFrame {
+  uint32_t rx_us;  // When the command was received, for latency stats
+  uint8_t len;
+  uint8_t sent;    // Bytes already written to the UART
+  uint8_t data[kTxSlotSize];
+};
+
+class UartTxQueue {
+ public:
+  UartTxQueue();
+
+  // Queues a frame. A full normal lane drops its oldest waiting move; a
+  // full priority lane refuses the frame (counted in refused()). Returns
+  // false if the frame was refused or is larger than kTxSlotSize.
+  bool push(TxLane lane, const uint8_t* data, size_t len, uint32_t rx_us);
+
+  // Frame to transmit next: the one in progress, else the oldest priority
+  // frame, else the oldest move. Null when empty.
+  TxFrame* front();
+
+  // Marks n more bytes of the last front() as written. Returns true when
+  // that completed the frame, which is then removed.
+  bool advance(size_t n);
+
+  // Drops every waiting frame of a lane (not one in progress). Returns the
+  // number dropped.
+  uint32_t clear(TxLane lane);
+
+  bool empty() const;
+  uint32_t dropped() const { return dropped_; }  // Moves pushed out
+  uint32_t refused() const { return refused_; }  // Start/stops turned away
+
+ private:
+  struct Lane {
+    TxFrame slots[GW_UART_TX_SLOTS];
+    uint8_t head;  // Oldest frame
+    uint8_t count;
+  };
+
+  // True if the lane's oldest frame is partly written.
+  bool started(const Lane& l) const {
+    return l.count > 0 && l.slots[l.head].sent > 0;
+  }
+
+  Lane lanes_[kTxLanes];
+  int front_lane_;  // Lane of the last front(), -1 if none
+  uint32_t dropped_;
+  uint32_t refused_;
+};
+
+}  // namespace gw
+
+#endif  // GATEWAY_UART_TX_QUEUE_H_
@@ -0,0 +1,374 @@
+/*
+  Binary wire protocol (v1) shared by the app, the gateway and host tools.
+
+  Raw frame, all integers little endian:
+
+    +----------------+---------+-----------------------+---------+
+    | ver:2 | type:6 | seq:u16 | fields: int16 x count | crc:u16 |
+    +----------------+---------+-----------------------+---------+
+
+  - ver is 1 (top bits 01), so the first raw byte is never 0x00.
+  - seq counts frames per sender and wraps; compare with seqNewer().
+  - Fields are fixed point in hundredths (+0.50 is 50), matching the two
+    decimals of the legacy "[+-]N.NN" text.
+  - crc is CRC-16/CCITT-FALSE over everything before it.
+
+  On the wire each raw frame is COBS encoded and terminated by 0x00, so a
+  datagram or a byte stream may carry any number of frames back to back.
+  Because the first raw byte is non-zero, the second encoded byte is
+  always the raw type byte and can be read without decoding. The first
+  encoded byte is a COBS code and may well be 0x02 (STX), so a datagram is
+  told apart from legacy ASCII by its last byte (isAsciiDatagram()).
+
+  The matching Dart implementation is lib/services/wire_protocol.dart in
+  the app. Header-only so host tools can use it without the gateway core.
+*/
+
+#ifndef GATEWAY_WIRE_PROTOCOL_H_
+#define GATEWAY_WIRE_PROTOCOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace gw {
+namespace wire {
+
+const uint8_t kVersion = 1;
+const uint8_t kVersionShift = 6;
+const uint8_t kTypeMask = 0x3f;
+
+enum Type {
+  kHeartbeat = 0x01,     // no fields
+  kStart = 0x02,         // no fields
+  kStop = 0x03,          // no fields
+  kMove = 0x04,          // x, y
+  kTelemetry = 0x10,     // duty cycle, accel x, accel y, accel z
+  kTelemetryDelta = 0x11,  // mask, then the change of each telemetry
+                           // field whose bit (0 - 3) is set, against the
+                           // frame with the previous seq
+  kStatsRequest = 0x20,  // no fields; answered with a stats reply
+                         // (gateway_stats.h), which is not a wire frame
+  kTelemetryPolicy = 0x21,  // max rate (Hz), deadband (hundredths), flags;
+                            // see telemetry_filter.h
+  kPing = 0x22,  // heartbeat carrying the sender's clock (us, low and high
+                 // 16 bits); echoed at once as a kPong
+  kPong = 0x23,  // seq and fields of the kPing it answers
+};
+
+const size_t kHeaderSize = 3;
+const size_t kCrcSize = 2;
+const size_t kMaxFields = 8;
+const size_t kMaxRawSize = kHeaderSize + 2 * kMaxFields + kCrcSize;
+// COBS adds one byte per 254, plus the 0x00 terminator.
+const size_t kMaxFrameSize = kMaxRawSize + kMaxRawSize / 254 + 2;
+
+struct Message {
+  uint8_t type;
+  uint16_t seq;
+  uint8_t field_count;
+  int16_t fields[kMaxFields];
+};
+
+// Number of fields a message of this type carries, or -1 if unknown.
+inline int fieldCount(uint8_t type) {
+  switch (type) {
+    case kHeartbeat:
+    case kStart:
+    case kStop:
+    case kStatsRequest:
+      return 0;
+    case kMove:
+    case kPing:
+    case kPong:
+      return 2;
+    case kTelemetryPolicy:
+      return 3;
+    case kTelemetry:
+      return 4;
+    default:
+      return -1;  // Including kTelemetryDelta; see deltaFieldCount()
+  }
+}
+
+// Number of fields of a kTelemetryDelta frame with this mask.
+inline int deltaFieldCount(int16_t mask) {
+  int count = 1;
+  for (int i = 0; i < 4; i++) {
+    count += (mask >> i) & 1;
+  }
+  return count;
+}
+
+// True if a is newer than b, allowing for wrap-around.
+inline bool seqNewer(uint16_t a, uint16_t b) {
+  return (int16_t)(uint16_t)(a - b) > 0;
+}
+
+// --- CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) ---
+
+inline uint16_t crc16(const uint8_t* data, size_t len, uint16_t crc = 0xffff) {
+  // Nibble table: 32 bytes of flash instead of 512.
+  static const uint16_t kTable[16] = {
+      0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+      0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef};
+  for (size_t i = 0; i < len; i++) {
+    crc = (uint16_t)((crc << 4) ^ kTable[(crc >> 12) ^ (data[i] >> 4)]);
+    crc = (uint16_t)((crc << 4) ^ kTable[(crc >> 12) ^ (data[i] & 0x0f)]);
+  }
+  return crc;
+}
+
+// --- COBS ---
+
+// Encodes len bytes into out, which must hold len + len / 254 + 1 bytes.
+// Does not append the 0x00 terminator. Returns the encoded length.
+inline size_t cobsEncode(const uint8_t* in, size_t len, uint8_t* out) {
+  size_t code_pos = 0;
+  size_t pos = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < len; i++) {
+    if (in[i] == 0) {
+      out[code_pos] = code;
+      code_pos = pos++;
+      code = 1;
+    } else {
+      out[pos++] = in[i];
+      if (++code == 0xff) {
+        out[code_pos] = code;
+        code_pos = pos++;
+        code = 1;
+      }
+    }
+  }
+  out[code_pos] = code;
+  return pos;
+}
+
+// Decodes len COBS bytes (terminator excluded) into out, which may be the
+// same buffer as in. Returns the decoded length, or 0 if malformed.
+inline size_t cobsDecode(const uint8_t* in, size_t len, uint8_t* out) {
+  size_t pos = 0;
+  size_t out_pos = 0;
+  while (pos < len) {
+    uint8_t code = in[pos++];
+    if (code == 0 || pos + code - 1 > len) {
+      return 0;
+    }
+    for (uint8_t i = 1; i < code; i++) {
+      out[out_pos++] = in[pos++];
+    }
+    if (code != 0xff && pos < len) {
+      out[out_pos++] = 0;
+    }
+  }
+  return out_pos;
+}
+
+// --- Messages ---
+
+// True if a datagram is a legacy STX ... ETX frame rather than binary
+// frames, which always end in their 0x00 terminator.
+inline bool isAsciiDatagram(const uint8_t* data, size_t len) {
+  return len > 0 && data[0] == 0x02 && data[len - 1] != 0x00;
+}
+
+// Type byte of an encoded frame, read in place (0 if too short).
+inline uint8_t peekType(const uint8_t* frame, size_t len) {
+  return len >= 2 ? (uint8_t)(frame[1] & kTypeMask) : 0;
+}
+
+// Encodes msg as a COBS frame with its 0x00 terminator. Returns the number
+// of bytes written to out, or 0 if cap is too small.
+inline size_t encode(const Message& msg, uint8_t* out, size_t cap) {
+  uint8_t raw[kMaxRawSize];
+  size_t n = 0;
+  raw[n++] = (uint8_t)((kVersion << kVersionShift) | (msg.type & kTypeMask));
+  raw[n++] = (uint8_t)msg.seq;
+  raw[n++] = (uint8_t)(msg.seq >> 8);
+  size_t count = msg.field_count > kMaxFields ? kMaxFields : msg.field_count;
+  for (size_t i = 0; i < count; i++) {
+    raw[n++] = (uint8_t)msg.fields[i];
+    raw[n++] = (uint8_t)((uint16_t)msg.fields[i] >> 8);
+  }
+  uint16_t crc = crc16(raw, n);
+  raw[n++] = (uint8_t)crc;
+  raw[n++] = (uint8_t)(crc >> 8);
+
+  if (cap < n + n / 254 + 2) {
+    return 0;
+  }
+  size_t len = cobsEncode(raw, n, out);
+  out[len++] = 0;
+  return len;
+}
+
+// Decodes one COBS frame (terminator excluded) into msg. Checks version,
+// CRC and field count. Returns false for anything malformed.
+inline bool decode(const uint8_t* frame, size_t len, Message* msg) {
+  uint8_t raw[kMaxRawSize + 1];
+  if (len == 0 || len > sizeof(raw)) {
+    return false;
+  }
+  size_t n = cobsDecode(frame, len, raw);
+  if (n < kHeaderSize + kCrcSize || (n - kHeaderSize - kCrcSize) % 2 != 0) {
+    return false;
+  }
+  if ((raw[0] >> kVersionShift) != kVersion) {
+    return false;
+  }
+  uint16_t crc = (uint16_t)(raw[n - 2] | (raw[n - 1] << 8));
+  if (crc16(raw, n - kCrcSize) != crc) {
+    return false;
+  }
+  msg->type = (uint8_t)(raw[0] & kTypeMask);
+  msg->seq = (uint16_t)(raw[1] | (raw[2] << 8));
+  msg->field_count = (uint8_t)((n - kHeaderSize - kCrcSize) / 2);
+  if (msg->field_count > kMaxFields) {
+    return false;
+  }
+  for (size_t i = 0; i < msg->field_count; i++) {
+    msg->fields[i] = (int16_t)(uint16_t)(raw[kHeaderSize + 2 * i] |
+                                         (raw[kHeaderSize + 2 * i + 1] << 8));
+  }
+  int expected = fieldCount(msg->type);
+  if (msg->type == kTelemetryDelta && msg->field_count > 0) {
+    expected = deltaFieldCount(msg->fields[0]);
+  }
+  return expected == (int)msg->field_count;
+}
+
+// --- Legacy ASCII ("\x02+0.50-0.25\x03") ---
+
+// Parses consecutive "[+-]N.NN" fields into hundredths. Returns the number
+// of fields parsed; stops at the first byte that does not start a field.
+// *consumed is set to the bytes the parsed fields span, so a caller can
+// tell a whole payload from one followed by junk.
+inline size_t parseAsciiFields(const uint8_t* text, size_t len, int16_t* out,
+                               size_t max, size_t* consumed) {
+  size_t count = 0;
+  size_t pos = 0;
+  *consumed = 0;
+  while (count < max && pos < len && (text[pos] == '+' || text[pos] == '-')) {
+    bool negative = text[pos++] == '-';
+    int32_t value = 0;
+    size_t digits = 0;
+    while (pos < len && text[pos] >= '0' && text[pos] <= '9') {
+      if (value < 100000) {  // Saturates below; keeps int32 from overflowing
+        value = value * 10 + (text[pos] - '0');
+      }
+      pos++;
+      digits++;
+    }
+    if (digits == 0 || pos + 3 > len || text[pos] != '.' ||
+        text[pos + 1] < '0' || text[pos + 1] > '9' || text[pos + 2] < '0' ||
+        text[pos + 2] > '9') {
+      break;
+    }
+    value = value * 100 + (text[pos + 1] - '0') * 10 + (text[pos + 2] - '0');
+    pos += 3;
+    if (value > 32767) {
+      value = 32767;
+    }
+    out[count++] = (int16_t)(negative ? -value : value);
+    *consumed = pos;
+  }
+  return count;
+}
+
+// Writes value (hundredths) as "[+-]N.NN". out needs 8 bytes. Returns the
+// number of bytes written.
+inline size_t formatAsciiField(int16_t value, uint8_t* out) {
+  int32_t v = value;
+  size_t n = 0;
+  out[n++] = v < 0 ? '-' : '+';
+  if (v < 0) {
+    v = -v;
+  }
+  int32_t whole = v / 100;
+  uint8_t digits[3];
+  size_t d = 0;
+  do {
+    digits[d++] = (uint8_t)('0' + whole % 10);
+    whole /= 10;
+  } while (whole > 0);
+  while (d > 0) {
+    out[n++] = digits[--d];
+  }
+  out[n++] = '.';
+  out[n++] = (uint8_t)('0' + (v / 10) % 10);
+  out[n++] = (uint8_t)('0' + v % 10);
+  return n;
+}
+
+// Largest legacy ASCII frame encodeAscii() produces: STX, kMaxFields fields
+// of up to 8 bytes, ETX.
+const size_t kMaxAsciiSize = 2 + 8 * kMaxFields;
+
+// Writes msg as a legacy frame: "\x02heartbeat\x03", "\x02start\x03",
+// "\x02stop\x03" or STX, the fields as text, ETX. out needs kMaxAsciiSize
+// bytes. Returns the frame length.
+inline size_t encodeAscii(const Message& msg, uint8_t* out) {
+  static const char* const kWords[] = {0, "heartbeat", "start", "stop"};
+  size_t n = 0;
+  out[n++] = 0x02;
+  if (msg.type >= kHeartbeat && msg.type <= kStop) {
+    for (const char* p = kWords[msg.type]; *p; p++) {
+      out[n++] = (uint8_t)*p;
+    }
+  } else {
+    size_t count = msg.field_count > kMaxFields ? kMaxFields : msg.field_count;
+    for (size_t i = 0; i < count; i++) {
+      n += formatAsciiField(msg.fields[i], out + n);
+    }
+  }
+  out[n++] = 0x03;
+  return n;
+}
+
+// Parses a legacy STX ... ETX frame: the three command words, two fields
+// (move) or four fields (telemetry). seq is left at 0. Returns false for
+// anything else.
+inline bool decodeAscii(const uint8_t* frame, size_t len, Message* msg) {
+  if (len < 3 || frame[0] != 0x02 || frame[len - 1] != 0x03) {
+    return false;
+  }
+  const uint8_t* text = frame + 1;
+  size_t text_len = len - 2;
+  static const char* const kWords[] = {0, "heartbeat", "start", "stop"};
+  msg->seq = 0;
+  msg->field_count = 0;
+  for (uint8_t type = kHeartbeat; type <= kStop; type++) {
+    size_t i = 0;
+    while (i < text_len && kWords[type][i] == (char)text[i]) {
+      i++;
+    }
+    if (i == text_len && kWords[type][i] == '\0') {
+      msg->type = type;
+      return true;
+    }
+  }
+  int16_t fields[kMaxFields];
+  size_t consumed;
+  size_t count =
+      parseAsciiFields(text, text_len, fields, kMaxFields, &consumed);
+  if (consumed != text_len) {
+    return false;  // Junk after (or instead of) the fields
+  }
+  if (count == 2) {
+    msg->type = kMove;
+  } else if (count == 4) {
+    msg->type = kTelemetry;
+  } else {
+    return false;
+  }
+  msg->field_count = (uint8_t)count;
+  for (size_t i = 0; i < count; i++) {
+    msg->fields[i] = fields[i];
+  }
+  return true;
+}
+
+}  // namespace wire
+}  // namespace gw
+
+#endif  // GATEWAY_WIRE_PROTOCOL_H_
@@ -0,0 +1,122 @@
+// Command encoding and sending, before and after WireEncoder.
+//
+//   dart run benchmark/command_encode_benchmark.dart [sends]
+//   dart --verbose_gc benchmark/command_encode_benchmark.dart
+//
+// Each case encodes a move with changing fields and sends it to a UDP
+// socket on the loopback interface, the way the transport worker does on
+// every tick:
+// - "ascii old": two NumberFormat('+0.00;-0.00') objects, an interpolated
+//   String and utf8.encode() per send, as _buildMessage() used to.
+// - "binary old": ByteData, cobsEncode() and a frame copy per send, as
+//   encodeWireMessage() used to.
+// - "ascii" and "binary": WireEncoder, writing into its own buffer.
+//
+// Sends per second include RawDatagramSocket.send(). The VM has no
+// in-process allocation counter, so run with --verbose_gc for the
+// allocation side: compare the scavenges logged between each case's
+// markers.
+import 'dart:convert';
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:intl/intl.dart';
+import 'package:pills_wifi_app/services/wire_protocol.dart';
+
+List<int> _asciiOld(int x, int y) {
+  final NumberFormat xFormatter = NumberFormat('+0.00;-0.00');
+  final NumberFormat yFormatter = NumberFormat('+0.00;-0.00');
+  final String message = '\x02${xFormatter.format(fromFixedHundredths(x))}${yFormatter.format(fromFixedHundredths(y))}\x03';
+  return utf8.encode(message);
+}
+
+List<int> _binaryOld(int seq, int x, int y) {
+  final ByteData raw = ByteData(9);
+  raw.setUint8(0, (wireVersion << 6) | WireType.move);
+  raw.setUint16(1, seq & 0xffff, Endian.little);
+  raw.setInt16(3, x, Endian.little);
+  raw.setInt16(5, y, Endian.little);
+  final Uint8List bytes = raw.buffer.asUint8List();
+  raw.setUint16(7, crc16(bytes, 0, 7), Endian.little);
+  final Uint8List encoded = cobsEncode(bytes);
+  final Uint8List frame = Uint8List(encoded.length + 1);
+  frame.setRange(0, encoded.length, encoded);
+  return frame;
+}
+
+final WireEncoder _encoder = WireEncoder();
+final List<int> _fields = <int>[0, 0];
+
+List<int> _ascii(int x, int y) {
+  _fields[0] = x;
+  _fields[1] = y;
+  return _encoder.encodeAscii(WireType.move, _fields);
+}
+
+List<int> _binary(int seq, int x, int y) {
+  _fields[0] = x;
+  _fields[1] = y;
+  return _encoder.encode(WireType.move, seq, _fields);
+}
+
+// Field values swept over the joystick's range, in hundredths.
+int _x(int i) => (i % 201) - 100;
+int _y(int i) => 100 - (i % 173);
+
+typedef _Encode = List<int> Function(int i);
+
+void _check(String name, _Encode old, _Encode current) {
+  for (int i = 0; i < 1000; i++) {
+    final List<int> a = old(i);
+    final List<int> b = current(i);
+    if (a.length != b.length || Iterable<int>.generate(a.length).any((int k) => a[k] != b[k])) {
+      stderr.writeln('$name: encoders disagree at $i: $a vs $b');
+      exit(1);
+    }
+  }
+}
+
+// Encodes and sends [count] moves. Returns sends per second.
+double _run(String name, RawDatagramSocket socket, InternetAddress target, int port, int count, _Encode encode) {
+  for (int i = 0; i < count ~/ 10; i++) {
+    encode(i);
+  }
+  stdout.writeln('--- $name: start');
+  int bytes = 0;
+  final Stopwatch watch = Stopwatch()..start();
+  for (int i = 0; i < count; i++) {
+    bytes += socket.send(encode(i), target, port);
+  }
+  watch.stop();
+  stdout.writeln('--- $name: end ($bytes bytes)');
+  return count * 1000000 / watch.elapsedMicroseconds;
+}
+
+Future<void> main(List<String> args) async {
+  final int count = args.isNotEmpty ? int.parse(args[0]) : 200000;
+  _check('ascii', (int i) => _asciiOld(_x(i), _y(i)), (int i) => _ascii(_x(i), _y(i)));
+  _check('binary', (int i) => _binaryOld(i, _x(i), _y(i)), (int i) => _binary(i, _x(i), _y(i)));
+
+  // Nobody reads the sink; the kernel drops what doesn't fit its buffer.
+  final RawDatagramSocket sink = await RawDatagramSocket.bind(InternetAddress.loopbackIPv4, 0);
+  final RawDatagramSocket socket = await RawDatagramSocket.bind(InternetAddress.loopbackIPv4, 0);
+  final InternetAddress target = InternetAddress.loopbackIPv4;
+
+  final Map<String, _Encode> cases = <String, _Encode>{
+    'ascii old': (int i) => _asciiOld(_x(i), _y(i)),
+    'ascii': (int i) => _ascii(_x(i), _y(i)),
+    'binary old': (int i) => _binaryOld(i, _x(i), _y(i)),
+    'binary': (int i) => _binary(i, _x(i), _y(i)),
+  };
+  final Map<String, double> rates = <String, double>{};
+  cases.forEach((String name, _Encode encode) {
+    rates[name] = _run(name, socket, target, sink.port, count, encode);
+  });
+  socket.close();
+  sink.close();
+
+  stdout.writeln('sends       $count per case');
+  rates.forEach((String name, double rate) {
+    stdout.writeln('${name.padRight(12)}${rate.toStringAsFixed(0)} sends/s');
+  });
+}
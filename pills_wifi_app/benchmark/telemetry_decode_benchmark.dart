@@ -0,0 +1,101 @@
+// Legacy ASCII telemetry decoding, before and after the byte-level parser.
+//
+//   dart run benchmark/telemetry_decode_benchmark.dart [frames]
+//   dart --verbose_gc benchmark/telemetry_decode_benchmark.dart
+//
+// "regex" is the decoder the transport used to run per frame: utf8.decode,
+// substring, a RegExp, allMatches().toList() and double.parse() on four
+// group strings, about a dozen short lived objects per frame. "bytes" is
+// parseAsciiTelemetry() into one reused AsciiTelemetry and allocates
+// nothing. The VM has no in-process allocation counter, so run with
+// --verbose_gc for the allocation side: scavenges are logged between the
+// "regex" markers and none between the "bytes" markers.
+import 'dart:convert';
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:pills_wifi_app/services/wire_protocol.dart';
+
+const int _samples = 64;
+
+// Frames the gateway forwards from the C2000, with varying field widths.
+List<Uint8List> _frames() {
+  final List<Uint8List> frames = <Uint8List>[];
+  for (int i = 0; i < _samples; i++) {
+    final String duty = (i * 1.5).toStringAsFixed(2);
+    final String x = ((i % 7) - 3.25).toStringAsFixed(2);
+    final String y = (12.5 - i * 0.37).toStringAsFixed(2);
+    final String z = (0.98 + i * 0.01).toStringAsFixed(2);
+    String signed(String v) => v.startsWith('-') ? v : '+$v';
+    frames.add(Uint8List.fromList('\x02+$duty${signed(x)}${signed(y)}${signed(z)}\x03'.codeUnits));
+  }
+  return frames;
+}
+
+bool _decodeRegex(Uint8List data, Float64List out) {
+  final String message = utf8.decode(data, allowMalformed: true);
+  if (!message.startsWith('\x02') || !message.endsWith('\x03')) return false;
+  final String payload = message.substring(1, message.length - 1);
+  // Built per frame, as the old decoder did.
+  final RegExp regex = RegExp(r'([+-][0-9]+\.[0-9]{2})');
+  final List<Match> matches = regex.allMatches(payload).toList();
+  if (matches.length != 4) return false;
+  for (int i = 0; i < 4; i++) {
+    out[i] = double.parse(matches[i].group(0)!);
+  }
+  return true;
+}
+
+final AsciiTelemetry _ascii = AsciiTelemetry();
+
+bool _decodeBytes(Uint8List data, Float64List out) {
+  if (!parseAsciiTelemetry(data, 0, data.length, _ascii)) return false;
+  for (int i = 0; i < 4; i++) {
+    out[i] = fromFixedHundredths(_ascii.fields[i]);
+  }
+  return true;
+}
+
+// Decodes [count] frames and returns ns per frame. The printed checksum keeps
+// the results alive so the work is not optimized away.
+double _run(String name, List<Uint8List> frames, int count, bool Function(Uint8List, Float64List) decode) {
+  final Float64List out = Float64List(4);
+  double sum = 0;
+  for (int i = 0; i < count ~/ 10; i++) {
+    decode(frames[i % frames.length], out);
+  }
+  stdout.writeln('--- $name: start');
+  final Stopwatch watch = Stopwatch()..start();
+  for (int i = 0; i < count; i++) {
+    if (!decode(frames[i % frames.length], out)) {
+      stderr.writeln('$name rejected frame ${i % frames.length}');
+      exit(1);
+    }
+    sum += out[0] + out[3];
+  }
+  watch.stop();
+  stdout.writeln('--- $name: end (checksum ${sum.toStringAsFixed(2)})');
+  return watch.elapsedMicroseconds * 1000 / count;
+}
+
+void main(List<String> args) {
+  final int count = args.isNotEmpty ? int.parse(args[0]) : 2000000;
+  final List<Uint8List> frames = _frames();
+
+  // Both decoders must agree before their speed means anything.
+  final Float64List a = Float64List(4);
+  final Float64List b = Float64List(4);
+  for (final Uint8List frame in frames) {
+    if (!_decodeRegex(frame, a) || !_decodeBytes(frame, b) || a.toString() != b.toString()) {
+      stderr.writeln('decoders disagree on ${ascii.decode(frame.sublist(1, frame.length - 1))}: $a vs $b');
+      exit(1);
+    }
+  }
+
+  final double regexNs = _run('regex', frames, count, _decodeRegex);
+  final double bytesNs = _run('bytes', frames, count, _decodeBytes);
+  stdout.writeln('frames      $count');
+  stdout.writeln('regex       ${regexNs.toStringAsFixed(1)} ns/frame');
+  stdout.writeln('bytes       ${bytesNs.toStringAsFixed(1)} ns/frame');
+  stdout.writeln('speedup     ${(regexNs / bytesNs).toStringAsFixed(1)}x');
+}
@@ -0,0 +1,236 @@
+import 'dart:async';
+import 'dart:typed_data';
+
+import 'udp_transport.dart';
+import 'wire_protocol.dart';
+
+class CommandSchedulerConfig {
+  const CommandSchedulerConfig({
+    this.minRateHz = 50,
+    this.nominalRateHz = 100,
+    this.maxRateHz = 200,
+    this.deadband = 0.02,
+    this.throttleDeadband = 1.0,
+    this.keepalive = const Duration(milliseconds: 250),
+    this.settle = const Duration(milliseconds: 100),
+    this.queueingDelay = const Duration(milliseconds: 30),
+    this.baseRttWindow = 40,
+    this.lossThreshold = 0.05,
+  });
+
+  /// Range the move rate adapts in, and where it settles on a clean link.
+  final int minRateHz;
+  final int nominalRateHz;
+  final int maxRateHz;
+
+  /// Joystick (-1 .. 1) and throttle (percent) changes smaller than these
+  /// don't produce a new move.
+  final double deadband;
+  final double throttleDeadband;
+
+  /// Heartbeat period while the joystick is centred. Well inside the
+  /// gateway's session timeout (GW_SESSION_TIMEOUT_US, 3 s).
+  final Duration keepalive;
+
+  /// How long a centred joystick keeps repeating the stopping move before
+  /// falling back to heartbeats, so losing one datagram can't leave the
+  /// motor running.
+  final Duration settle;
+
+  /// Smoothed RTT this far above the lowest recent one means packets are
+  /// queueing somewhere; the rate backs off.
+  final Duration queueingDelay;
+
+  /// Answered probes the lowest RTT is taken over (40: about 10 s). A
+  /// lasting rise, such as walking away from the access point, becomes the
+  /// new base once the window has passed, instead of reading as queueing
+  /// forever.
+  final int baseRttWindow;
+
+  /// Smoothed probe loss above this, without queueing, is taken as radio
+  /// loss; moves are repeated faster so a lost one is replaced sooner.
+  final double lossThreshold;
+}
+
+// Decides what the transport sends, and how often.
+//
+// - Moving: the joystick is off centre. The move is sent as soon as x, y or
+//   the throttle changes by more than the deadband (at most [maxRateHz]
+//   times a second; faster changes go out on the next tick), and repeated
+//   at the adaptive rate.
+// - Settling: the joystick has just been centred. The zero move is repeated
+//   at the adaptive rate for [settle].
+// - Idle: only heartbeats, every [keepalive].
+//
+// Start and stop bypass all of this through [sendNow].
+//
+// The rate starts at [nominalRateHz] and adapts to the transport's link
+// samples (udp_transport.dart), smoothed like TCP's SRTT with a gain of
+// 1/8: queueing (SRTT well above the lowest RTT of the last
+// [baseRttWindow] probes) backs it off towards [minRateHz], loss without
+// queueing raises it towards [maxRateHz], and a clean link brings it back
+// to nominal. Without link samples (legacy ASCII) it stays at nominal.
+class CommandScheduler {
+  CommandScheduler(this._transport, {this.config = const CommandSchedulerConfig()})
+      : _rateHz = config.nominalRateHz,
+        _recentRttUs = Int32List(config.baseRttWindow);
+
+  final UdpTransport _transport;
+  final CommandSchedulerConfig config;
+
+  final Stopwatch _clock = Stopwatch()..start();
+
+  // Latest inputs, and the ones the current move was built from.
+  double _x = 0.0;
+  double _y = 0.0;
+  double _throttle = 0.0;
+  double _sentX = 0.0;
+  double _sentY = 0.0;
+  double _sentThrottle = 0.0;
+
+  bool _moving = false;
+  Timer? _settleTimer;
+  int? _lastImmediateUs;
+  Duration? _period;
+
+  int _rateHz;
+  double? _srttUs;
+  int? _minRttUs; // Lowest of _recentRttUs
+  final Int32List _recentRttUs; // Ring of the latest answered probes
+  int _recentHead = 0;
+  int _recentLength = 0;
+  double _loss = 0.0;
+
+  /// Current move rate.
+  int get rateHz => _rateHz;
+
+  /// Smoothed round trip, or null before the first probe reply.
+  Duration? get rtt => _srttUs == null ? null : Duration(microseconds: _srttUs!.round());
+
+  /// Smoothed fraction of probes lost (0 .. 1).
+  double get loss => _loss;
+
+  /// Starts in the idle state.
+  void start() {
+    _setRepeating(const WireMessage(WireType.heartbeat, 0), config.keepalive);
+  }
+
+  void setJoystick(double x, double y) {
+    _x = x;
+    _y = y;
+    _schedule();
+  }
+
+  void setThrottle(double percentage) {
+    _throttle = percentage;
+    _schedule();
+  }
+
+  /// Sends an out-of-band command (start, stop) right away.
+  void sendNow(WireMessage msg) => _transport.sendNow(msg);
+
+  void _schedule() {
+    if (_x == 0.0 && _y == 0.0) {
+      if (_moving) {
+        _moving = false;
+        _sendMove();
+        _settleTimer = Timer(config.settle, () {
+          _settleTimer = null;
+          _setRepeating(const WireMessage(WireType.heartbeat, 0), config.keepalive);
+        });
+      }
+      return;
+    }
+    final bool changed = (_x - _sentX).abs() >= config.deadband ||
+        (_y - _sentY).abs() >= config.deadband ||
+        (_throttle - _sentThrottle).abs() >= config.throttleDeadband;
+    if (_moving && !changed) return;
+    _moving = true;
+    _settleTimer?.cancel();
+    _settleTimer = null;
+    _sendMove();
+  }
+
+  // Repeats the move for the current inputs and sends it right away unless
+  // that would exceed the maximum rate.
+  void _sendMove() {
+    _sentX = _x;
+    _sentY = _y;
+    _sentThrottle = _throttle;
+    final double scale = _throttle / 100.0;
+    final WireMessage msg = WireMessage(WireType.move, 0, <int>[
+      toFixedHundredths(_x * scale),
+      toFixedHundredths(_y * scale),
+    ]);
+    _setRepeating(msg, _ratePeriod());
+    final int now = _clock.elapsedMicroseconds;
+    final int? last = _lastImmediateUs;
+    if (last == null || now - last >= 1000000 ~/ config.maxRateHz) {
+      _lastImmediateUs = now;
+      _transport.sendNow(msg);
+    }
+  }
+
+  void _setRepeating(WireMessage msg, Duration period) {
+    _transport.setRepeating(msg);
+    _setPeriod(period);
+  }
+
+  void _setPeriod(Duration period) {
+    if (period == _period) return;
+    _period = period;
+    _transport.setPeriod(period);
+  }
+
+  Duration _ratePeriod() => Duration(microseconds: 1000000 ~/ _rateHz);
+
+  /// Feeds a batch of link samples from the transport.
+  void onLinkSamples(Int32List samples) {
+    for (final int rttUs in samples) {
+      if (rttUs == udpProbeLost) {
+        _loss += (1.0 - _loss) / 8;
+        continue;
+      }
+      _loss -= _loss / 8;
+      final double? srtt = _srttUs;
+      _srttUs = srtt == null ? rttUs.toDouble() : srtt + (rttUs - srtt) / 8;
+      _addRecentRtt(rttUs);
+    }
+    _adapt();
+  }
+
+  void _addRecentRtt(int rttUs) {
+    final int capacity = _recentRttUs.length;
+    _recentRttUs[_recentHead] = rttUs;
+    _recentHead = _recentHead + 1 == capacity ? 0 : _recentHead + 1;
+    if (_recentLength < capacity) _recentLength++;
+    int minRtt = rttUs;
+    for (int i = 0; i < _recentLength; i++) {
+      if (_recentRttUs[i] < minRtt) minRtt = _recentRttUs[i];
+    }
+    _minRttUs = minRtt;
+  }
+
+  void _adapt() {
+    final double? srtt = _srttUs;
+    int rate = _rateHz;
+    if (srtt != null && srtt > _minRttUs! + config.queueingDelay.inMicroseconds) {
+      rate = rate * 3 ~/ 4;
+    } else if (_loss > config.lossThreshold) {
+      rate = rate * 5 ~/ 4;
+    } else if (rate < config.nominalRateHz) {
+      rate = (rate + 10).clamp(rate, config.nominalRateHz);
+    } else if (rate > config.nominalRateHz) {
+      rate = (rate - 10).clamp(config.nominalRateHz, rate);
+    }
+    _rateHz = rate.clamp(config.minRateHz, config.maxRateHz);
+    if (_moving || _settleTimer != null) {
+      _setPeriod(_ratePeriod());
+    }
+  }
+
+  void dispose() {
+    _settleTimer?.cancel();
+    _settleTimer = null;
+  }
+}
@@ -0,0 +1,352 @@
+import 'dart:async';
+import 'dart:convert';
+import 'dart:developer' as developer;
+import 'dart:io';
+import 'dart:isolate';
+import 'dart:typed_data';
+
+import 'udp_transport.dart';
+import 'wire_protocol.dart';
+
+// Gateway transport on a background isolate. The worker isolate owns the
+// RawDatagramSocket, the send timer and the telemetry decoder, so a heavy
+// frame on the UI isolate delays neither a command nor decoding.
+//
+// Messages between the isolates are kept compact:
+// - UI -> worker: Int32List [op, type, fields...], or [op, period in us].
+// - Worker -> UI: first [SendPort, local port] (or [null, error text]),
+//   then a TransferableTypedData holding a Float64List of samples for
+//   every burst of datagrams read, and an Int32List per link sample.
+class IsolateUdpTransport implements UdpTransport {
+  SendPort? _commands;
+  ReceivePort? _replies;
+  final StreamController<Float64List> _telemetry = StreamController<Float64List>.broadcast();
+  final StreamController<Int32List> _linkSamples = StreamController<Int32List>.broadcast();
+
+  @override
+  Future<int?> open(String host, int port, {required Duration period, bool legacyAscii = false}) async {
+    await close();
+    final ReceivePort replies = ReceivePort();
+    final Completer<List<dynamic>> ready = Completer<List<dynamic>>();
+    replies.listen((dynamic message) {
+      if (message is TransferableTypedData) {
+        _telemetry.add(message.materialize().asFloat64List());
+      } else if (message is Int32List) {
+        _linkSamples.add(message);
+      } else if (message is List && !ready.isCompleted) {
+        // The hello, or an uncaught error ([error, stack]) before it
+        ready.complete(message);
+      }
+    });
+    try {
+      await Isolate.spawn(
+        _workerMain,
+        _WorkerConfig(replies.sendPort, host, port, period.inMicroseconds, legacyAscii),
+        onError: replies.sendPort,
+        debugName: 'udp',
+      );
+    } catch (e) {
+      developer.log('❌ Failed to start the UDP isolate: $e');
+      replies.close();
+      return null;
+    }
+    _replies = replies;
+
+    final List<dynamic> hello = await ready.future;
+    if (hello[0] is! SendPort) {
+      developer.log('❌ Failed to initialize UDP socket: ${hello[0] ?? hello[1]}');
+      await close();
+      return null;
+    }
+    _commands = hello[0] as SendPort;
+    return hello[1] as int;
+  }
+
+  @override
+  Future<void> setPeriod(Duration period) async {
+    _commands?.send(Int32List(2)
+      ..[0] = _opPeriod
+      ..[1] = period.inMicroseconds);
+  }
+
+  @override
+  Future<void> setRepeating(WireMessage msg) async => _send(_opRepeat, msg);
+
+  @override
+  Future<void> sendNow(WireMessage msg) async => _send(_opSendNow, msg);
+
+  void _send(int op, WireMessage msg) {
+    final Int32List message = Int32List(2 + msg.fields.length);
+    message[0] = op;
+    message[1] = msg.type;
+    message.setRange(2, message.length, msg.fields);
+    _commands?.send(message);
+  }
+
+  @override
+  Stream<Float64List> get telemetry => _telemetry.stream;
+
+  @override
+  Stream<Int32List> get linkSamples => _linkSamples.stream;
+
+  @override
+  Future<void> close() async {
+    // The worker closes its socket and port, and the isolate exits.
+    _commands?.send(Int32List(1)..[0] = _opClose);
+    _commands = null;
+    _replies?.close();
+    _replies = null;
+  }
+}
+
+const int _opRepeat = 1;
+const int _opSendNow = 2;
+const int _opClose = 3;
+const int _opPeriod = 4;
+
+// Samples decoded in one burst beyond this are posted in several batches.
+const int _maxBatchSamples = 256;
+
+// Pings that can await their pong at once; as in UdpLink, they time out
+// before the table fills.
+final int _pingSlots = udpPingTimeout.inMicroseconds ~/ udpProbePeriod.inMicroseconds + 2;
+
+class _WorkerConfig {
+  const _WorkerConfig(this.replies, this.host, this.port, this.periodUs, this.legacyAscii);
+
+  final SendPort replies;
+  final String host;
+  final int port;
+  final int periodUs;
+  final bool legacyAscii;
+}
+
+Future<void> _workerMain(_WorkerConfig config) => _UdpWorker(config).start();
+
+class _UdpWorker {
+  _UdpWorker(this._config);
+
+  final _WorkerConfig _config;
+  final ReceivePort _commands = ReceivePort();
+  RawDatagramSocket? _socket;
+  InternetAddress? _targetAddress;
+  Timer? _sendLoopTimer;
+  WireMessage _repeating = const WireMessage(WireType.heartbeat, 0);
+  int _sendSeq = 0;
+  final WireEncoder _encoder = WireEncoder();
+
+  // Link probes, timed on the worker so UI jank doesn't show up as RTT.
+  final Stopwatch _clock = Stopwatch()..start();
+  int _periodUs = 0;
+  int? _lastPingUs;
+  // Pings awaiting their pong; sent time is -1 in a free slot.
+  final Int32List _pingSeqs = Int32List(_pingSlots);
+  final List<int> _pingSentUs = List<int>.filled(_pingSlots, -1);
+  final Int32List _pingFields = Int32List(2);
+  late final WireMessage _ping = WireMessage(WireType.ping, 0, _pingFields);
+
+  final AsciiTelemetry _ascii = AsciiTelemetry();
+
+  // Samples decoded since the last batch was posted.
+  final Float64List _batch = Float64List(_maxBatchSamples * udpValuesPerSample);
+  int _batchLength = 0;
+
+  Future<void> start() async {
+    try {
+      _targetAddress = InternetAddress(_config.host);
+      _socket = await RawDatagramSocket.bind(InternetAddress.anyIPv4, 0);
+    } catch (e) {
+      _config.replies.send(<Object?>[null, '$e']);
+      _commands.close();
+      return;
+    }
+    _socket!.listen(
+      _onSocketEvent,
+      onError: (Object error) {
+        developer.log('❌ UDP Socket Error: $error');
+        _shutdown();
+      },
+      onDone: () {
+        developer.log('UDP Socket closed.');
+        _shutdown();
+      },
+    );
+    _commands.listen(_onCommand);
+    _startSendLoop(_config.periodUs);
+    _config.replies.send(<Object?>[_commands.sendPort, _socket!.port]);
+  }
+
+  void _startSendLoop(int periodUs) {
+    _periodUs = periodUs;
+    _sendLoopTimer?.cancel();
+    _sendLoopTimer = Timer.periodic(Duration(microseconds: periodUs), (Timer timer) => _onTick());
+  }
+
+  void _onTick() {
+    if (_config.legacyAscii) {
+      _sendCommandInternal(_repeating);
+      return;
+    }
+    final int now = _clock.elapsedMicroseconds;
+    _expirePings(now);
+    // Checked per tick: a ping is at most half a period early or late.
+    final int? last = _lastPingUs;
+    if (last != null && now + _periodUs ~/ 2 < last + udpProbePeriod.inMicroseconds) {
+      _sendCommandInternal(_repeating);
+    } else if (_repeating.type == WireType.heartbeat) {
+      _sendPing(now); // Refreshes the session just as well
+    } else {
+      _sendCommandInternal(_repeating);
+      _sendPing(now);
+    }
+  }
+
+  // The ping carries the worker clock, which its pong echoes back.
+  void _sendPing(int now) {
+    _lastPingUs = now;
+    final int slot = _pingSentUs.indexOf(-1);
+    if (slot < 0) return; // Can't happen while pings time out before the table fills
+    final int clockUs = now & 0xffffffff;
+    _pingFields[0] = clockUs & 0xffff;
+    _pingFields[1] = clockUs >> 16;
+    _pingSeqs[slot] = _sendSeq; // _sendCommandInternal() stamps the next seq
+    _pingSentUs[slot] = now;
+    _sendCommandInternal(_ping);
+  }
+
+  void _expirePings(int now) {
+    for (int i = 0; i < _pingSlots; i++) {
+      if (_pingSentUs[i] >= 0 && now - _pingSentUs[i] >= udpPingTimeout.inMicroseconds) {
+        _pingSentUs[i] = -1;
+        _config.replies.send(Int32List(1)..[0] = udpProbeLost);
+      }
+    }
+  }
+
+  // The round trip comes from the clock the pong echoes; the table only
+  // tells a pong in time from a late or duplicated one.
+  void _onPong(WireMessage msg) {
+    for (int i = 0; i < _pingSlots; i++) {
+      if (_pingSentUs[i] >= 0 && _pingSeqs[i] == msg.seq) {
+        _pingSentUs[i] = -1;
+        final int clockUs = (msg.fields[0] & 0xffff) | ((msg.fields[1] & 0xffff) << 16);
+        final int rttUs = (_clock.elapsedMicroseconds - clockUs) & 0xffffffff;
+        _config.replies.send(Int32List(1)..[0] = rttUs);
+        return;
+      }
+    }
+  }
+
+  void _onCommand(dynamic message) {
+    final Int32List command = message as Int32List;
+    switch (command[0]) {
+      case _opRepeat:
+        _repeating = _messageOf(command);
+        break;
+      case _opSendNow:
+        _sendCommandInternal(_messageOf(command));
+        break;
+      case _opClose:
+        _shutdown();
+        break;
+      case _opPeriod:
+        if (command[1] > 0 && _sendLoopTimer != null) {
+          _startSendLoop(command[1]);
+        }
+        break;
+    }
+  }
+
+  static WireMessage _messageOf(Int32List command) => WireMessage(command[1], 0, Int32List.sublistView(command, 2));
+
+  void _shutdown() {
+    _sendLoopTimer?.cancel();
+    _sendLoopTimer = null;
+    _socket?.close();
+    _socket = null;
+    _commands.close();
+  }
+
+  // --- Receiving ---
+
+  void _onSocketEvent(RawSocketEvent event) {
+    if (event != RawSocketEvent.read) return;
+    // Everything already queued is decoded and posted as one batch.
+    for (Datagram? datagram = _socket?.receive(); datagram != null; datagram = _socket?.receive()) {
+      _handleDatagram(datagram.data);
+    }
+    _flushBatch();
+  }
+
+  void _addSample(double dutyCycle, double accelX, double accelY, double accelZ) {
+    if (_batchLength == _batch.length) {
+      _flushBatch();
+    }
+    _batch[_batchLength++] = dutyCycle;
+    _batch[_batchLength++] = accelX;
+    _batch[_batchLength++] = accelY;
+    _batch[_batchLength++] = accelZ;
+  }
+
+  void _flushBatch() {
+    if (_batchLength == 0) return;
+    _config.replies.send(TransferableTypedData.fromList(<TypedData>[Float64List.sublistView(_batch, 0, _batchLength)]));
+    _batchLength = 0;
+  }
+
+  void _handleDatagram(Uint8List data) {
+    if (isLegacyAsciiFrame(data)) {
+      // The gateway may batch several STX ... ETX frames into one datagram.
+      int start = 0;
+      while (start < data.length) {
+        int end = data.indexOf(0x03, start);
+        end = end < 0 ? data.length : end + 1;
+        if (parseAsciiTelemetry(data, start, end, _ascii)) {
+          _addSample(
+            fromFixedHundredths(_ascii.fields[0]),
+            fromFixedHundredths(_ascii.fields[1]),
+            fromFixedHundredths(_ascii.fields[2]),
+            fromFixedHundredths(_ascii.fields[3]),
+          );
+        } else {
+          final String message = utf8.decode(Uint8List.sublistView(data, start, end), allowMalformed: true);
+          developer.log('⬅️ Received non-standard message: $message', name: 'MCU.Raw');
+        }
+        start = end;
+      }
+      return;
+    }
+    for (final WireMessage msg in decodeWireDatagram(data)) {
+      if (msg.type == WireType.telemetry) {
+        _addSample(
+          fromFixedHundredths(msg.fields[0]),
+          fromFixedHundredths(msg.fields[1]),
+          fromFixedHundredths(msg.fields[2]),
+          fromFixedHundredths(msg.fields[3]),
+        );
+      } else if (msg.type == WireType.pong) {
+        _onPong(msg);
+      }
+    }
+  }
+
+  // --- Sending ---
+
+  // Encodes into the worker's one buffer, so a tick allocates nothing.
+  void _sendCommandInternal(WireMessage command) {
+    if (_socket == null || _targetAddress == null) return;
+    final Uint8List frame;
+    if (_config.legacyAscii) {
+      frame = _encoder.encodeAscii(command.type, command.fields);
+      if (frame.isEmpty) return;
+    } else {
+      frame = _encoder.encode(command.type, _sendSeq, command.fields);
+      _sendSeq = (_sendSeq + 1) & 0xffff;
+    }
+    try {
+      _socket!.send(frame, _targetAddress!, _config.port);
+    } catch (e) {
+      developer.log('❌ Failed to send command ${command.type}: $e');
+    }
+  }
+}
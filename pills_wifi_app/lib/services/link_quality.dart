@@ -0,0 +1,72 @@
+import 'dart:typed_data';
+
+import 'udp_transport.dart';
+
+// Round trip, jitter and loss over the last few seconds of pings.
+class LinkQuality {
+  const LinkQuality({this.rtt, this.jitter, this.loss = 0.0, this.samples = 0});
+
+  /// Mean round trip of the answered pings, or null if none was answered.
+  final Duration? rtt;
+
+  /// Mean change in round trip from one answered ping to the next, or null
+  /// with fewer than two answered.
+  final Duration? jitter;
+
+  /// Fraction of pings lost (0 .. 1).
+  final double loss;
+
+  /// Pings the figures are taken over.
+  final int samples;
+}
+
+// The last [capacity] link samples (udp_transport.dart) in a ring buffer.
+// The default covers ten seconds of pings.
+class LinkQualityWindow {
+  LinkQualityWindow({this.capacity = 40}) : _samples = Int32List(capacity);
+
+  final int capacity;
+  final Int32List _samples;
+  int _head = 0; // Next slot written
+  int _length = 0;
+
+  /// Appends [samples] and returns the figures over the window.
+  LinkQuality add(Int32List samples) {
+    for (final int sample in samples) {
+      _samples[_head] = sample;
+      _head = _head + 1 == capacity ? 0 : _head + 1;
+    }
+    _length = _length + samples.length > capacity ? capacity : _length + samples.length;
+    return quality;
+  }
+
+  LinkQuality get quality {
+    if (_length == 0) return const LinkQuality();
+    int lost = 0;
+    int answered = 0;
+    int rttSum = 0;
+    int deltaSum = 0;
+    int? previous;
+    for (int i = 0; i < _length; i++) {
+      int slot = _head - _length + i;
+      if (slot < 0) slot += capacity;
+      final int rttUs = _samples[slot];
+      if (rttUs == udpProbeLost) {
+        lost++;
+        continue;
+      }
+      if (previous != null) {
+        deltaSum += (rttUs - previous).abs();
+      }
+      previous = rttUs;
+      answered++;
+      rttSum += rttUs;
+    }
+    return LinkQuality(
+      rtt: answered == 0 ? null : Duration(microseconds: rttSum ~/ answered),
+      jitter: answered < 2 ? null : Duration(microseconds: deltaSum ~/ (answered - 1)),
+      loss: lost / _length,
+      samples: _length,
+    );
+  }
+}
@@ -0,0 +1,68 @@
+import 'dart:developer' as developer;
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+
+import 'udp_transport.dart';
+import 'wire_protocol.dart';
+
+// Gateway transport implemented in the Linux runner
+// (linux/runner/udp_link.h). The socket, the send timer and telemetry
+// decoding run on a native I/O thread, so a slow frame on the UI isolate
+// no longer delays a command.
+class NativeUdpTransport implements UdpTransport {
+  static const MethodChannel _methods = MethodChannel('pills_wifi_app/udp');
+  static const EventChannel _events = EventChannel('pills_wifi_app/udp/telemetry');
+  static const EventChannel _link = EventChannel('pills_wifi_app/udp/link');
+
+  static bool get isSupported => !kIsWeb && Platform.isLinux;
+
+  /// Returns null if the runner has no native transport or the socket
+  /// could not be opened.
+  @override
+  Future<int?> open(String host, int port, {required Duration period, bool legacyAscii = false}) async {
+    try {
+      return await _methods.invokeMethod<int>('open', <String, Object>{
+        'host': host,
+        'port': port,
+        'periodMs': period.inMilliseconds,
+        'legacyAscii': legacyAscii,
+      });
+    } on MissingPluginException {
+      return null;
+    } on PlatformException catch (e) {
+      developer.log('❌ Native UDP transport failed to open: ${e.message}');
+      return null;
+    }
+  }
+
+  @override
+  Future<void> setPeriod(Duration period) =>
+      _methods.invokeMethod<void>('setPeriod', <String, Object>{'periodUs': period.inMicroseconds});
+
+  @override
+  Future<void> setRepeating(WireMessage msg) => _methods.invokeMethod<void>('setRepeating', _args(msg));
+
+  @override
+  Future<void> sendNow(WireMessage msg) => _methods.invokeMethod<void>('sendNow', _args(msg));
+
+  @override
+  Stream<Float64List> get telemetry => _events.receiveBroadcastStream().map((dynamic batch) => batch as Float64List);
+
+  @override
+  Stream<Int32List> get linkSamples => _link.receiveBroadcastStream().map((dynamic batch) => batch as Int32List);
+
+  /// Counters kept by the I/O thread: sent, samples, malformed, dropped,
+  /// missedTicks, maxLateUs, probes and probesLost.
+  Future<Map<String, int>> stats() async {
+    final Map<Object?, Object?>? stats = await _methods.invokeMethod<Map<Object?, Object?>>('stats');
+    return stats?.cast<String, int>() ?? <String, int>{};
+  }
+
+  @override
+  Future<void> close() => _methods.invokeMethod<void>('close');
+
+  static Map<String, Object> _args(WireMessage msg) => <String, Object>{'type': msg.type, 'fields': msg.fields};
+}
@@ -1,8 +1,12 @@
 import 'dart:async';
-import 'dart:convert';
-import 'dart:io';
 import 'dart:developer' as developer;
-import 'package:intl/intl.dart';
+import 'dart:typed_data';
+import 'command_scheduler.dart';
+import 'isolate_udp_transport.dart';
+import 'link_quality.dart';
+import 'native_udp_transport.dart';
+import 'udp_transport.dart';
+import 'wire_protocol.dart';
 
 // Data model for structured data from the MCU.
 class McuData {
@@ -26,174 +30,146 @@ class PillsConnectionService {
   static final PillsConnectionService _instance = PillsConnectionService._internal();
 
   // --- Network & Socket ---
-  RawDatagramSocket? _socket;
   final String targetIp = '192.168.1.1';
   final int targetPort = 8080;
-  InternetAddress? _targetAddress;
 
-  // --- Main Sending Loop Timer ---
-  Timer? _sendLoopTimer;
+  // The socket, the send timer and the telemetry decoder live in the
+  // transport, off the UI isolate (udp_transport.dart): the runner's I/O
+  // thread on the Linux desktop, a background isolate elsewhere.
+  UdpTransport? _transport;
+  StreamSubscription<Float64List>? _telemetrySubscription;
+  StreamSubscription<Int32List>? _linkSubscription;
+
+  // --- Protocol ---
+  // Binary v1 frames (wire_protocol.dart) by default. Set to true to talk to
+  // gateway firmware that only understands the old ASCII text frames.
+  final bool useLegacyAscii = false;
+
+  // --- Command Scheduling ---
+  // Moves at 50 - 200 Hz depending on the link, heartbeats while idle; see
+  // command_scheduler.dart.
+  static const CommandSchedulerConfig schedulerConfig = CommandSchedulerConfig();
+  CommandScheduler? _scheduler;
 
   // --- State Management ---
+  // Kept here too, so a scheduler created on reconnect starts from them.
   Map<String, double>? _latestJoystickData;
   double _latestThrottlePercentage = 0.0;
-  String? _oneTimeCommand;
 
   // --- Response Stream ---
-  // Broadcasts structured McuData objects instead of raw strings.
+  // The newest sample of each telemetry batch, as McuData. Readouts only
+  // show the latest value, so the rest of a batch is not turned into
+  // objects here; consumers that need every sample use [telemetryBatches].
   final StreamController<McuData> _responseController = StreamController<McuData>.broadcast();
   Stream<McuData> get responseStream => _responseController.stream;
 
+  // The same samples as they come from the transport, [udpValuesPerSample]
+  // values each, for consumers that keep history without an object per
+  // sample.
+  final StreamController<Float64List> _batchController = StreamController<Float64List>.broadcast();
+  Stream<Float64List> get telemetryBatches => _batchController.stream;
+
+  // Round trip, jitter and loss of the gateway link, updated with every
+  // ping answered or lost. Quiet in legacy ASCII mode, which has no pings.
+  final LinkQualityWindow _linkWindow = LinkQualityWindow();
+  final StreamController<LinkQuality> _linkQualityController = StreamController<LinkQuality>.broadcast();
+  Stream<LinkQuality> get linkQuality => _linkQualityController.stream;
+
   Future<bool> init() async {
-    if (_socket != null) {
+    if (_transport != null) {
       return true;
     }
     developer.log('Initializing UDP Connection Service...');
-    try {
-      _targetAddress = InternetAddress(targetIp);
-      _socket = await RawDatagramSocket.bind(InternetAddress.anyIPv4, 0);
-      developer.log('✅ UDP Socket bound to local port: ${_socket!.port}');
-
-      _socket!.listen(
-        (RawSocketEvent event) {
-          if (event == RawSocketEvent.read) {
-            Datagram? datagram = _socket!.receive();
-            if (datagram == null) return;
-            final String message = utf8.decode(datagram.data);
-            // New parsing logic for incoming messages.
-            _parseMcuMessage(message);
-          }
-        },
-        onError: (error) {
-          developer.log('❌ UDP Socket Error: $error');
-          dispose();
-        },
-        onDone: () {
-          developer.log('UDP Socket closed.');
-          dispose();
-        },
-      );
-
-      _startSendLoop();
-      return true;
-    } catch (e) {
-      developer.log('❌ Failed to initialize UDP socket: $e');
-      _socket = null;
-      return false;
-    }
-  }
-
-  // New method to parse messages from the MCU.
-  void _parseMcuMessage(String message) {
-    if (message.startsWith('\x02') && message.endsWith('\x03')) {
-      final String payload = message.substring(1, message.length - 1);
-      final RegExp regex = RegExp(r'([+-][0-9]+\.[0-9]{2})');
-      final List<Match> matches = regex.allMatches(payload).toList();
-
-      if (matches.length == 4) {
-        try {
-          final double dutyCycle = double.parse(matches[0].group(0)!);
-          final double accelX = double.parse(matches[1].group(0)!);
-          final double accelY = double.parse(matches[2].group(0)!);
-          final double accelZ = double.parse(matches[3].group(0)!);
-
-          final mcuData = McuData(dutyCycle: dutyCycle, accelX: accelX, accelY: accelY, accelZ: accelZ);
-          _responseController.add(mcuData);
-        } catch (e) {
-          developer.log('❌ Error parsing MCU data: $e', name: 'MCU.Parse');
-        }
+    final List<UdpTransport> candidates = <UdpTransport>[
+      if (NativeUdpTransport.isSupported) NativeUdpTransport(),
+      IsolateUdpTransport(),
+    ];
+    for (final UdpTransport transport in candidates) {
+      final int? port = await transport.open(targetIp, targetPort, period: schedulerConfig.keepalive, legacyAscii: useLegacyAscii);
+      if (port == null) {
+        continue;
       }
-    } else {
-       developer.log('⬅️ Received non-standard message: $message', name: 'MCU.Raw');
+      developer.log('✅ UDP Socket bound to local port: $port (${transport.runtimeType})');
+      _transport = transport;
+      _telemetrySubscription = transport.telemetry.listen(_handleTelemetryBatch);
+      final CommandScheduler scheduler = CommandScheduler(transport, config: schedulerConfig);
+      _linkSubscription = transport.linkSamples.listen((Int32List samples) {
+        scheduler.onLinkSamples(samples);
+        _linkQualityController.add(_linkWindow.add(samples));
+      });
+      _scheduler = scheduler
+        ..start()
+        ..setThrottle(_latestThrottlePercentage)
+        ..setJoystick(_latestJoystickData?['x'] ?? 0.0, _latestJoystickData?['y'] ?? 0.0);
+      developer.log('✅ Command scheduler started at up to ${schedulerConfig.maxRateHz} Hz.');
+      return true;
     }
+    developer.log('❌ Failed to initialize UDP socket');
+    return false;
   }
 
-  void _startSendLoop() {
-    stopSendLoop();
-    const int fps = 1;
-    const int intervalMs = 1000 ~/ fps;
-    _sendLoopTimer = Timer.periodic(const Duration(milliseconds: intervalMs), (timer) {
-      _executeSendLogic();
-    });
-    developer.log('✅ Unified send loop started at $fps FPS.');
-  }
-
-  void _executeSendLogic() {
-    if (_oneTimeCommand != null) {
-      _sendCommandInternal(_oneTimeCommand!);
-      _oneTimeCommand = null;
-      return;
-    }
-
-    if (_latestJoystickData != null &&
-        (_latestJoystickData!['x'] != 0.0 || _latestJoystickData!['y'] != 0.0)) {
-      final double throttleMultiplier = _latestThrottlePercentage / 100.0;
-      final double finalX = (_latestJoystickData!['x'] ?? 0.0) * throttleMultiplier;
-      final double finalY = (_latestJoystickData!['y'] ?? 0.0) * throttleMultiplier;
-      final Map<String, double> finalMoveData = {'x': finalX, 'y': finalY};
-      _sendCommandInternal('move', data: finalMoveData);
-      return;
-    }
-    _sendCommandInternal('heartbeat');
+  void _handleTelemetryBatch(Float64List batch) {
+    _batchController.add(batch);
+    const int n = udpValuesPerSample;
+    final int last = (batch.length ~/ n - 1) * n;
+    if (last < 0) return;
+    _responseController.add(McuData(
+      dutyCycle: batch[last],
+      accelX: batch[last + 1],
+      accelY: batch[last + 2],
+      accelZ: batch[last + 3],
+    ));
   }
 
   void updateJoystickState(Map<String, double> data) {
     _latestJoystickData = data;
+    _scheduler?.setJoystick(data['x'] ?? 0.0, data['y'] ?? 0.0);
   }
 
   void updateThrottlePercentage(double percentage) {
     _latestThrottlePercentage = percentage;
+    _scheduler?.setThrottle(percentage);
   }
 
+  // Sent right away rather than on the next tick.
   void sendOneTimeCommand(String command) {
-    _oneTimeCommand = command;
-  }
-
-  void _sendCommandInternal(String command, {dynamic data}) {
-    if (_socket == null || _targetAddress == null) return;
-    final String message = _buildMessage(command, data);
-    if (message.isEmpty) return;
-    final List<int> dataBytes = utf8.encode(message);
-    try {
-      _socket!.send(dataBytes, _targetAddress!, targetPort);
-    } catch (e) {
-      developer.log("❌ Failed to send command '$command': $e");
-    }
+    final WireMessage? msg = _buildWireMessage(command);
+    if (msg == null) return;
+    _scheduler?.sendNow(msg);
   }
 
-  String _buildMessage(String command, dynamic data) {
+  // The transport assigns seq numbers, so every message is built with 0.
+  WireMessage? _buildWireMessage(String command) {
     switch (command) {
-      case 'move':
-        if (data is Map<String, double>) {
-          final xFormatter = NumberFormat('+0.00;-0.00');
-          final yFormatter = NumberFormat('+0.00;-0.00');
-          final String x = xFormatter.format(data['x'] ?? 0.0);
-          final String y = yFormatter.format(data['y'] ?? 0.0);
-          return '\x02$x$y\x03';
-        }
-        return '';
       case 'heartbeat':
-        return '\x02$command\x03';
+        return const WireMessage(WireType.heartbeat, 0);
       case 'start':
+        return const WireMessage(WireType.start, 0);
       case 'stop':
-        return '\x02$command\x03';
+        return const WireMessage(WireType.stop, 0);
       default:
-        return '';
+        return null;
     }
   }
 
   void dispose() {
     developer.log('Disposing PillsConnectionService...');
-    stopSendLoop();
-    _socket?.close();
-    _socket = null;
+    _telemetrySubscription?.cancel();
+    _telemetrySubscription = null;
+    _linkSubscription?.cancel();
+    _linkSubscription = null;
+    _scheduler?.dispose();
+    _scheduler = null;
+    _transport?.close();
+    _transport = null;
     if (!_responseController.isClosed) {
       _responseController.close();
     }
+    if (!_batchController.isClosed) {
+      _batchController.close();
+    }
+    if (!_linkQualityController.isClosed) {
+      _linkQualityController.close();
+    }
   }
-
-  void stopSendLoop() {
-    _sendLoopTimer?.cancel();
-    _sendLoopTimer = null;
-  }
-}
\ No newline at end of file
+}
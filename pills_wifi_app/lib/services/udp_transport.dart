@@ -0,0 +1,54 @@
+import 'dart:typed_data';
+
+import 'wire_protocol.dart';
+
+// Owner of the gateway socket, the send timer and the telemetry decoder,
+// all kept off the UI isolate's event loop:
+// - NativeUdpTransport (native_udp_transport.dart): an I/O thread in the
+//   Linux desktop runner.
+// - IsolateUdpTransport (isolate_udp_transport.dart): a background isolate,
+//   on every platform.
+//
+// The transport sends the repeating command on every tick of its own timer
+// and one-shot commands right away, assigning seq numbers itself.
+// Telemetry arrives in batches of [udpValuesPerSample] values per sample.
+//
+// With the binary protocol the transport also probes the link every
+// [udpProbePeriod] with a ping (in place of a heartbeat while idle) that
+// the gateway echoes as a pong, and reports one link sample per ping: the
+// round trip in microseconds, or [udpProbeLost] if no pong came within
+// [udpPingTimeout].
+abstract class UdpTransport {
+  /// Opens the socket and starts sending heartbeats every [period].
+  /// Returns the local port, or null if the transport is unavailable.
+  Future<int?> open(String host, int port, {required Duration period, bool legacyAscii = false});
+
+  /// Changes the send period. The next tick is one [period] from now.
+  Future<void> setPeriod(Duration period);
+
+  /// Replaces the command sent on every tick. The seq of [msg] is ignored.
+  Future<void> setRepeating(WireMessage msg);
+
+  /// Sends [msg] once, immediately. The seq of [msg] is ignored.
+  Future<void> sendNow(WireMessage msg);
+
+  /// Decoded telemetry, oldest sample first.
+  Stream<Float64List> get telemetry;
+
+  /// Link samples, oldest first. Empty in legacy ASCII mode.
+  Stream<Int32List> get linkSamples;
+
+  Future<void> close();
+}
+
+/// Values per telemetry sample in a batch: duty cycle, accel x, y, z.
+const int udpValuesPerSample = 4;
+
+/// How often the link is probed. Matches UdpLink::kProbePeriodUs.
+const Duration udpProbePeriod = Duration(milliseconds: 250);
+
+/// How long a ping waits for its pong. Matches UdpLink::kPingTimeoutUs.
+const Duration udpPingTimeout = Duration(seconds: 1);
+
+/// Link sample of a probe that got no reply.
+const int udpProbeLost = -1;
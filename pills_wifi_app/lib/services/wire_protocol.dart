@@ -0,0 +1,358 @@
+import 'dart:typed_data';
+
+// Binary wire protocol (v1) spoken between the app and the CC3200 gateway.
+// Mirrors gateway/wire_protocol.h; see that file for the frame layout.
+//
+// Raw frame (little endian): [ver:2|type:6] [seq:u16] [int16 fields...] [crc:u16]
+// Each raw frame is COBS encoded and terminated by 0x00. Field values are
+// fixed point in hundredths (0.50 is sent as 50).
+
+class WireType {
+  static const int heartbeat = 0x01;
+  static const int start = 0x02;
+  static const int stop = 0x03;
+  static const int move = 0x04;
+  static const int telemetry = 0x10;
+  // Mask, then the change of each telemetry field whose bit (0 - 3) is
+  // set, against the frame with the previous seq. Sent by the gateway only
+  // to sessions that asked for it with a telemetry policy.
+  static const int telemetryDelta = 0x11;
+  static const int statsRequest = 0x20;
+  // Max rate (Hz), deadband (hundredths), flags (1: delta encoding); see
+  // gateway/telemetry_filter.h.
+  static const int telemetryPolicy = 0x21;
+  // Heartbeat carrying the sender's clock (us, low and high 16 bits); the
+  // gateway echoes it at once as a pong with the same seq and fields.
+  static const int ping = 0x22;
+  static const int pong = 0x23;
+}
+
+const int wireVersion = 1;
+const int _versionShift = 6;
+const int _typeMask = 0x3f;
+const int _headerSize = 3;
+const int _crcSize = 2;
+const int _maxFields = 8;
+const int _maxRawSize = _headerSize + 2 * _maxFields + _crcSize;
+const int _maxFrameSize = _maxRawSize + _maxRawSize ~/ 254 + 2;
+// STX, up to eight fields of at most 8 bytes, ETX; see kMaxAsciiSize.
+const int _maxAsciiSize = 2 + 8 * _maxFields;
+
+/// Number of int16 fields a message of [type] carries, or -1 if unknown.
+int wireFieldCount(int type) {
+  switch (type) {
+    case WireType.heartbeat:
+    case WireType.start:
+    case WireType.stop:
+    case WireType.statsRequest:
+      return 0;
+    case WireType.move:
+    case WireType.ping:
+    case WireType.pong:
+      return 2;
+    case WireType.telemetryPolicy:
+      return 3;
+    case WireType.telemetry:
+      return 4;
+    default:
+      return -1; // Including telemetryDelta; see wireDeltaFieldCount()
+  }
+}
+
+/// Number of fields of a telemetryDelta frame with [mask].
+int wireDeltaFieldCount(int mask) {
+  int count = 1;
+  for (int i = 0; i < 4; i++) {
+    count += (mask >> i) & 1;
+  }
+  return count;
+}
+
+class WireMessage {
+  const WireMessage(this.type, this.seq, [this.fields = const <int>[]]);
+
+  final int type;
+  final int seq;
+  final List<int> fields;
+}
+
+/// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) over data[start, end).
+int crc16(List<int> data, [int start = 0, int? end]) {
+  int crc = 0xffff;
+  final int stop = end ?? data.length;
+  for (int i = start; i < stop; i++) {
+    crc ^= data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) != 0 ? ((crc << 1) ^ 0x1021) & 0xffff : (crc << 1) & 0xffff;
+    }
+  }
+  return crc;
+}
+
+/// COBS-encodes [data] (without the 0x00 terminator).
+Uint8List cobsEncode(List<int> data) {
+  final Uint8List out = Uint8List(data.length + data.length ~/ 254 + 1);
+  return Uint8List.sublistView(out, 0, _cobsEncodeInto(data, data.length, out));
+}
+
+// COBS-encodes data[0, length) into [out], which needs
+// length + length ~/ 254 + 1 bytes. Returns the encoded length.
+int _cobsEncodeInto(List<int> data, int length, Uint8List out) {
+  int codePos = 0;
+  int pos = 1;
+  int code = 1;
+  for (int i = 0; i < length; i++) {
+    final int b = data[i];
+    if (b == 0) {
+      out[codePos] = code;
+      codePos = pos++;
+      code = 1;
+    } else {
+      out[pos++] = b;
+      if (++code == 0xff) {
+        out[codePos] = code;
+        codePos = pos++;
+        code = 1;
+      }
+    }
+  }
+  out[codePos] = code;
+  return pos;
+}
+
+/// Decodes the COBS bytes data[start, end) (terminator excluded). Returns
+/// null if they are malformed.
+Uint8List? cobsDecode(List<int> data, int start, int end) {
+  final Uint8List out = Uint8List(end - start);
+  int pos = start;
+  int outPos = 0;
+  while (pos < end) {
+    final int code = data[pos++];
+    if (code == 0 || pos + code - 1 > end) {
+      return null;
+    }
+    for (int i = 1; i < code; i++) {
+      out[outPos++] = data[pos++];
+    }
+    if (code != 0xff && pos < end) {
+      out[outPos++] = 0;
+    }
+  }
+  return Uint8List.sublistView(out, 0, outPos);
+}
+
+/// Encodes [msg] as a COBS frame including its 0x00 terminator, in a new
+/// list. Senders use a [WireEncoder] instead.
+Uint8List encodeWireMessage(WireMessage msg) => Uint8List.fromList(_encoder.encode(msg.type, msg.seq, msg.fields));
+
+final WireEncoder _encoder = WireEncoder();
+
+/// Decodes one COBS frame data[start, end) (terminator excluded). Returns
+/// null if the version, CRC or field count don't check out.
+WireMessage? decodeWireFrame(List<int> data, int start, int end) {
+  final Uint8List? raw = cobsDecode(data, start, end);
+  if (raw == null || raw.length < _headerSize + _crcSize || (raw.length - _headerSize - _crcSize).isOdd) {
+    return null;
+  }
+  if (raw[0] >> _versionShift != wireVersion) {
+    return null;
+  }
+  final ByteData view = ByteData.sublistView(raw);
+  final int crc = view.getUint16(raw.length - _crcSize, Endian.little);
+  if (crc16(raw, 0, raw.length - _crcSize) != crc) {
+    return null;
+  }
+  final int type = raw[0] & _typeMask;
+  final int count = (raw.length - _headerSize - _crcSize) ~/ 2;
+  final List<int> fields = List<int>.generate(
+    count,
+    (int i) => view.getInt16(_headerSize + 2 * i, Endian.little),
+    growable: false,
+  );
+  final int expected = type == WireType.telemetryDelta && count > 0 ? wireDeltaFieldCount(fields[0]) : wireFieldCount(type);
+  if (expected != count) {
+    return null;
+  }
+  return WireMessage(type, view.getUint16(1, Endian.little), fields);
+}
+
+/// Decodes every well-formed frame in a datagram. Malformed frames are
+/// skipped.
+List<WireMessage> decodeWireDatagram(Uint8List data) {
+  final List<WireMessage> messages = <WireMessage>[];
+  int start = 0;
+  while (start < data.length) {
+    int end = data.indexOf(0, start);
+    if (end < 0) {
+      end = data.length;
+    }
+    if (end > start) {
+      final WireMessage? msg = decodeWireFrame(data, start, end);
+      if (msg != null) {
+        messages.add(msg);
+      }
+    }
+    start = end + 1;
+  }
+  return messages;
+}
+
+/// True if [data] is a legacy ASCII frame rather than binary v1. The first
+/// byte of a COBS frame may be 0x02 as well, but binary datagrams always
+/// end in a 0x00 terminator.
+bool isLegacyAsciiFrame(List<int> data) => data.isNotEmpty && data[0] == 0x02 && data.last != 0x00;
+
+/// Legacy ASCII telemetry decoded by [parseAsciiTelemetry]. One instance
+/// is reused for every frame, so decoding allocates nothing.
+class AsciiTelemetry {
+  /// Duty cycle, accel x, y, z in hundredths.
+  final Int32List fields = Int32List(4);
+}
+
+const int _stx = 0x02;
+const int _etx = 0x03;
+const int _plus = 0x2b;
+const int _minus = 0x2d;
+const int _dot = 0x2e;
+const int _zero = 0x30;
+
+bool _isDigit(int c) => c >= _zero && c <= _zero + 9;
+
+/// Parses legacy telemetry, STX then four "[+-]N.NN" fields back to back
+/// then ETX, in data[start, end) into [out]. Works on the bytes directly,
+/// like parseAsciiFields() in gateway/wire_protocol.h, and saturates the
+/// same way: a magnitude above 327.67 reads as 327.67, the int16 limit of
+/// a binary field. Returns false for anything else, leaving [out] partly
+/// written.
+bool parseAsciiTelemetry(Uint8List data, int start, int end, AsciiTelemetry out) {
+  if (end - start < 2 || data[start] != _stx || data[end - 1] != _etx) {
+    return false;
+  }
+  final int stop = end - 1;
+  int pos = start + 1;
+  for (int field = 0; field < 4; field++) {
+    if (pos >= stop || (data[pos] != _plus && data[pos] != _minus)) {
+      return false;
+    }
+    final bool negative = data[pos++] == _minus;
+    final int digits = pos;
+    int value = 0;
+    while (pos < stop && _isDigit(data[pos])) {
+      if (value < 100000) {
+        value = value * 10 + data[pos] - _zero;
+      }
+      pos++;
+    }
+    // At least one integer digit, then exactly two decimals.
+    if (pos == digits || pos + 3 > stop || data[pos] != _dot) {
+      return false;
+    }
+    if (!_isDigit(data[pos + 1]) || !_isDigit(data[pos + 2])) {
+      return false;
+    }
+    value = value * 100 + (data[pos + 1] - _zero) * 10 + data[pos + 2] - _zero;
+    pos += 3;
+    if (value > 32767) {
+      value = 32767;
+    }
+    out.fields[field] = negative ? -value : value;
+  }
+  return pos == stop;
+}
+
+/// Encodes outgoing commands into buffers it owns, like encode() and
+/// encodeAscii() in gateway/wire_protocol.h, so a send allocates nothing.
+/// The list returned is a view of those buffers: it is only valid until
+/// the next call. Fields past the eighth are ignored.
+class WireEncoder {
+  final Uint8List _raw = Uint8List(_maxRawSize);
+  final Uint8List _out = Uint8List(_maxAsciiSize > _maxFrameSize ? _maxAsciiSize : _maxFrameSize);
+  // One view per frame length, created on first use.
+  late final List<Uint8List?> _views = List<Uint8List?>.filled(_out.length + 1, null);
+
+  Uint8List _view(int length) => _views[length] ??= Uint8List.sublistView(_out, 0, length);
+
+  /// Binary v1 frame, COBS encoded, terminator included.
+  Uint8List encode(int type, int seq, List<int> fields) {
+    final int count = fields.length < _maxFields ? fields.length : _maxFields;
+    int n = 0;
+    _raw[n++] = (wireVersion << _versionShift) | (type & _typeMask);
+    _raw[n++] = seq & 0xff;
+    _raw[n++] = (seq >> 8) & 0xff;
+    for (int i = 0; i < count; i++) {
+      _raw[n++] = fields[i] & 0xff;
+      _raw[n++] = (fields[i] >> 8) & 0xff;
+    }
+    final int crc = crc16(_raw, 0, n);
+    _raw[n++] = crc & 0xff;
+    _raw[n++] = crc >> 8;
+    final int length = _cobsEncodeInto(_raw, n, _out);
+    _out[length] = 0;
+    return _view(length + 1);
+  }
+
+  /// Legacy ASCII frame: "\x02heartbeat\x03", "\x02start\x03",
+  /// "\x02stop\x03" or a move as "\x02+0.50-0.25\x03". Empty for any
+  /// other type.
+  Uint8List encodeAscii(int type, List<int> fields) {
+    int n = 0;
+    _out[n++] = _stx;
+    switch (type) {
+      case WireType.heartbeat:
+        n = _writeWord(_heartbeatWord, n);
+        break;
+      case WireType.start:
+        n = _writeWord(_startWord, n);
+        break;
+      case WireType.stop:
+        n = _writeWord(_stopWord, n);
+        break;
+      case WireType.move:
+        if (fields.length < 2) return _view(0);
+        n = _writeField(fields[0], n);
+        n = _writeField(fields[1], n);
+        break;
+      default:
+        return _view(0);
+    }
+    _out[n++] = _etx;
+    return _view(n);
+  }
+
+  int _writeWord(List<int> word, int n) {
+    _out.setRange(n, n + word.length, word);
+    return n + word.length;
+  }
+
+  // [+-], the whole part without leading zeros, '.', two decimals.
+  int _writeField(int hundredths, int n) {
+    int v = hundredths.toSigned(16);
+    _out[n++] = v < 0 ? _minus : _plus;
+    if (v < 0) v = -v;
+    int whole = v ~/ 100;
+    int digits = 1;
+    for (int t = whole; t >= 10; t ~/= 10) {
+      digits++;
+    }
+    for (int i = digits - 1; i >= 0; i--) {
+      _out[n + i] = _zero + whole % 10;
+      whole ~/= 10;
+    }
+    n += digits;
+    _out[n++] = _dot;
+    _out[n++] = _zero + (v ~/ 10) % 10;
+    _out[n++] = _zero + v % 10;
+    return n;
+  }
+}
+
+const List<int> _heartbeatWord = <int>[0x68, 0x65, 0x61, 0x72, 0x74, 0x62, 0x65, 0x61, 0x74];
+const List<int> _startWord = <int>[0x73, 0x74, 0x61, 0x72, 0x74];
+const List<int> _stopWord = <int>[0x73, 0x74, 0x6f, 0x70];
+
+/// Converts a value to the protocol's fixed point (hundredths), saturating
+/// at the int16 range.
+int toFixedHundredths(double value) => (value * 100).round().clamp(-32768, 32767);
+
+/// Converts a fixed-point field back to a double.
+double fromFixedHundredths(int value) => value / 100.0;
@@ -1,6 +1,11 @@
 import 'dart:async';
 import 'package:flutter/material.dart';
 import '../services/pills_connection_service.dart';
+import 'frame_sampled_notifier.dart';
+import 'telemetry_history.dart';
+import 'widgets/link_quality_bar.dart';
+import 'widgets/telemetry_plot.dart';
+import 'widgets/telemetry_readouts.dart';
 import 'widgets/throttle_slider.dart';
 import 'widgets/joystick_right.dart';
 
@@ -14,43 +19,33 @@ class ControllerScreen extends StatefulWidget {
 class _ControllerScreenState extends State<ControllerScreen> {
   final PillsConnectionService connectionService = PillsConnectionService();
 
-  // Holds the latest data from the MCU to display on the UI.
-  McuData _latestMcuData = McuData();
-  // Manages the stream subscription.
+  // Holds the latest data from the MCU, published once per frame. Only the
+  // readouts listen to it; the screen itself never rebuilds for telemetry.
+  final FrameSampledNotifier<McuData> _latestMcuData = FrameSampledNotifier<McuData>(McuData());
+  // Recent samples for the plots, in ring buffers.
+  final TelemetryHistory _history = TelemetryHistory();
+  // Manages the stream subscriptions.
   StreamSubscription? _mcuDataSubscription;
+  StreamSubscription? _batchSubscription;
 
   @override
   void initState() {
     super.initState();
     // Subscribe to the response stream when the page loads.
-    _mcuDataSubscription = connectionService.responseStream.listen((data) {
-      if (mounted) {
-        setState(() {
-          _latestMcuData = data;
-        });
-      }
-    });
+    _mcuDataSubscription = connectionService.responseStream.listen(_latestMcuData.post);
+    _batchSubscription = connectionService.telemetryBatches.listen(_history.addBatch);
   }
 
   @override
   void dispose() {
     // Cancel the subscription when the page is destroyed to prevent memory leaks.
     _mcuDataSubscription?.cancel();
+    _batchSubscription?.cancel();
+    _latestMcuData.dispose();
+    _history.dispose();
     super.dispose();
   }
 
-  // Helper widget for displaying a single piece of info.
-  Widget _buildInfoDisplay(String label, String value, Color valueColor) {
-    return Column(
-      mainAxisSize: MainAxisSize.min,
-      children: [
-        Text(label, style: const TextStyle(color: Colors.white70, fontSize: 14)),
-        const SizedBox(height: 4),
-        Text(value, style: TextStyle(color: valueColor, fontSize: 18, fontWeight: FontWeight.bold)),
-      ],
-    );
-  }
-
   // Helper widget for building control buttons.
   Widget buildControlButton(IconData icon, String command) {
     return IconButton(
@@ -75,7 +70,14 @@ class _ControllerScreenState extends State<ControllerScreen> {
                 mainAxisAlignment: MainAxisAlignment.spaceBetween,
                 children: <Widget>[
                   buildControlButton(Icons.play_arrow, 'start'),
-                  const Text('MCU Status', style: TextStyle(color: Colors.white, fontSize: 16)),
+                  Column(
+                    mainAxisSize: MainAxisSize.min,
+                    children: <Widget>[
+                      const Text('MCU Status', style: TextStyle(color: Colors.white, fontSize: 16)),
+                      const SizedBox(height: 4),
+                      LinkQualityBar(quality: connectionService.linkQuality),
+                    ],
+                  ),
                   buildControlButton(Icons.stop, 'stop'),
                 ],
               ),
@@ -84,17 +86,13 @@ class _ControllerScreenState extends State<ControllerScreen> {
             // New MCU data display section.
             Padding(
               padding: const EdgeInsets.all(16.0),
-              child: Wrap(
-                spacing: 24.0,
-                runSpacing: 16.0,
-                alignment: WrapAlignment.center,
-                children: [
-                  _buildInfoDisplay('Duty Cycle', _latestMcuData.dutyCycle.toStringAsFixed(2), Colors.greenAccent),
-                  _buildInfoDisplay('Accel X', _latestMcuData.accelX.toStringAsFixed(2), Colors.amber),
-                  _buildInfoDisplay('Accel Y', _latestMcuData.accelY.toStringAsFixed(2), Colors.amber),
-                  _buildInfoDisplay('Accel Z', _latestMcuData.accelZ.toStringAsFixed(2), Colors.amber),
-                ],
-              ),
+              child: TelemetryReadouts(telemetry: _latestMcuData),
+            ),
+
+            // Last 10 s of duty cycle (top) and acceleration (bottom).
+            Padding(
+              padding: const EdgeInsets.symmetric(horizontal: 16.0),
+              child: TelemetryPlot(history: _history),
             ),
 
             // Main controls area.
@@ -0,0 +1,33 @@
+import 'package:flutter/foundation.dart';
+import 'package:flutter/scheduler.dart';
+
+// A ValueNotifier for values that change faster than the screen refreshes,
+// such as telemetry at hundreds of Hz. post() only stores the value; the
+// newest one is published once, at the start of the next frame, so
+// listeners rebuild at most once per vsync however many values arrived.
+class FrameSampledNotifier<T> extends ValueNotifier<T> {
+  FrameSampledNotifier(super.value);
+
+  late T _pending;
+  int? _callbackId;
+
+  void post(T value) {
+    _pending = value;
+    _callbackId ??= SchedulerBinding.instance.scheduleFrameCallback(_publish);
+  }
+
+  void _publish(Duration timeStamp) {
+    _callbackId = null;
+    value = _pending;
+  }
+
+  @override
+  void dispose() {
+    final int? id = _callbackId;
+    if (id != null) {
+      SchedulerBinding.instance.cancelFrameCallbackWithId(id);
+      _callbackId = null;
+    }
+    super.dispose();
+  }
+}
@@ -0,0 +1,70 @@
+import 'dart:typed_data';
+
+import '../services/udp_transport.dart';
+import 'frame_sampled_notifier.dart';
+
+// The last [capacity] telemetry samples, in preallocated ring buffers: one
+// Float32List per channel (duty cycle, accel x, y, z) and the arrival time
+// of each sample. Adding samples allocates nothing, so it keeps up with
+// kHz-rate telemetry without feeding the garbage collector.
+//
+// Samples arrive in batches (udp_transport.dart) that carry no time, so a
+// batch's samples are spread evenly between the previous batch and now,
+// over at most [maxBatchSpan].
+class TelemetryHistory {
+  TelemetryHistory({this.capacity = 16384})
+      : _values = List<Float32List>.generate(channels, (int _) => Float32List(capacity)),
+        _times = Float64List(capacity);
+
+  static const int channels = udpValuesPerSample;
+  static const Duration maxBatchSpan = Duration(milliseconds: 100);
+
+  final int capacity;
+  final List<Float32List> _values;
+  final Float64List _times; // Seconds on _clock
+
+  final Stopwatch _clock = Stopwatch()..start();
+  int _head = 0; // Next slot written
+  int _length = 0;
+  int _total = 0;
+
+  /// Bumped at most once per frame, after samples were added. Painters
+  /// repaint on it.
+  final FrameSampledNotifier<int> revision = FrameSampledNotifier<int>(0);
+
+  int get length => _length;
+
+  /// Arrival time in seconds of the [i]th sample, oldest first.
+  double timeAt(int i) => _times[_slot(i)];
+
+  /// Value of [channel] in the [i]th sample, oldest first.
+  double valueAt(int channel, int i) => _values[channel][_slot(i)];
+
+  int _slot(int i) {
+    final int slot = _head - _length + i;
+    return slot < 0 ? slot + capacity : slot;
+  }
+
+  /// Appends a batch of [channels] values per sample.
+  void addBatch(Float64List batch) {
+    final int samples = batch.length ~/ channels;
+    if (samples == 0) return;
+    final double now = _clock.elapsedMicroseconds / 1e6;
+    double span = _length == 0 ? 0.0 : now - timeAt(_length - 1);
+    final double maxSpan = maxBatchSpan.inMicroseconds / 1e6;
+    if (span > maxSpan) span = maxSpan;
+    final double step = span / samples;
+    for (int i = 0; i < samples; i++) {
+      for (int c = 0; c < channels; c++) {
+        _values[c][_head] = batch[i * channels + c];
+      }
+      _times[_head] = now - (samples - 1 - i) * step;
+      _head = _head + 1 == capacity ? 0 : _head + 1;
+    }
+    _length = _length + samples > capacity ? capacity : _length + samples;
+    _total += samples;
+    revision.post(_total);
+  }
+
+  void dispose() => revision.dispose();
+}
@@ -0,0 +1,39 @@
+import 'package:flutter/material.dart';
+import '../../services/link_quality.dart';
+
+// One line of link figures: "RTT 3.2 ms · jitter 0.4 ms · loss 0%". The
+// colour turns amber, then red, as the link degrades. Rebuilds only
+// itself, a few times a second.
+class LinkQualityBar extends StatelessWidget {
+  const LinkQualityBar({super.key, required this.quality});
+
+  final Stream<LinkQuality> quality;
+
+  static String _ms(Duration? d) => d == null ? '--' : (d.inMicroseconds / 1000).toStringAsFixed(1);
+
+  static Color _colorOf(LinkQuality q) {
+    final int rttUs = q.rtt?.inMicroseconds ?? 0;
+    if (q.loss > 0.2 || rttUs > 100000) return Colors.redAccent;
+    if (q.loss > 0.05 || rttUs > 30000) return Colors.amber;
+    return Colors.greenAccent;
+  }
+
+  @override
+  Widget build(BuildContext context) {
+    return RepaintBoundary(
+      child: StreamBuilder<LinkQuality>(
+        stream: quality,
+        builder: (BuildContext context, AsyncSnapshot<LinkQuality> snapshot) {
+          final LinkQuality? q = snapshot.data;
+          if (q == null || q.samples == 0) {
+            return const Text('No link figures yet', style: TextStyle(color: Colors.white38, fontSize: 12));
+          }
+          return Text(
+            'RTT ${_ms(q.rtt)} ms · jitter ${_ms(q.jitter)} ms · loss ${(q.loss * 100).round()}%',
+            style: TextStyle(color: _colorOf(q), fontSize: 12),
+          );
+        },
+      ),
+    );
+  }
+}
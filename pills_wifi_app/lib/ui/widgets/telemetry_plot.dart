@@ -0,0 +1,186 @@
+import 'dart:typed_data';
+import 'dart:ui' show PointMode;
+
+import 'package:flutter/material.dart';
+import '../telemetry_history.dart';
+
+// Scrolling plot of the last [window] of telemetry: duty cycle in the top
+// lane, accel x, y and z in the bottom one, each lane scaled to what it
+// shows.
+class TelemetryPlot extends StatefulWidget {
+  const TelemetryPlot({
+    super.key,
+    required this.history,
+    this.window = const Duration(seconds: 10),
+    this.height = 140.0,
+  });
+
+  final TelemetryHistory history;
+  final Duration window;
+  final double height;
+
+  @override
+  State<TelemetryPlot> createState() => _TelemetryPlotState();
+}
+
+class _TelemetryPlotState extends State<TelemetryPlot> {
+  // Kept across builds: the painter owns the buffers it draws from.
+  late TelemetryPlotPainter _painter = TelemetryPlotPainter(widget.history, window: widget.window);
+
+  @override
+  void didUpdateWidget(TelemetryPlot oldWidget) {
+    super.didUpdateWidget(oldWidget);
+    if (oldWidget.history != widget.history || oldWidget.window != widget.window) {
+      _painter = TelemetryPlotPainter(widget.history, window: widget.window);
+    }
+  }
+
+  @override
+  Widget build(BuildContext context) {
+    return RepaintBoundary(
+      child: CustomPaint(
+        size: Size(double.infinity, widget.height),
+        painter: _painter,
+      ),
+    );
+  }
+}
+
+// Draws every channel of a TelemetryHistory with one vertical segment per
+// pixel column, spanning the minimum to the maximum of the samples that
+// fall in it, so a burst shorter than a pixel still shows. Repaints only
+// when the history has new samples (at most once per frame). Paints reuse
+// the painter's buffers and issue one drawRawPoints() per channel, so
+// nothing is allocated per frame unless the plot changes width.
+class TelemetryPlotPainter extends CustomPainter {
+  TelemetryPlotPainter(this.history, {this.window = const Duration(seconds: 10)})
+      : super(repaint: history.revision);
+
+  final TelemetryHistory history;
+  final Duration window;
+
+  static const int _channels = TelemetryHistory.channels;
+  static const List<Color> _colors = <Color>[
+    Colors.greenAccent,
+    Colors.amber,
+    Colors.lightBlueAccent,
+    Colors.pinkAccent,
+  ];
+  static const double _padding = 2.0;
+
+  final List<Paint> _paints = List<Paint>.generate(
+    _channels,
+    (int c) => Paint()
+      ..color = _colors[c]
+      ..strokeWidth = 1.0,
+  );
+  final Paint _axisPaint = Paint()
+    ..color = Colors.white24
+    ..strokeWidth = 1.0;
+
+  // Per channel and column; sized for the current width.
+  int _columns = 0;
+  Float32List _min = Float32List(0);
+  Float32List _max = Float32List(0);
+  Float32List _points = Float32List(0);
+
+  void _resize(int columns) {
+    if (columns == _columns) return;
+    _columns = columns;
+    _min = Float32List(_channels * columns);
+    _max = Float32List(_channels * columns);
+    _points = Float32List(4 * columns);
+  }
+
+  @override
+  void paint(Canvas canvas, Size size) {
+    final double laneHeight = size.height / 2;
+    canvas.drawLine(Offset(0, laneHeight), Offset(size.width, laneHeight), _axisPaint);
+    final int n = history.length;
+    final int columns = size.width.floor();
+    if (n == 0 || columns <= 0) return;
+    _resize(columns);
+
+    // The window ends at the newest sample, so the plot only moves when
+    // telemetry does.
+    final double span = window.inMicroseconds / 1e6;
+    final double start = history.timeAt(n - 1) - span;
+    final double columnsPerSecond = columns / span;
+    _min.fillRange(0, _min.length, double.infinity);
+    _max.fillRange(0, _max.length, double.negativeInfinity);
+    int first = n - 1;
+    while (first > 0 && history.timeAt(first - 1) >= start) {
+      first--;
+    }
+    for (int i = first; i < n; i++) {
+      int column = ((history.timeAt(i) - start) * columnsPerSecond).floor();
+      if (column >= columns) column = columns - 1;
+      if (column < 0) column = 0;
+      for (int c = 0; c < _channels; c++) {
+        final double v = history.valueAt(c, i);
+        final int slot = c * columns + column;
+        if (v < _min[slot]) _min[slot] = v;
+        if (v > _max[slot]) _max[slot] = v;
+      }
+    }
+
+    _drawLane(canvas, 0, 1, 0, laneHeight);
+    _drawLane(canvas, 1, _channels, laneHeight, laneHeight);
+  }
+
+  // Draws channels [from, to) into the lane at [top], sharing one scale.
+  void _drawLane(Canvas canvas, int from, int to, double top, double height) {
+    final int columns = _columns;
+    double lo = double.infinity;
+    double hi = double.negativeInfinity;
+    for (int slot = from * columns; slot < to * columns; slot++) {
+      if (_min[slot] < lo) lo = _min[slot];
+      if (_max[slot] > hi) hi = _max[slot];
+    }
+    if (lo > hi) return;
+    if (hi - lo < 0.01) {
+      // A flat signal sits in the middle of the lane
+      lo -= 0.5;
+      hi += 0.5;
+    }
+    final double scale = (height - 2 * _padding) / (hi - lo);
+    final double bottom = top + height - _padding;
+
+    for (int c = from; c < to; c++) {
+      bool any = false;
+      double prevMin = 0.0;
+      double prevMax = 0.0;
+      for (int column = 0; column < columns; column++) {
+        final int slot = c * columns + column;
+        final int p = 4 * column;
+        if (_min[slot] > _max[slot]) {
+          // No sample: a zero-length segment off the canvas
+          _points[p] = _points[p + 2] = -1.0;
+          _points[p + 1] = _points[p + 3] = -1.0;
+          continue;
+        }
+        double vMin = _min[slot];
+        double vMax = _max[slot];
+        if (any) {
+          // Reach over to the previous column so the trace stays connected
+          if (vMin > prevMax) vMin = prevMax;
+          if (vMax < prevMin) vMax = prevMin;
+        }
+        any = true;
+        prevMin = _min[slot];
+        prevMax = _max[slot];
+        final double y1 = bottom - (vMax - lo) * scale;
+        double y2 = bottom - (vMin - lo) * scale;
+        if (y2 - y1 < 1.0) y2 = y1 + 1.0;
+        _points[p] = _points[p + 2] = column + 0.5;
+        _points[p + 1] = y1;
+        _points[p + 3] = y2;
+      }
+      canvas.drawRawPoints(PointMode.lines, _points, _paints[c]);
+    }
+  }
+
+  @override
+  bool shouldRepaint(TelemetryPlotPainter oldDelegate) =>
+      oldDelegate.history != history || oldDelegate.window != window;
+}
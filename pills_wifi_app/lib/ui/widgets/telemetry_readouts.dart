@@ -0,0 +1,46 @@
+import 'package:flutter/foundation.dart';
+import 'package:flutter/material.dart';
+import '../../services/pills_connection_service.dart';
+
+// The four MCU readouts. Only this widget rebuilds when telemetry changes,
+// and it paints on its own layer, so the joystick and the throttle are
+// neither rebuilt nor repainted by it.
+class TelemetryReadouts extends StatelessWidget {
+  const TelemetryReadouts({super.key, required this.telemetry});
+
+  final ValueListenable<McuData> telemetry;
+
+  // Helper widget for displaying a single piece of info.
+  Widget _buildInfoDisplay(String label, String value, Color valueColor) {
+    return Column(
+      mainAxisSize: MainAxisSize.min,
+      children: [
+        Text(label, style: const TextStyle(color: Colors.white70, fontSize: 14)),
+        const SizedBox(height: 4),
+        Text(value, style: TextStyle(color: valueColor, fontSize: 18, fontWeight: FontWeight.bold)),
+      ],
+    );
+  }
+
+  @override
+  Widget build(BuildContext context) {
+    return RepaintBoundary(
+      child: ValueListenableBuilder<McuData>(
+        valueListenable: telemetry,
+        builder: (BuildContext context, McuData data, Widget? child) {
+          return Wrap(
+            spacing: 24.0,
+            runSpacing: 16.0,
+            alignment: WrapAlignment.center,
+            children: [
+              _buildInfoDisplay('Duty Cycle', data.dutyCycle.toStringAsFixed(2), Colors.greenAccent),
+              _buildInfoDisplay('Accel X', data.accelX.toStringAsFixed(2), Colors.amber),
+              _buildInfoDisplay('Accel Y', data.accelY.toStringAsFixed(2), Colors.amber),
+              _buildInfoDisplay('Accel Z', data.accelZ.toStringAsFixed(2), Colors.amber),
+            ],
+          );
+        },
+      ),
+    );
+  }
+}
@@ -0,0 +1,476 @@
+#include "udp_link.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <utility>
+
+namespace {
+
+constexpr size_t kValuesPerSample = 4;
+// Samples kept while the UI thread is not taking batches; the oldest half
+// is discarded beyond this.
+constexpr size_t kMaxBatchSamples = 4096;
+constexpr size_t kMaxLinkSamples = 256;
+constexpr int kMaxEvents = 4;
+
+uint64_t NowNs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull +
+         static_cast<uint64_t>(ts.tv_nsec);
+}
+
+std::string ErrnoText(const char* what) {
+  return std::string(what) + ": " + strerror(errno);
+}
+
+// Wakes the I/O thread. A failed write means the eventfd counter is
+// already non-zero, so the thread is due to wake anyway.
+void Signal(int fd) {
+  uint64_t one = 1;
+  if (write(fd, &one, sizeof(one)) < 0) {
+    return;
+  }
+}
+
+void Drain(int fd) {
+  uint64_t count;
+  if (read(fd, &count, sizeof(count)) < 0) {
+    return;
+  }
+}
+
+}  // namespace
+
+UdpLink::UdpLink(std::function<void()> on_batch)
+    : on_batch_(std::move(on_batch)),
+      socket_fd_(-1),
+      epoll_fd_(-1),
+      timer_fd_(-1),
+      wake_fd_(-1),
+      target_(),
+      local_port_(0),
+      legacy_ascii_(false),
+      period_ns_(0),
+      next_tick_ns_(0),
+      seq_(0),
+      last_ping_ns_(0),
+      pending_pings_(),
+      stop_(false),
+      repeating_(),
+      new_period_us_(0),
+      stats_() {}
+
+UdpLink::~UdpLink() { Close(); }
+
+bool UdpLink::Open(const std::string& host, uint16_t port, uint32_t period_us,
+                   bool legacy_ascii, std::string* error) {
+  Close();
+  target_ = sockaddr_in();
+  target_.sin_family = AF_INET;
+  target_.sin_port = htons(port);
+  if (inet_pton(AF_INET, host.c_str(), &target_.sin_addr) != 1) {
+    *error = "bad address " + host;
+    return false;
+  }
+  if (period_us == 0) {
+    *error = "send period must not be 0";
+    return false;
+  }
+
+  socket_fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (socket_fd_ < 0 || epoll_fd_ < 0 || timer_fd_ < 0 || wake_fd_ < 0) {
+    *error = ErrnoText("cannot create descriptors");
+    Close();
+    return false;
+  }
+
+  sockaddr_in local = sockaddr_in();
+  local.sin_family = AF_INET;
+  local.sin_addr.s_addr = htonl(INADDR_ANY);
+  socklen_t local_len = sizeof(local);
+  if (bind(socket_fd_, reinterpret_cast<sockaddr*>(&local), sizeof(local)) !=
+          0 ||
+      getsockname(socket_fd_, reinterpret_cast<sockaddr*>(&local),
+                  &local_len) != 0) {
+    *error = ErrnoText("cannot bind UDP socket");
+    Close();
+    return false;
+  }
+  local_port_ = ntohs(local.sin_port);
+
+  int fds[] = {socket_fd_, timer_fd_, wake_fd_};
+  for (int fd : fds) {
+    epoll_event event = epoll_event();
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+      *error = ErrnoText("epoll_ctl");
+      Close();
+      return false;
+    }
+  }
+
+  if (!ArmTimer(static_cast<uint64_t>(period_us) * 1000)) {
+    *error = ErrnoText("timerfd_settime");
+    Close();
+    return false;
+  }
+
+  legacy_ascii_ = legacy_ascii;
+  last_ping_ns_ = 0;
+  for (PendingPing& ping : pending_pings_) {
+    ping.sent_ns = 0;
+  }
+  {
+    std::lock_guard<std::mutex> lock(command_mutex_);
+    repeating_ = gw::wire::Message();
+    repeating_.type = gw::wire::kHeartbeat;
+    one_shots_.clear();
+    new_period_us_ = 0;
+  }
+  {
+    std::lock_guard<std::mutex> lock(batch_mutex_);
+    batch_.clear();
+    link_samples_.clear();
+  }
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_ = Stats();
+  }
+  stop_ = false;
+  thread_ = std::thread(&UdpLink::Run, this);
+  return true;
+}
+
+void UdpLink::Close() {
+  if (thread_.joinable()) {
+    stop_ = true;
+    Signal(wake_fd_);
+    thread_.join();
+  }
+  int* fds[] = {&socket_fd_, &epoll_fd_, &timer_fd_, &wake_fd_};
+  for (int* fd : fds) {
+    if (*fd >= 0) {
+      close(*fd);
+      *fd = -1;
+    }
+  }
+  local_port_ = 0;
+}
+
+void UdpLink::SetRepeating(const gw::wire::Message& msg) {
+  std::lock_guard<std::mutex> lock(command_mutex_);
+  repeating_ = msg;
+}
+
+void UdpLink::SendNow(const gw::wire::Message& msg) {
+  {
+    std::lock_guard<std::mutex> lock(command_mutex_);
+    one_shots_.push_back(msg);
+  }
+  if (wake_fd_ >= 0) {
+    Signal(wake_fd_);
+  }
+}
+
+void UdpLink::SetPeriod(uint32_t period_us) {
+  if (period_us == 0) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(command_mutex_);
+    new_period_us_ = period_us;
+  }
+  if (wake_fd_ >= 0) {
+    Signal(wake_fd_);
+  }
+}
+
+void UdpLink::TakeBatch(std::vector<double>* samples,
+                        std::vector<int32_t>* link_samples) {
+  samples->clear();
+  link_samples->clear();
+  std::lock_guard<std::mutex> lock(batch_mutex_);
+  samples->swap(batch_);
+  link_samples->swap(link_samples_);
+}
+
+UdpLink::Stats UdpLink::GetStats() {
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  return stats_;
+}
+
+// --- I/O thread ---
+
+// Ticks on an absolute schedule, so lateness does not accumulate.
+bool UdpLink::ArmTimer(uint64_t period_ns) {
+  uint64_t first_ns = NowNs() + period_ns;
+  itimerspec spec = itimerspec();
+  spec.it_value.tv_sec = static_cast<time_t>(first_ns / 1000000000ull);
+  spec.it_value.tv_nsec = static_cast<long>(first_ns % 1000000000ull);
+  spec.it_interval.tv_sec = static_cast<time_t>(period_ns / 1000000000ull);
+  spec.it_interval.tv_nsec = static_cast<long>(period_ns % 1000000000ull);
+  if (timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+    return false;
+  }
+  period_ns_ = period_ns;
+  next_tick_ns_ = first_ns;
+  return true;
+}
+
+void UdpLink::Run() {
+  epoll_event events[kMaxEvents];
+  while (!stop_) {
+    int n = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+    if (n < 0 && errno != EINTR) {
+      break;
+    }
+    // Timer first: a burst of telemetry must not delay a due send.
+    for (int i = 0; i < n; i++) {
+      if (events[i].data.fd == timer_fd_) {
+        OnTimer();
+      }
+    }
+    for (int i = 0; i < n; i++) {
+      if (events[i].data.fd == wake_fd_) {
+        OnWake();
+      } else if (events[i].data.fd == socket_fd_) {
+        OnReadable();
+      }
+    }
+  }
+}
+
+void UdpLink::OnTimer() {
+  uint64_t expirations = 0;
+  if (read(timer_fd_, &expirations, sizeof(expirations)) !=
+          static_cast<ssize_t>(sizeof(expirations)) ||
+      expirations == 0) {
+    return;
+  }
+  // Only the latest tick is honoured; sending the missed ones late would
+  // just burst stale commands.
+  uint64_t due = next_tick_ns_ + (expirations - 1) * period_ns_;
+  next_tick_ns_ = due + period_ns_;
+  uint64_t now = NowNs();
+  uint64_t late_us = now > due ? (now - due) / 1000 : 0;
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.missed_ticks += expirations - 1;
+    if (late_us > stats_.max_late_us) {
+      stats_.max_late_us = static_cast<uint32_t>(late_us);
+    }
+  }
+
+  gw::wire::Message msg;
+  {
+    std::lock_guard<std::mutex> lock(command_mutex_);
+    msg = repeating_;
+  }
+  if (legacy_ascii_) {
+    Send(msg);
+    return;
+  }
+  ExpirePings(now);
+  // Checked per tick: a ping is at most half a period early or late.
+  if (now + period_ns_ / 2 < last_ping_ns_ + kProbePeriodUs * 1000ull) {
+    Send(msg);
+  } else if (msg.type == gw::wire::kHeartbeat) {
+    Ping(now);  // Refreshes the session just as well
+  } else {
+    Send(msg);
+    Ping(now);
+  }
+}
+
+void UdpLink::Ping(uint64_t now) {
+  last_ping_ns_ = now;
+  PendingPing* slot = nullptr;
+  for (PendingPing& ping : pending_pings_) {
+    if (ping.sent_ns == 0) {
+      slot = &ping;
+      break;
+    }
+  }
+  if (slot == nullptr) {
+    return;  // Can't happen while pings time out before the table fills
+  }
+  uint32_t clock_us = static_cast<uint32_t>(now / 1000);
+  gw::wire::Message msg = gw::wire::Message();
+  msg.type = gw::wire::kPing;
+  msg.field_count = 2;
+  msg.fields[0] = static_cast<int16_t>(clock_us & 0xffff);
+  msg.fields[1] = static_cast<int16_t>(clock_us >> 16);
+  slot->seq = seq_;  // Send() stamps the next seq
+  slot->sent_ns = now;
+  Send(msg);
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  stats_.probes++;
+}
+
+void UdpLink::ExpirePings(uint64_t now) {
+  for (PendingPing& ping : pending_pings_) {
+    if (ping.sent_ns != 0 && now - ping.sent_ns >= kPingTimeoutUs * 1000ull) {
+      ping.sent_ns = 0;
+      AddLinkSample(kProbeLost);
+    }
+  }
+}
+
+// The round trip comes from the clock the pong echoes; the table only
+// tells a pong in time from a late or duplicated one.
+void UdpLink::OnPong(const gw::wire::Message& msg) {
+  for (PendingPing& ping : pending_pings_) {
+    if (ping.sent_ns != 0 && ping.seq == msg.seq) {
+      ping.sent_ns = 0;
+      uint32_t clock_us = static_cast<uint32_t>(
+          static_cast<uint16_t>(msg.fields[0]) |
+          (static_cast<uint32_t>(static_cast<uint16_t>(msg.fields[1])) << 16));
+      uint32_t rtt_us = static_cast<uint32_t>(NowNs() / 1000) - clock_us;
+      AddLinkSample(static_cast<int32_t>(rtt_us));
+      return;
+    }
+  }
+}
+
+void UdpLink::OnWake() {
+  Drain(wake_fd_);
+  std::vector<gw::wire::Message> queued;
+  uint32_t period_us;
+  {
+    std::lock_guard<std::mutex> lock(command_mutex_);
+    queued.swap(one_shots_);
+    period_us = new_period_us_;
+    new_period_us_ = 0;
+  }
+  if (period_us != 0) {
+    // On failure the old period stays in force.
+    ArmTimer(static_cast<uint64_t>(period_us) * 1000);
+  }
+  for (const gw::wire::Message& msg : queued) {
+    Send(msg);
+  }
+}
+
+void UdpLink::Send(gw::wire::Message msg) {
+  uint8_t frame[gw::wire::kMaxFrameSize > gw::wire::kMaxAsciiSize
+                    ? gw::wire::kMaxFrameSize
+                    : gw::wire::kMaxAsciiSize];
+  size_t len;
+  if (legacy_ascii_) {
+    len = gw::wire::encodeAscii(msg, frame);
+  } else {
+    msg.seq = seq_++;
+    len = gw::wire::encode(msg, frame, sizeof(frame));
+  }
+  if (len == 0) {
+    return;
+  }
+  ssize_t sent = sendto(socket_fd_, frame, len, 0,
+                        reinterpret_cast<const sockaddr*>(&target_),
+                        sizeof(target_));
+  if (sent == static_cast<ssize_t>(len)) {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.sent++;
+  }
+}
+
+void UdpLink::OnReadable() {
+  uint8_t buf[2048];
+  for (;;) {
+    ssize_t n = recv(socket_fd_, buf, sizeof(buf), 0);
+    if (n < 0) {
+      return;  // EAGAIN, or an ICMP error reported on the socket
+    }
+    HandleDatagram(buf, static_cast<size_t>(n));
+  }
+}
+
+void UdpLink::HandleDatagram(const uint8_t* data, size_t len) {
+  // A datagram may carry several frames back to back in either format.
+  bool ascii = gw::wire::isAsciiDatagram(data, len);
+  uint8_t end_byte = ascii ? 0x03 : 0x00;
+  size_t start = 0;
+  while (start < len) {
+    const uint8_t* hit =
+        static_cast<const uint8_t*>(memchr(data + start, end_byte, len - start));
+    size_t end = hit ? static_cast<size_t>(hit - data) : len;
+    size_t frame_start = start;
+    start = end + 1;
+    gw::wire::Message msg;
+    bool ok;
+    if (ascii) {
+      ok = end < len && gw::wire::decodeAscii(data + frame_start,
+                                              end - frame_start + 1, &msg);
+    } else if (end > frame_start) {
+      ok = gw::wire::decode(data + frame_start, end - frame_start, &msg);
+    } else {
+      continue;  // Back-to-back terminators
+    }
+    if (!ok) {
+      std::lock_guard<std::mutex> lock(stats_mutex_);
+      stats_.malformed++;
+    } else if (msg.type == gw::wire::kTelemetry) {
+      AddSample(msg);
+    } else if (msg.type == gw::wire::kPong) {
+      OnPong(msg);
+    }
+  }
+}
+
+void UdpLink::AddSample(const gw::wire::Message& msg) {
+  bool first;
+  uint64_t dropped = 0;
+  {
+    std::lock_guard<std::mutex> lock(batch_mutex_);
+    if (batch_.size() >= kMaxBatchSamples * kValuesPerSample) {
+      // The UI has stopped taking batches; keep the newest half
+      size_t keep = batch_.size() / 2;
+      dropped = (batch_.size() - keep) / kValuesPerSample;
+      batch_.erase(batch_.begin(), batch_.end() - keep);
+    }
+    first = batch_.empty() && link_samples_.empty();
+    for (size_t i = 0; i < kValuesPerSample; i++) {
+      batch_.push_back(msg.fields[i] / 100.0);
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.samples++;
+    stats_.dropped += dropped;
+  }
+  if (first && on_batch_) {
+    on_batch_();
+  }
+}
+
+void UdpLink::AddLinkSample(int32_t rtt_us) {
+  bool first;
+  {
+    std::lock_guard<std::mutex> lock(batch_mutex_);
+    if (link_samples_.size() >= kMaxLinkSamples) {
+      link_samples_.erase(link_samples_.begin());
+    }
+    first = batch_.empty() && link_samples_.empty();
+    link_samples_.push_back(rtt_us);
+  }
+  if (rtt_us == kProbeLost) {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.probes_lost++;
+  }
+  if (first && on_batch_) {
+    on_batch_();
+  }
+}
@@ -0,0 +1,135 @@
+#ifndef FLUTTER_UDP_LINK_H_
+#define FLUTTER_UDP_LINK_H_
+
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "wire_protocol.h"
+
+// UDP link to the gateway, run on its own I/O thread.
+//
+// The thread owns the socket and waits in epoll on it, on a timerfd that
+// fires once per send period and on an eventfd the UI thread signals when
+// it queues a command. On every timer tick it sends the repeating command
+// (move or heartbeat) with a fresh seq; one-shot commands (start, stop) go
+// out as soon as they are queued. Nothing on the UI thread, including a
+// slow frame, delays a send.
+//
+// Telemetry is decoded on the thread into a batch of four values per
+// sample (duty cycle, accel x, y, z). on_batch runs on the I/O thread when
+// a sample lands in an empty batch; the owner then takes the whole batch
+// with TakeBatch() on its own thread, so the UI is woken once per batch
+// rather than once per datagram.
+//
+// In binary mode the thread also probes the link: every kProbePeriodUs it
+// sends a ping, a heartbeat carrying the thread's clock, which the gateway
+// echoes at once as a pong. While the repeating command is a heartbeat the
+// ping takes its place. Each ping yields a link sample: the round trip in
+// microseconds, from the clock the pong echoes, or kProbeLost if no pong
+// came within kPingTimeoutUs. Link samples are batched with the telemetry.
+// The ASCII protocol has no ping, so legacy mode does not probe.
+class UdpLink {
+ public:
+  struct Stats {
+    uint64_t sent;
+    uint64_t samples;       // Telemetry samples decoded
+    uint64_t malformed;     // Frames that did not decode
+    uint64_t dropped;       // Samples discarded while the batch was full
+    uint64_t missed_ticks;  // Timer periods that passed without a send
+    uint32_t max_late_us;   // Worst lateness of a send against its tick
+    uint64_t probes;        // Pings sent
+    uint64_t probes_lost;   // Pings without a pong in kPingTimeoutUs
+  };
+
+  static constexpr uint32_t kProbePeriodUs = 250000;
+  static constexpr uint32_t kPingTimeoutUs = 1000000;
+  static constexpr int32_t kProbeLost = -1;
+
+  explicit UdpLink(std::function<void()> on_batch);
+  ~UdpLink();
+
+  UdpLink(const UdpLink&) = delete;
+  UdpLink& operator=(const UdpLink&) = delete;
+
+  // Binds a socket and starts the I/O thread. Until SetRepeating() is
+  // called the timer sends heartbeats.
+  bool Open(const std::string& host, uint16_t port, uint32_t period_us,
+            bool legacy_ascii, std::string* error);
+  void Close();
+
+  bool is_open() const { return thread_.joinable(); }
+  uint16_t local_port() const { return local_port_; }
+
+  // Replaces the command sent on every tick. seq is assigned on sending.
+  void SetRepeating(const gw::wire::Message& msg);
+  // Sends msg once, right away.
+  void SendNow(const gw::wire::Message& msg);
+  // Changes the send period; the next tick is one new period from now.
+  void SetPeriod(uint32_t period_us);
+
+  // Moves the telemetry decoded and the link samples gathered so far into
+  // samples and link_samples, leaving the batch empty.
+  void TakeBatch(std::vector<double>* samples,
+                 std::vector<int32_t>* link_samples);
+
+  Stats GetStats();
+
+ private:
+  void Run();
+  void OnTimer();
+  void OnWake();
+  void OnReadable();
+  void Send(gw::wire::Message msg);
+  bool ArmTimer(uint64_t period_ns);
+  void Ping(uint64_t now);
+  void ExpirePings(uint64_t now);
+  void OnPong(const gw::wire::Message& msg);
+  void HandleDatagram(const uint8_t* data, size_t len);
+  void AddSample(const gw::wire::Message& msg);
+  void AddLinkSample(int32_t rtt_us);
+
+  std::function<void()> on_batch_;
+  int socket_fd_;
+  int epoll_fd_;
+  int timer_fd_;
+  int wake_fd_;
+  sockaddr_in target_;
+  uint16_t local_port_;
+  bool legacy_ascii_;
+  uint64_t period_ns_;
+  uint64_t next_tick_ns_;
+  uint16_t seq_;
+  uint64_t last_ping_ns_;
+  // Pings awaiting their pong; sent_ns is 0 in a free slot.
+  struct PendingPing {
+    uint16_t seq;
+    uint64_t sent_ns;
+  };
+  PendingPing pending_pings_[kPingTimeoutUs / kProbePeriodUs + 2];
+  std::thread thread_;
+  std::atomic<bool> stop_;
+
+  // Shared with the UI thread.
+  std::mutex command_mutex_;
+  gw::wire::Message repeating_;
+  std::vector<gw::wire::Message> one_shots_;
+  uint32_t new_period_us_;  // 0 unless SetPeriod() is pending
+
+  // on_batch_ runs when the first entry lands in an empty batch.
+  std::mutex batch_mutex_;
+  std::vector<double> batch_;
+  std::vector<int32_t> link_samples_;
+
+  std::mutex stats_mutex_;
+  Stats stats_;
+};
+
+#endif  // FLUTTER_UDP_LINK_H_
@@ -0,0 +1,249 @@
+#include "udp_transport_plugin.h"
+
+#include <string>
+#include <vector>
+
+#include "udp_link.h"
+
+namespace {
+
+constexpr char kMethodChannel[] = "pills_wifi_app/udp";
+constexpr char kEventChannel[] = "pills_wifi_app/udp/telemetry";
+constexpr char kLinkChannel[] = "pills_wifi_app/udp/link";
+
+}  // namespace
+
+struct _UdpTransportPlugin {
+  FlMethodChannel* methods;
+  FlEventChannel* events;
+  FlEventChannel* link_events;
+  bool listening;
+  bool link_listening;
+  UdpLink* link;
+  std::vector<double> batch;
+  std::vector<int32_t> link_samples;
+};
+
+static void send_event(FlEventChannel* channel, FlValue* event) {
+  g_autoptr(GError) error = nullptr;
+  if (!fl_event_channel_send(channel, event, nullptr, &error)) {
+    g_warning("Failed to send event: %s", error->message);
+  }
+}
+
+// Runs on the main thread, once per batch the I/O thread started.
+static gboolean flush_batch(gpointer user_data) {
+  UdpTransportPlugin* self = static_cast<UdpTransportPlugin*>(user_data);
+  self->link->TakeBatch(&self->batch, &self->link_samples);
+  if (self->listening && !self->batch.empty()) {
+    g_autoptr(FlValue) event =
+        fl_value_new_float_list(self->batch.data(), self->batch.size());
+    send_event(self->events, event);
+  }
+  if (self->link_listening && !self->link_samples.empty()) {
+    g_autoptr(FlValue) event = fl_value_new_int32_list(
+        self->link_samples.data(), self->link_samples.size());
+    send_event(self->link_events, event);
+  }
+  return G_SOURCE_REMOVE;
+}
+
+static int64_t lookup_int(FlValue* args, const char* key, int64_t fallback) {
+  FlValue* value = fl_value_lookup_string(args, key);
+  return value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_INT
+             ? fl_value_get_int(value)
+             : fallback;
+}
+
+// Reads {"type": int, "fields": [int, ...]} into msg. Fields are the
+// protocol's hundredths.
+static bool parse_message(FlValue* args, gw::wire::Message* msg) {
+  if (args == nullptr || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+    return false;
+  }
+  *msg = gw::wire::Message();
+  msg->type = static_cast<uint8_t>(lookup_int(args, "type", 0));
+  FlValue* fields = fl_value_lookup_string(args, "fields");
+  size_t count = fields != nullptr &&
+                         fl_value_get_type(fields) == FL_VALUE_TYPE_LIST
+                     ? fl_value_get_length(fields)
+                     : 0;
+  if (count > gw::wire::kMaxFields ||
+      gw::wire::fieldCount(msg->type) != static_cast<int>(count)) {
+    return false;
+  }
+  for (size_t i = 0; i < count; i++) {
+    FlValue* field = fl_value_get_list_value(fields, i);
+    if (fl_value_get_type(field) != FL_VALUE_TYPE_INT) {
+      return false;
+    }
+    msg->fields[i] = static_cast<int16_t>(fl_value_get_int(field));
+  }
+  msg->field_count = static_cast<uint8_t>(count);
+  return true;
+}
+
+static FlMethodResponse* handle_open(UdpTransportPlugin* self, FlValue* args) {
+  FlValue* host = args != nullptr && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                      ? fl_value_lookup_string(args, "host")
+                      : nullptr;
+  if (host == nullptr || fl_value_get_type(host) != FL_VALUE_TYPE_STRING) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "bad_args", "open needs a host", nullptr));
+  }
+  FlValue* legacy = fl_value_lookup_string(args, "legacyAscii");
+  std::string error;
+  if (!self->link->Open(
+          fl_value_get_string(host),
+          static_cast<uint16_t>(lookup_int(args, "port", 8080)),
+          static_cast<uint32_t>(lookup_int(args, "periodMs", 1000) * 1000),
+          legacy != nullptr && fl_value_get_type(legacy) == FL_VALUE_TYPE_BOOL &&
+              fl_value_get_bool(legacy),
+          &error)) {
+    return FL_METHOD_RESPONSE(
+        fl_method_error_response_new("open_failed", error.c_str(), nullptr));
+  }
+  g_autoptr(FlValue) port = fl_value_new_int(self->link->local_port());
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(port));
+}
+
+static FlMethodResponse* handle_stats(UdpTransportPlugin* self) {
+  UdpLink::Stats stats = self->link->GetStats();
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(result, "sent", fl_value_new_int(stats.sent));
+  fl_value_set_string_take(result, "samples", fl_value_new_int(stats.samples));
+  fl_value_set_string_take(result, "malformed",
+                           fl_value_new_int(stats.malformed));
+  fl_value_set_string_take(result, "dropped", fl_value_new_int(stats.dropped));
+  fl_value_set_string_take(result, "missedTicks",
+                           fl_value_new_int(stats.missed_ticks));
+  fl_value_set_string_take(result, "maxLateUs",
+                           fl_value_new_int(stats.max_late_us));
+  fl_value_set_string_take(result, "probes", fl_value_new_int(stats.probes));
+  fl_value_set_string_take(result, "probesLost",
+                           fl_value_new_int(stats.probes_lost));
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
+                           gpointer user_data) {
+  UdpTransportPlugin* self = static_cast<UdpTransportPlugin*>(user_data);
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  gw::wire::Message msg;
+  if (g_strcmp0(method, "open") == 0) {
+    response = handle_open(self, args);
+  } else if (g_strcmp0(method, "setRepeating") == 0 ||
+             g_strcmp0(method, "sendNow") == 0) {
+    if (!self->link->is_open()) {
+      response = FL_METHOD_RESPONSE(
+          fl_method_error_response_new("not_open", "link is closed", nullptr));
+    } else if (!parse_message(args, &msg)) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "bad_args", "unknown command or wrong field count", nullptr));
+    } else {
+      if (g_strcmp0(method, "sendNow") == 0) {
+        self->link->SendNow(msg);
+      } else {
+        self->link->SetRepeating(msg);
+      }
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    }
+  } else if (g_strcmp0(method, "setPeriod") == 0) {
+    int64_t period_us = args != nullptr &&
+                                fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                            ? lookup_int(args, "periodUs", 0)
+                            : 0;
+    if (period_us <= 0 || period_us > UINT32_MAX) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "bad_args", "setPeriod needs a positive periodUs", nullptr));
+    } else {
+      self->link->SetPeriod(static_cast<uint32_t>(period_us));
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    }
+  } else if (g_strcmp0(method, "stats") == 0) {
+    response = handle_stats(self);
+  } else if (g_strcmp0(method, "close") == 0) {
+    self->link->Close();
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+
+  g_autoptr(GError) error = nullptr;
+  if (!fl_method_call_respond(method_call, response, &error)) {
+    g_warning("Failed to respond to %s: %s", method, error->message);
+  }
+}
+
+static FlMethodErrorResponse* listen_cb(FlEventChannel* channel, FlValue* args,
+                                        gpointer user_data) {
+  static_cast<UdpTransportPlugin*>(user_data)->listening = true;
+  return nullptr;
+}
+
+static FlMethodErrorResponse* cancel_cb(FlEventChannel* channel, FlValue* args,
+                                        gpointer user_data) {
+  static_cast<UdpTransportPlugin*>(user_data)->listening = false;
+  return nullptr;
+}
+
+static FlMethodErrorResponse* link_listen_cb(FlEventChannel* channel,
+                                             FlValue* args,
+                                             gpointer user_data) {
+  static_cast<UdpTransportPlugin*>(user_data)->link_listening = true;
+  return nullptr;
+}
+
+static FlMethodErrorResponse* link_cancel_cb(FlEventChannel* channel,
+                                             FlValue* args,
+                                             gpointer user_data) {
+  static_cast<UdpTransportPlugin*>(user_data)->link_listening = false;
+  return nullptr;
+}
+
+UdpTransportPlugin* udp_transport_plugin_new(FlPluginRegistry* registry) {
+  UdpTransportPlugin* self = new UdpTransportPlugin();
+  // Wakes the main loop once per batch; flush_batch() takes it there.
+  self->link = new UdpLink([self]() { g_idle_add(flush_batch, self); });
+
+  g_autoptr(FlPluginRegistrar) registrar =
+      fl_plugin_registry_get_registrar_for_plugin(registry,
+                                                  "UdpTransportPlugin");
+  FlBinaryMessenger* messenger = fl_plugin_registrar_get_messenger(registrar);
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  self->methods =
+      fl_method_channel_new(messenger, kMethodChannel, FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(self->methods, method_call_cb,
+                                            self, nullptr);
+  self->events =
+      fl_event_channel_new(messenger, kEventChannel, FL_METHOD_CODEC(codec));
+  fl_event_channel_set_stream_handlers(self->events, listen_cb, cancel_cb,
+                                       self, nullptr);
+  self->link_events =
+      fl_event_channel_new(messenger, kLinkChannel, FL_METHOD_CODEC(codec));
+  fl_event_channel_set_stream_handlers(self->link_events, link_listen_cb,
+                                       link_cancel_cb, self, nullptr);
+  return self;
+}
+
+void udp_transport_plugin_free(UdpTransportPlugin* self) {
+  // No batch can be started once the thread is gone; drop any flush that
+  // is still queued on the main loop.
+  self->link->Close();
+  while (g_idle_remove_by_data(self)) {
+  }
+  fl_method_channel_set_method_call_handler(self->methods, nullptr, nullptr,
+                                            nullptr);
+  fl_event_channel_set_stream_handlers(self->events, nullptr, nullptr,
+                                       nullptr, nullptr);
+  fl_event_channel_set_stream_handlers(self->link_events, nullptr, nullptr,
+                                       nullptr, nullptr);
+  g_object_unref(self->methods);
+  g_object_unref(self->events);
+  g_object_unref(self->link_events);
+  delete self->link;
+  delete self;
+}
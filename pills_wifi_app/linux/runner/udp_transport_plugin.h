@@ -0,0 +1,29 @@
+#ifndef FLUTTER_UDP_TRANSPORT_PLUGIN_H_
+#define FLUTTER_UDP_TRANSPORT_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+typedef struct _UdpTransportPlugin UdpTransportPlugin;
+
+/**
+ * udp_transport_plugin_new:
+ * @registry: the plugin registry of the Flutter view.
+ *
+ * Registers the native gateway transport (udp_link.h) on the
+ * "pills_wifi_app/udp" method channel and the
+ * "pills_wifi_app/udp/telemetry" and "pills_wifi_app/udp/link" event
+ * channels used by lib/services/native_udp_transport.dart.
+ *
+ * Returns: the plugin, to be released with udp_transport_plugin_free().
+ */
+UdpTransportPlugin* udp_transport_plugin_new(FlPluginRegistry* registry);
+
+/**
+ * udp_transport_plugin_free:
+ * @plugin: a plugin from udp_transport_plugin_new().
+ *
+ * Stops the I/O thread, closes the socket and unregisters the channels.
+ */
+void udp_transport_plugin_free(UdpTransportPlugin* plugin);
+
+#endif  // FLUTTER_UDP_TRANSPORT_PLUGIN_H_
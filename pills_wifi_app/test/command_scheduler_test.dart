@@ -0,0 +1,118 @@
+import 'dart:async';
+import 'dart:typed_data';
+
+import 'package:flutter_test/flutter_test.dart';
+import 'package:pills_wifi_app/services/command_scheduler.dart';
+import 'package:pills_wifi_app/services/udp_transport.dart';
+import 'package:pills_wifi_app/services/wire_protocol.dart';
+
+class _FakeTransport implements UdpTransport {
+  final List<WireMessage> sent = <WireMessage>[];
+  WireMessage? repeating;
+  Duration? period;
+
+  @override
+  Future<int?> open(String host, int port, {required Duration period, bool legacyAscii = false}) async => 0;
+
+  @override
+  Future<void> setPeriod(Duration period) async {
+    this.period = period;
+  }
+
+  @override
+  Future<void> setRepeating(WireMessage msg) async {
+    repeating = msg;
+  }
+
+  @override
+  Future<void> sendNow(WireMessage msg) async => sent.add(msg);
+
+  @override
+  Stream<Float64List> get telemetry => const Stream<Float64List>.empty();
+
+  @override
+  Stream<Int32List> get linkSamples => const Stream<Int32List>.empty();
+
+  @override
+  Future<void> close() async {}
+}
+
+void main() {
+  const CommandSchedulerConfig config = CommandSchedulerConfig(settle: Duration(milliseconds: 20));
+
+  test('moves are sent on change and repeated at the nominal rate', () {
+    final _FakeTransport transport = _FakeTransport();
+    final CommandScheduler scheduler = CommandScheduler(transport, config: config)..start();
+    expect(transport.repeating!.type, WireType.heartbeat);
+    expect(transport.period, config.keepalive);
+
+    scheduler
+      ..setThrottle(50)
+      ..setJoystick(0.5, -0.5);
+    expect(transport.sent.single.fields, <int>[25, -25]);
+    expect(transport.repeating!.fields, <int>[25, -25]);
+    expect(transport.period, const Duration(milliseconds: 10));
+
+    // Inside the deadband: nothing new
+    scheduler.setJoystick(0.51, -0.5);
+    expect(transport.repeating!.fields, <int>[25, -25]);
+    scheduler.dispose();
+  });
+
+  test('a centred joystick settles with zero moves, then heartbeats', () async {
+    final _FakeTransport transport = _FakeTransport();
+    final CommandScheduler scheduler = CommandScheduler(transport, config: config)
+      ..start()
+      ..setThrottle(100)
+      ..setJoystick(1.0, 0.0)
+      ..setJoystick(0.0, 0.0);
+    expect(transport.repeating!.fields, <int>[0, 0]);
+    await Future<void>.delayed(const Duration(milliseconds: 50));
+    expect(transport.repeating!.type, WireType.heartbeat);
+    expect(transport.period, config.keepalive);
+    scheduler.dispose();
+  });
+
+  test('the rate backs off on queueing and rises on loss', () {
+    final _FakeTransport transport = _FakeTransport();
+    final CommandScheduler scheduler = CommandScheduler(transport, config: config)
+      ..start()
+      ..setThrottle(100)
+      ..setJoystick(1.0, 0.0);
+
+    scheduler.onLinkSamples(Int32List.fromList(<int>[2000]));
+    expect(scheduler.rateHz, config.nominalRateHz);
+    for (int i = 0; i < 20; i++) {
+      scheduler.onLinkSamples(Int32List.fromList(<int>[200000]));
+    }
+    expect(scheduler.rateHz, config.minRateHz);
+    expect(transport.period, const Duration(milliseconds: 20));
+
+    final CommandScheduler lossy = CommandScheduler(_FakeTransport(), config: config);
+    for (int i = 0; i < 20; i++) {
+      lossy.onLinkSamples(Int32List.fromList(<int>[2000, udpProbeLost]));
+    }
+    expect(lossy.rateHz, config.maxRateHz);
+    scheduler.dispose();
+  });
+
+  test('a lasting rise in RTT becomes the new base and the rate recovers', () {
+    final CommandScheduler scheduler = CommandScheduler(_FakeTransport(), config: config)
+      ..start()
+      ..setThrottle(100)
+      ..setJoystick(1.0, 0.0);
+
+    scheduler.onLinkSamples(Int32List.fromList(<int>[2000]));
+    for (int i = 0; i < 20; i++) {
+      scheduler.onLinkSamples(Int32List.fromList(<int>[200000]));
+    }
+    expect(scheduler.rateHz, config.minRateHz);
+
+    // Once the 2 ms sample has left the window, 200 ms is the base
+    for (int i = 0; i < config.baseRttWindow; i++) {
+      scheduler.onLinkSamples(Int32List.fromList(<int>[200000]));
+    }
+    expect(scheduler.rateHz, config.nominalRateHz);
+    scheduler.dispose();
+  });
+}
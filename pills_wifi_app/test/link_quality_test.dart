@@ -0,0 +1,24 @@
+import 'dart:typed_data';
+
+import 'package:flutter_test/flutter_test.dart';
+import 'package:pills_wifi_app/services/link_quality.dart';
+import 'package:pills_wifi_app/services/udp_transport.dart';
+
+void main() {
+  test('window gives mean RTT, jitter and loss of the newest samples', () {
+    final LinkQualityWindow window = LinkQualityWindow(capacity: 4);
+    window.add(Int32List.fromList(<int>[9000, 9000]));
+    final LinkQuality q = window.add(Int32List.fromList(<int>[1000, udpProbeLost, 3000, 2000]));
+    expect(q.samples, 4);
+    expect(q.loss, 0.25);
+    expect(q.rtt, const Duration(microseconds: 2000));
+    expect(q.jitter, const Duration(microseconds: 1500)); // |3000 - 1000|, |2000 - 3000|
+  });
+
+  test('window with every ping lost has no RTT', () {
+    final LinkQuality q = LinkQualityWindow().add(Int32List.fromList(<int>[udpProbeLost]));
+    expect(q.rtt, isNull);
+    expect(q.jitter, isNull);
+    expect(q.loss, 1.0);
+  });
+}
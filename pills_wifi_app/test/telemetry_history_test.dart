@@ -0,0 +1,28 @@
+import 'dart:typed_data';
+
+import 'package:flutter_test/flutter_test.dart';
+import 'package:pills_wifi_app/ui/telemetry_history.dart';
+
+void main() {
+  TestWidgetsFlutterBinding.ensureInitialized();
+
+  Float64List samples(int from, int count) {
+    final Float64List batch = Float64List(count * TelemetryHistory.channels);
+    for (int i = 0; i < batch.length; i++) {
+      batch[i] = (from + i ~/ TelemetryHistory.channels).toDouble();
+    }
+    return batch;
+  }
+
+  test('history keeps the newest samples, oldest first', () {
+    final TelemetryHistory history = TelemetryHistory(capacity: 4)
+      ..addBatch(samples(0, 3))
+      ..addBatch(samples(3, 3));
+    expect(history.length, 4);
+    expect(<double>[for (int i = 0; i < 4; i++) history.valueAt(3, i)], <double>[2, 3, 4, 5]);
+    for (int i = 1; i < 4; i++) {
+      expect(history.timeAt(i), greaterThanOrEqualTo(history.timeAt(i - 1)));
+    }
+    history.dispose();
+  });
+}
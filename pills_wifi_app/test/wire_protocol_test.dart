@@ -0,0 +1,89 @@
+import 'dart:typed_data';
+
+import 'package:flutter_test/flutter_test.dart';
+import 'package:pills_wifi_app/services/wire_protocol.dart';
+
+void main() {
+  test('crc16 matches the CCITT-FALSE check value', () {
+    expect(crc16('123456789'.codeUnits), 0x29b1);
+  });
+
+  test('cobs round-trips data containing zeros', () {
+    final List<int> data = <int>[0x11, 0x00, 0x00, 0x22, 0x33, 0x00];
+    final Uint8List encoded = cobsEncode(data);
+    expect(encoded.contains(0), isFalse);
+    expect(cobsDecode(encoded, 0, encoded.length), data);
+  });
+
+  test('move encodes to the same bytes as the gateway codec', () {
+    final Uint8List frame = encodeWireMessage(const WireMessage(WireType.move, 0x1234, <int>[50, -25]));
+    expect(frame, <int>[0x05, 0x44, 0x34, 0x12, 0x32, 0x05, 0xe7, 0xff, 0x44, 0xd2, 0x00]);
+  });
+
+  test('datagram with several frames decodes each one', () {
+    final BytesBuilder builder = BytesBuilder()
+      ..add(encodeWireMessage(const WireMessage(WireType.heartbeat, 1)))
+      ..add(encodeWireMessage(const WireMessage(WireType.telemetry, 2, <int>[100, 1, -2, 98])));
+    final List<WireMessage> messages = decodeWireDatagram(builder.toBytes());
+    expect(messages.map((WireMessage m) => m.type), <int>[WireType.heartbeat, WireType.telemetry]);
+    expect(messages[1].seq, 2);
+    expect(messages[1].fields, <int>[100, 1, -2, 98]);
+  });
+
+  test('corrupted frame is rejected', () {
+    final Uint8List frame = encodeWireMessage(const WireMessage(WireType.move, 7, <int>[1, 1]));
+    frame[3] ^= 0x01;
+    expect(decodeWireDatagram(frame), isEmpty);
+  });
+
+  test('binary frame starting with 0x02 is not taken for ASCII', () {
+    final Uint8List frame = encodeWireMessage(const WireMessage(WireType.heartbeat, 0));
+    expect(frame[0], 0x02);
+    expect(isLegacyAsciiFrame(frame), isFalse);
+    expect(isLegacyAsciiFrame(Uint8List.fromList('\x02stop\x03'.codeUnits)), isTrue);
+  });
+
+  test('telemetry delta carries one field per mask bit', () {
+    final Uint8List frame = encodeWireMessage(const WireMessage(WireType.telemetryDelta, 9, <int>[0x5, 100, -3]));
+    expect(decodeWireDatagram(frame).single.fields, <int>[0x5, 100, -3]);
+    final Uint8List short = encodeWireMessage(const WireMessage(WireType.telemetryDelta, 9, <int>[0x7, 100, -3]));
+    expect(decodeWireDatagram(short), isEmpty);
+  });
+
+  test('legacy telemetry parses in hundredths without a regex', () {
+    final AsciiTelemetry out = AsciiTelemetry();
+    final Uint8List frame = Uint8List.fromList('xx\x02+75.00-0.12+1.05-12.30\x03'.codeUnits);
+    expect(parseAsciiTelemetry(frame, 2, frame.length, out), isTrue);
+    expect(out.fields, <int>[7500, -12, 105, -1230]);
+  });
+
+  test('legacy telemetry out of int16 range saturates like the gateway', () {
+    final AsciiTelemetry out = AsciiTelemetry();
+    final Uint8List frame = Uint8List.fromList('\x02+327.67+327.68-999.99+99999999.00\x03'.codeUnits);
+    expect(parseAsciiTelemetry(frame, 0, frame.length, out), isTrue);
+    expect(out.fields, <int>[32767, 32767, -32767, 32767]);
+  });
+
+  test('malformed legacy telemetry is rejected', () {
+    final AsciiTelemetry out = AsciiTelemetry();
+    for (final String text in <String>[
+      '\x02heartbeat\x03',
+      '\x02+1.00+2.00+3.00\x03',
+      '\x02+1.00+2.00+3.00+4.00+5.00\x03',
+      '\x02+1.0+2.00+3.00+4.00\x03',
+      '\x02+.50+2.00+3.00+4.00\x03',
+      '\x02+1.00+2.00+3.00+4.00',
+    ]) {
+      final Uint8List frame = Uint8List.fromList(text.codeUnits);
+      expect(parseAsciiTelemetry(frame, 0, frame.length, out), isFalse, reason: text);
+    }
+  });
+
+  test('encoder writes legacy commands like the gateway', () {
+    final WireEncoder encoder = WireEncoder();
+    expect(String.fromCharCodes(encoder.encodeAscii(WireType.move, <int>[50, -25])), '\x02+0.50-0.25\x03');
+    expect(String.fromCharCodes(encoder.encodeAscii(WireType.move, <int>[0, -10532])), '\x02+0.00-105.32\x03');
+    expect(String.fromCharCodes(encoder.encodeAscii(WireType.heartbeat, const <int>[])), '\x02heartbeat\x03');
+    expect(encoder.encodeAscii(WireType.statsRequest, const <int>[]), isEmpty);
+  });
+}